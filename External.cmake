@@ -42,6 +42,8 @@ endif(FFTW3_FOUND)
 find_package(Eigen3 REQUIRED)
 include_directories(${EIGEN3_INCLUDE_DIR})
 
+find_package(Threads REQUIRED)
+
 if(${CMAKE_SYSTEM_NAME} MATCHES "Windows")
     # Windows specific code
     list(APPEND cimgdisplay_libs gdi32)
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <ostream>
+
+namespace benchmark {
+
+/**
+ * Timing statistics (in seconds) over a number of repetitions of the same measurement.
+ **/
+struct Statistics {
+	int repetitions = 0;
+	double mean = 0.0, median = 0.0, min = 0.0, max = 0.0, stddev = 0.0;
+};
+
+inline Statistics statistics(std::vector<double> samples) {
+	Statistics s;
+	if (samples.empty()) return s;
+	std::sort(samples.begin(), samples.end());
+	s.repetitions = int(samples.size());
+	s.min = samples.front(); s.max = samples.back();
+	s.median = (samples.size() % 2) ? samples[samples.size()/2] : 0.5*(samples[samples.size()/2 - 1] + samples[samples.size()/2]);
+	s.mean = std::accumulate(samples.begin(), samples.end(), 0.0)/double(samples.size());
+	double var = 0.0;
+	for (double t : samples) var += (t - s.mean)*(t - s.mean);
+	s.stddev = (samples.size() > 1) ? std::sqrt(var/double(samples.size() - 1)) : 0.0;
+	return s;
+}
+
+template<typename F>
+double seconds(F&& f) {
+	auto start = std::chrono::steady_clock::now();
+	f();
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Runs f warmup times without measuring (caches, branch predictors, page faults) and
+ * then measures repetitions runs.
+ **/
+template<typename F>
+Statistics measure(F&& f, int warmup, int repetitions) {
+	for (int i = 0; i<warmup; ++i) f();
+	std::vector<double> samples;
+	for (int i = 0; i<std::max(repetitions,1); ++i) samples.push_back(seconds(f));
+	return statistics(samples);
+}
+
+struct Result {
+	std::string scene, workload;
+	std::size_t rays = 0, hits = 0;
+	double build_seconds = 0.0;
+	Statistics time;
+
+	double mrays_per_second() const { return (time.mean > 0.0) ? 1.e-6*double(rays)/time.mean : 0.0; }
+	double ns_per_ray() const { return (rays > 0) ? 1.e9*time.mean/double(rays) : 0.0; }
+};
+
+inline std::string json_string(const std::string& s) {
+	std::string sol = "\"";
+	for (char c : s) {
+		if ((c == '"') || (c == '\\')) sol += '\\';
+		sol += c;
+	}
+	return sol + "\"";
+}
+
+inline void write_json(std::ostream& os, const std::vector<Result>& results) {
+	os<<"{\n  \"compiler\": "<<json_string(__VERSION__)<<",\n  \"results\": [";
+	for (std::size_t i = 0; i<results.size(); ++i) {
+		const Result& r = results[i];
+		os<<((i>0)?",":"")<<"\n    { \"scene\": "<<json_string(r.scene)<<", \"workload\": "<<json_string(r.workload)
+		  <<", \"rays\": "<<r.rays<<", \"hits\": "<<r.hits<<", \"build_seconds\": "<<r.build_seconds
+		  <<", \"repetitions\": "<<r.time.repetitions<<", \"mean_seconds\": "<<r.time.mean<<", \"median_seconds\": "<<r.time.median
+		  <<", \"min_seconds\": "<<r.time.min<<", \"max_seconds\": "<<r.time.max<<", \"stddev_seconds\": "<<r.time.stddev
+		  <<", \"mrays_per_second\": "<<r.mrays_per_second()<<", \"ns_per_ray\": "<<r.ns_per_ray()<<" }";
+	}
+	os<<"\n  ]\n}\n";
+}
+
+inline void write_csv(std::ostream& os, const std::vector<Result>& results) {
+	os<<"scene,workload,rays,hits,build_seconds,repetitions,mean_seconds,median_seconds,min_seconds,max_seconds,stddev_seconds,mrays_per_second,ns_per_ray\n";
+	for (const Result& r : results)
+		os<<r.scene<<","<<r.workload<<","<<r.rays<<","<<r.hits<<","<<r.build_seconds<<","<<r.time.repetitions<<","
+		  <<r.time.mean<<","<<r.time.median<<","<<r.time.min<<","<<r.time.max<<","<<r.time.stddev<<","
+		  <<r.mrays_per_second()<<","<<r.ns_per_ray()<<"\n";
+}
+
+}
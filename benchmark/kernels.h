@@ -0,0 +1,76 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include <chrono>
+#include <tuple>
+#include <list>
+#include <string>
+
+/**
+ * Microbenchmark kernels for single primitive types: sets of N objects of each type that are
+ * all traversed by the ray (0,0,0)->(0,0,1), whose closest hit is at distance 2. Shared by the
+ * packing experiment and the pack width tuning tool.
+ **/
+namespace benchmark {
+
+template<typename Object>
+std::tuple<std::optional<tracer::Hit>, float> time_per_ray(const tracer::Ray& ray, const Object& o, float time_count = 1.0f)
+{
+    std::chrono::duration<float> duration(0);
+    std::chrono::time_point<std::chrono::system_clock> start = std::chrono::system_clock::now();
+    std::optional<tracer::Hit> h; unsigned long n=0;
+    while ((duration.count() < time_count) || (n==0))
+    {
+	h = o.trace(ray);
+	duration = std::chrono::system_clock::now() - start;
+	++n;
+    }
+
+    return std::make_tuple(h,duration.count()/float(n));
+}
+
+inline std::string to_string(const tracer::Plane& p)  { return std::string("planes "); }
+inline std::string to_string(const tracer::Sphere& p) { return std::string("spheres"); }
+inline std::string to_string(const tracer::Triangle& p) { return std::string("triangle"); }
+inline std::string to_string(const tracer::AxisAlignedBox& p) { return std::string("box"); }
+
+inline void add_all(std::list<tracer::Plane>& a, int number) {
+	float df = 8.0f/float(std::max(number-2,1));
+	for (float f = 2.0; f <= 6.000001f; f+=df) {
+		a.push_back(tracer::Plane(Eigen::Vector3f(0.0f,0.0f,-1.0f),Eigen::Vector3f(0.0f,0.0f,f)));
+		if ((number % 2) == 0)
+			a.push_back(tracer::Plane(Eigen::Vector3f(0.0f,0.0f,-1.0f),Eigen::Vector3f(0.0f,0.0f,1.0f-f)));
+	}	
+}
+
+inline void add_all(std::list<tracer::Sphere>& a, int number) {
+	float df = 8.0f/float(std::max(number-2,1));
+	for (float f = 2.0; f <= 6.000001f; f+=df) {
+		a.push_back(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,2.0f*f),f));
+		if ((number % 2) == 0)
+			a.push_back(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.5f-2.0f*f),f));
+	}	
+}
+
+inline void add_all(std::list<tracer::AxisAlignedBox>& a, int number) {
+	float df = 8.0f/float(std::max(number-2,1));
+	for (float f = 2.0; f <= 6.000001f; f+=df) {
+		a.push_back(tracer::AxisAlignedBox(Eigen::Vector3f(-1.0f,-1.0f,f),Eigen::Vector3f(1.0f,1.0f,2.0*f)));
+		if ((number % 2) == 0)
+			a.push_back(tracer::AxisAlignedBox(Eigen::Vector3f(-1.0f,-1.0f,-f),Eigen::Vector3f(1.0f,1.0f,-2.0*f)));
+	}	
+}
+
+
+
+inline void add_all(std::list<tracer::Triangle>& a, int number) {
+	a.push_back(tracer::Triangle(Eigen::Vector3f(-0.5f,-0.5f,2.0f),Eigen::Vector3f( 0.5f,-0.5f,2.0f), Eigen::Vector3f( 0.0f, 1.0f,2.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f)));
+	for (int i = 1; i < number; i+=2)
+	{
+		a.push_back(tracer::Triangle(Eigen::Vector3f(-0.5f,-0.5f,2.0f+3.0f*(float(i)/float(number))),Eigen::Vector3f( 0.5f,-0.5f,2.0f+5.0f*(1.0f - (float(i)/float(number)))), Eigen::Vector3f( 0.0f, 1.0f,2.0f+4.0f*(float((3*i)%number)/float(number)))));
+		if ((number % 2) == 1)
+			a.push_back(tracer::Triangle(Eigen::Vector3f(-0.5f,-0.5f-1.0f*(float(i)/float(number)),5.0f),Eigen::Vector3f( 0.5f - 1.0f*(float((5*i)%number)/float(number)),-0.5f,6.0f), Eigen::Vector3f( -0.3f + float(i)/float(number), 0.7f*float(25-i)/float(number), 7.0f)));
+	}
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include <random>
+#include <vector>
+#include <string>
+#include <cmath>
+
+namespace benchmark {
+
+/**
+ * A set of rays that is representative of a rendering task. Shadow workloads are traced
+ * with trace_shadow (any hit), the rest with trace (closest hit).
+ **/
+struct Workload {
+	std::string name;
+	std::vector<tracer::Ray> rays;
+	bool shadow = false;
+};
+
+/**
+ * Camera rays for a w x h image, tile by tile and in Morton order within each tile: 
+ * the most coherent workload.
+ **/
+inline Workload primary(const tracer::Pinhole& camera, int w, int h) {
+	Workload sol; sol.name = "primary";
+	sol.rays.reserve(std::size_t(w)*std::size_t(h));
+	for (const tracer::Tile& tile : tracer::tiles(w,h)) {
+		std::vector<std::array<int,2>> pixels = tracer::pixels(tile);
+		for (std::size_t p = 0; p<pixels.size(); p+=8) {
+			tracer::RayBlock<8> block = camera.rays<8>(&pixels[p], int(std::min<std::size_t>(8,pixels.size()-p)), w, h);
+			for (int k = 0; k<block.size(); ++k) sol.rays.push_back(block.ray(k));
+		}
+	}
+	return sol;
+}
+
+inline Eigen::Vector3f cosine_weighted(const tracer::Hit& hit, const Eigen::Vector3f& incoming, std::mt19937& random) {
+	std::uniform_real_distribution<float> uniform(0.0f,1.0f);
+	float phi = 2.0f*float(M_PI)*uniform(random);
+	float r2 = uniform(random);
+	Eigen::Vector3f local(std::sqrt(r2)*std::cos(phi), std::sqrt(r2)*std::sin(phi), std::sqrt(1.0f - r2));
+	Eigen::Vector3f sol = hit.local_to_global()*local;
+	//We bounce towards the side of the surface the ray came from
+	return (sol.dot(hit.normal())*incoming.dot(hit.normal()) > 0.0f) ? Eigen::Vector3f(-sol) : sol;
+}
+
+/**
+ * The rest of the standard workloads are generated from the primary hits: diffuse bounces
+ * (incoherent), shadow rays towards a point light (any hit, bounded range) and rays
+ * that are verified to miss the whole scene.
+ **/
+template<typename S>
+std::vector<Workload> workloads(const S& scene, const tracer::Pinhole& camera, const Eigen::Vector3f& light, int w, int h, unsigned int seed = 0) {
+	const float eps = 1.e-4f;
+	std::mt19937 random(seed);
+	std::vector<Workload> sol;
+	sol.push_back(primary(camera,w,h));
+
+	Workload diffuse; diffuse.name = "diffuse";
+	Workload shadow;  shadow.name = "shadow"; shadow.shadow = true;
+	for (const tracer::Ray& r : sol.front().rays) {
+		std::optional<tracer::Hit> hit = scene.trace(r);
+		if (!hit) continue;
+		//Spawned from the hit, so they keep its level of detail (see Lod)
+		diffuse.rays.push_back(hit->spawn(cosine_weighted(*hit, r.direction(), random), eps));
+		Eigen::Vector3f tolight = light - hit->point();
+		float distance = tolight.norm();
+		shadow.rays.push_back(hit->spawn(tolight/distance, eps, distance - eps));
+	}
+	sol.push_back(diffuse);
+	sol.push_back(shadow);
+
+	Workload miss; miss.name = "miss";
+	std::size_t count = sol.front().rays.size();
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	for (std::size_t attempt = 0; (attempt < 20*count) && (miss.rays.size() < count); ++attempt) {
+		Eigen::Vector3f d(uniform(random), uniform(random), uniform(random));
+		if ((d.squaredNorm() > 1.0f) || (d.squaredNorm() < 1.e-4f)) continue;
+		tracer::Ray r(camera.transform().block<3,1>(0,3) + 0.1f*Eigen::Vector3f(uniform(random), uniform(random), uniform(random)), d.normalized());
+		if (!scene.trace_shadow(r)) miss.rays.push_back(r);
+	}
+	sol.push_back(miss);
+	return sol;
+}
+
+/**
+ * Traces the whole workload once, returns the number of hits (closest hit workloads) or
+ * occluded rays (shadow workloads).
+ **/
+template<typename S>
+std::size_t trace(const S& scene, const Workload& workload) {
+	std::size_t hits = 0;
+	if (workload.shadow) { for (const tracer::Ray& r : workload.rays) if (scene.trace_shadow(r)) ++hits; }
+	else                 { for (const tracer::Ray& r : workload.rays) if (scene.trace(r)) ++hits; }
+	return hits;
+}
+
+}
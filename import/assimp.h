@@ -4,6 +4,9 @@
 #include <assimp/scene.h>           // Output data structure
 #include <assimp/postprocess.h>     // Post processing flags
 #include <exception>
+#include <vector>
+#include <tracer/primitives/triangle.h>
+#include <tracer/profiler.h>
 
 class AssimpException : public std::exception {
 	std::string w;
@@ -29,4 +32,63 @@ void import_assimp(const std::string& pFile)
 
   std::cout<<pFile<<" contains "<<scene->mNumMeshes<<" meshes, "<<scene->mNumCameras<<" cameras and "<<scene->mNumLights<<" lights."<<std::endl;
   // We're done. Everything will be cleaned up by the importer destructor
-}
\ No newline at end of file
+}
+
+/**
+ * Loads all the triangles of all the meshes in the file, in world space (the node hierarchy is flattened).
+ * Vertex normals and tangents are used when available.
+ **/
+void import_triangles(const aiScene* scene, const aiNode* node, const aiMatrix4x4& parent, std::vector<tracer::Triangle>& triangles)
+{
+  aiMatrix4x4 transform = parent * node->mTransformation;
+  aiMatrix3x3 linear_transform = aiMatrix3x3(transform);
+  aiMatrix3x3 normal_transform = aiMatrix3x3(transform).Inverse().Transpose();
+  auto point = [&transform] (const aiVector3D& v) { aiVector3D p = transform * v; return Eigen::Vector3f(p.x, p.y, p.z); };
+  auto direction = [&normal_transform] (const aiVector3D& v) { aiVector3D d = normal_transform * v; return Eigen::Vector3f(d.x, d.y, d.z).normalized(); };
+  //Tangents lie on the surface, so they follow the linear part of the transform (not the normal one)
+  auto tangent = [&linear_transform] (const aiVector3D& v) { aiVector3D d = linear_transform * v; return Eigen::Vector3f(d.x, d.y, d.z).normalized(); };
+
+  for (unsigned int m = 0; m < node->mNumMeshes; ++m) {
+    const aiMesh* mesh = scene->mMeshes[node->mMeshes[m]];
+    for (unsigned int f = 0; f < mesh->mNumFaces; ++f) {
+      const aiFace& face = mesh->mFaces[f];
+      if (face.mNumIndices != 3) continue; //Points and lines are skipped
+      const unsigned int* i = face.mIndices;
+      Eigen::Vector3f p0 = point(mesh->mVertices[i[0]]), p1 = point(mesh->mVertices[i[1]]), p2 = point(mesh->mVertices[i[2]]);
+      if ((p1 - p0).cross(p2 - p0).squaredNorm() <= 0.0f) continue; //Degenerate triangle
+      bool tangents = mesh->HasNormals() && mesh->HasTangentsAndBitangents();
+      Eigen::Vector3f n[3], t[3];
+      for (int k = 0; tangents && (k<3); ++k) {
+        n[k] = direction(mesh->mNormals[i[k]]);
+        t[k] = tangent(mesh->mTangents[i[k]]);
+        t[k] = (t[k] - n[k].dot(t[k])*n[k]).normalized(); //Gram-Schmidt, tangents should be perpendicular
+        tangents = n[k].allFinite() && t[k].allFinite();
+      }
+      if (tangents)
+        triangles.push_back(tracer::Triangle(p0,n[0],t[0],p1,n[1],t[1],p2,n[2],t[2]));
+      else if (mesh->HasNormals())
+        triangles.push_back(tracer::Triangle(p0,direction(mesh->mNormals[i[0]]),p1,direction(mesh->mNormals[i[1]]),p2,direction(mesh->mNormals[i[2]])));
+      else
+        triangles.push_back(tracer::Triangle(p0,p1,p2));
+    }
+  }
+  for (unsigned int c = 0; c < node->mNumChildren; ++c)
+    import_triangles(scene, node->mChildren[c], transform, triangles);
+}
+
+std::vector<tracer::Triangle> import_triangles(const std::string& pFile)
+{
+  TRACER_PROFILE_SCOPE("import");
+  Assimp::Importer importer;
+  const aiScene* scene = importer.ReadFile( pFile,
+        aiProcess_CalcTangentSpace       |
+        aiProcess_GenNormals             |
+        aiProcess_Triangulate            |
+        aiProcess_JoinIdenticalVertices  |
+        aiProcess_SortByPType);
+  if( !scene) throw(AssimpException(importer.GetErrorString()));
+
+  std::vector<tracer::Triangle> triangles;
+  import_triangles(scene, scene->mRootNode, aiMatrix4x4(), triangles);
+  return triangles;
+}
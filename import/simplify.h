@@ -0,0 +1,106 @@
+#pragma once
+
+#include <tracer/primitives/triangle.h>
+#include <tracer/pack/pack-triangle.h>
+#include <tracer/composites/lod.h>
+#include <tracer/profiler.h>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <set>
+#include <cmath>
+#include <algorithm>
+
+/**
+ * Simplification by vertex clustering: vertices are snapped to a grid of the given cell size,
+ * the ones in the same cell are merged (at their average position, with their average normal)
+ * and triangles that collapse are dropped. Every vertex moves at most the diagonal of a cell, which
+ * is taken as the error of the result. It is not the best simplification there is, but it is fast
+ * and robust to triangle soups.
+ **/
+inline std::vector<tracer::Triangle> simplify_triangles(const std::vector<tracer::Triangle>& triangles, float cell) {
+	TRACER_PROFILE_SCOPE("simplify");
+	tracer::Bounds bounds;
+	for (const tracer::Triangle& t : triangles) bounds.extend(t.bounds());
+	auto key = [&] (const Eigen::Vector3f& p) {
+		Eigen::Vector3f c = ((p - bounds.min())/cell).array().floor();
+		return std::array<long long,3>{(long long)c[0], (long long)c[1], (long long)c[2]};
+	};
+	struct KeyHash {
+		std::size_t operator()(const std::array<long long,3>& k) const noexcept {
+			return std::size_t(k[0])*73856093u ^ std::size_t(k[1])*19349663u ^ std::size_t(k[2])*83492791u;
+		}
+	};
+	struct Cluster { Eigen::Vector3f position = Eigen::Vector3f::Zero(), normal = Eigen::Vector3f::Zero(); int count = 0; };
+
+	std::unordered_map<std::array<long long,3>,int,KeyHash> ids;
+	std::vector<Cluster> clusters;
+	std::vector<std::array<int,3>> corners; corners.reserve(triangles.size());
+	for (const tracer::Triangle& t : triangles) {
+		std::array<const Eigen::Vector3f*,3> points{&t.point0(), &t.point1(), &t.point2()};
+		std::array<const Eigen::Vector3f*,3> normals{&t.normal0(), &t.normal1(), &t.normal2()};
+		std::array<int,3> c;
+		for (int k = 0; k<3; ++k) {
+			auto inserted = ids.emplace(key(*points[k]), int(clusters.size()));
+			if (inserted.second) clusters.emplace_back();
+			Cluster& cluster = clusters[inserted.first->second];
+			cluster.position += *points[k]; cluster.normal += *normals[k]; ++cluster.count;
+			c[k] = inserted.first->second;
+		}
+		corners.push_back(c);
+	}
+
+	std::vector<tracer::Triangle> sol;
+	std::set<std::array<int,3>> seen;
+	for (const std::array<int,3>& c : corners) {
+		if ((c[0] == c[1]) || (c[1] == c[2]) || (c[2] == c[0])) continue; //Collapsed
+		std::array<int,3> sorted = c; std::sort(sorted.begin(), sorted.end());
+		if (!seen.insert(sorted).second) continue; //Already there (both sides of a thin part collapse onto each other)
+		std::array<Eigen::Vector3f,3> p, n, tangent;
+		for (int k = 0; k<3; ++k) {
+			const Cluster& cluster = clusters[c[k]];
+			p[k] = cluster.position/float(cluster.count);
+			n[k] = cluster.normal.normalized();
+		}
+		Eigen::Vector3f geometric = (p[1] - p[0]).cross(p[2] - p[0]);
+		if (!(geometric.squaredNorm() > 0.0f)) continue;
+		for (int k = 0; k<3; ++k) {
+			if (!n[k].allFinite()) n[k] = geometric.normalized(); //Opposite normals cancelled out
+			Eigen::Vector3f e = p[1] - p[0];
+			tangent[k] = (e - n[k].dot(e)*n[k]).normalized();
+			if (!tangent[k].allFinite()) tangent[k] = n[k].unitOrthogonal();
+		}
+		sol.push_back(tracer::Triangle(p[0], n[0], tangent[0], p[1], n[1], tangent[1], p[2], n[2], tangent[2]));
+	}
+	return sol;
+}
+
+/**
+ * Levels of detail of a mesh, from the mesh itself (error 0) to count levels, each one clustering
+ * twice as coarse as the previous one (starting at twice the average edge length). It stops early
+ * once a level has too few triangles to be worth it.
+ **/
+inline std::vector<std::pair<std::vector<tracer::Triangle>,float>> lod_levels(const std::vector<tracer::Triangle>& triangles, int count = 6, std::size_t min_triangles = 16) {
+	std::vector<std::pair<std::vector<tracer::Triangle>,float>> sol;
+	sol.emplace_back(triangles, 0.0f);
+	if (triangles.empty()) return sol;
+	double edges = 0.0;
+	for (const tracer::Triangle& t : triangles) edges += (t.point1() - t.point0()).norm() + (t.point2() - t.point1()).norm() + (t.point0() - t.point2()).norm();
+	float cell = 2.0f*float(edges/(3.0*double(triangles.size())));
+	for (int l = 1; l<count; ++l, cell *= 2.0f) {
+		std::vector<tracer::Triangle> level = simplify_triangles(triangles, cell);
+		if (level.size() < min_triangles) break;
+		sol.emplace_back(std::move(level), std::sqrt(3.0f)*cell);
+	}
+	return sol;
+}
+
+/**
+ * A mesh with its levels of detail, each one in packs of triangles (of the tuned width).
+ **/
+inline auto lod_mesh(const std::vector<tracer::Triangle>& triangles, int count = 6, float tolerance = 1.0f) {
+	using Level = tracer::List<tracer::Pack<tracer::Triangle,tracer::pack_width_v<tracer::Triangle>>>;
+	std::vector<std::pair<Level,float>> levels;
+	for (auto& l : lod_levels(triangles, count)) levels.emplace_back(Level(tracer::packs(l.first)), l.second);
+	return tracer::Lod<Level>(std::move(levels), tolerance);
+}
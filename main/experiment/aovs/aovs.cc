@@ -0,0 +1,58 @@
+#include <array>
+#define MATERIAL std::array<float,3>
+
+#include <iostream>
+#include <string>
+#include <tracer/tracer.h>
+#include <render/aov.h>
+#include <benchmark/benchmark.h>
+#include <cimg-all.h>
+
+/**
+ * Every AOV of the colormap scene in a single pass, saved as aov-<name>.hdr.
+ *
+ * Usage: aovs [samples per pixel]
+ **/
+
+int main(int argc, char** argv) {
+	int w = 512;
+	int h = 512;
+
+	render::AovOptions options;
+	options.samples = (argc > 1) ? std::stoi(argv[1]) : 4;
+	options.miss_depth = 10.0f;
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+
+	tracer::Scene scene;
+	scene.add(tracer::Plane(Eigen::Vector3f(0,0,-10),Eigen::Vector3f(1,0,0)).set_material(std::array<float,3>{0.5f,0.5f,0.5f}));
+	scene.add(tracer::Sphere(Eigen::Vector3f( 0.5, -0.65,-0.2), 0.35).set_material(std::array<float,3>{0.9f,0.1f,0.1f}));
+	scene.add(tracer::Triangle(Eigen::Vector3f(0,-1,-0.8),Eigen::Vector3f(0,0,-0.5), Eigen::Vector3f(0.5,-1,-0.2)).set_material(std::array<float,3>{0.1f,0.9f,0.1f}));
+	scene.add(tracer::AxisAlignedBox(Eigen::Vector3f(0.75,1, 0),Eigen::Vector3f(0.25,0.5,0.5)).set_material(std::array<float,3>{0.1f,0.1f,0.9f}));
+
+	auto material_color = [] (const tracer::Hit& hit, const tracer::Ray&) {
+		return hit.material() ? Eigen::Vector3f(hit.material()->at(0), hit.material()->at(1), hit.material()->at(2)) : Eigen::Vector3f(0.2f,0.2f,0.2f);
+	};
+
+	render::AovBuffers aovs(w,h,0);
+	double seconds = benchmark::seconds([&] () { aovs = render::render_aovs(scene, camera, w, h, render::aov::all, options, material_color); });
+	std::cout<<render::aov::count<<" AOVs at "<<options.samples<<" spp in "<<seconds<<"s"<<std::endl;
+
+	for (int a = 0; a<render::aov::count; ++a) {
+		unsigned int which = 1u<<a;
+		cimg_library::CImg<float> output(w,h,1,3);
+		for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+			const float* p = aovs(which,i,j);
+			for (int c = 0; c<3; ++c) {
+				float value = p[(render::aov::channels(which) == 3) ? c : 0];
+				//Normals to [0,1], hit counts to the fraction of samples
+				if (which == render::aov::normal) value = 0.5f*value + 0.5f;
+				else if (which == render::aov::hit_count) value /= float(options.samples);
+				output(i,j,0,c) = value;
+			}
+		}
+		std::string filename = std::string("aov-") + render::aov::name(which) + ".hdr";
+		std::cout<<filename<<std::endl;
+		output.save(filename.c_str());
+	}
+}
@@ -0,0 +1,53 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <string>
+#include <tracer/tracer.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Build, traversal and teardown times of a scene with many individual objects (spheres, so 
+ * that every one of them is a separate allocation), with and without an arena.
+ *
+ * Usage: arena [objects] [rays]
+ **/
+
+tracer::Scene build(std::size_t objects, const std::shared_ptr<tracer::Arena>& arena) {
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	tracer::Scene scene(arena);
+	scene.reserve(objects);
+	for (std::size_t i = 0; i<objects; ++i)
+		scene.add(tracer::Sphere(Eigen::Vector3f(uniform(random), uniform(random), uniform(random)), 0.001f));
+	return scene;
+}
+
+int main(int argc, char** argv) {
+	std::size_t objects = (argc > 1) ? std::stoul(argv[1]) : 1000000;
+	int rays = (argc > 2) ? std::stoi(argv[2]) : 64;
+
+	std::cout<<std::setw(8)<<"arena"<<std::setw(12)<<"build (s)"<<std::setw(12)<<"trace (s)"<<std::setw(14)<<"teardown (s)"<<std::endl;
+	for (bool use_arena : { false, true }) {
+		//Fragment the heap a bit first, as a real application would
+		std::vector<std::unique_ptr<int>> noise;
+		for (std::size_t i = 0; i<objects/4; ++i) noise.push_back(std::make_unique<int>(int(i)));
+		for (std::size_t i = 0; i<noise.size(); i+=2) noise[i].reset();
+
+		std::unique_ptr<tracer::Scene> scene;
+		double build_seconds = benchmark::seconds([&] () { 
+			scene = std::make_unique<tracer::Scene>(build(objects, use_arena ? std::make_shared<tracer::Arena>() : nullptr)); });
+
+		std::size_t hits = 0;
+		double trace_seconds = benchmark::seconds([&] () {
+			for (int i = 0; i<rays; ++i) {
+				float angle = 2.0f*float(M_PI)*float(i)/float(rays);
+				if (scene->trace(tracer::Ray(Eigen::Vector3f(0.0f,0.0f,-3.0f), Eigen::Vector3f(0.1f*std::cos(angle), 0.1f*std::sin(angle), 1.0f).normalized()))) ++hits;
+			}
+		});
+
+		double teardown_seconds = benchmark::seconds([&] () { scene.reset(); });
+		std::cout<<std::setw(8)<<(use_arena?"yes":"no")<<std::scientific<<std::setprecision(3)
+		         <<std::setw(12)<<build_seconds<<std::setw(12)<<trace_seconds<<std::setw(14)<<teardown_seconds
+		         <<std::defaultfloat<<"   ("<<hits<<" hits)"<<std::endl;
+	}
+}
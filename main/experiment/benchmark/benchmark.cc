@@ -0,0 +1,101 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <functional>
+#include <tracer/tracer.h>
+#include <scenes/cornell-box.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+#include <benchmark/workloads.h>
+#ifdef BENCHMARK_ASSIMP
+#include <import/assimp.h>
+#endif
+
+/**
+ * Ray throughput benchmark on standard workloads (primary, diffuse, shadow and miss rays)
+ * over procedural scenes and, if assimp is available, over the models given as arguments.
+ *
+ * Usage: benchmark [--width w] [--height h] [--warmup n] [--repetitions n] [--json file] [--csv file] [model ...]
+ **/
+
+struct BenchmarkScene {
+	std::string name;
+	std::function<tracer::Scene()> build;
+	tracer::Pinhole camera;
+	Eigen::Vector3f light;
+};
+
+int main(int argc, char** argv) {
+	int w = 128, h = 128, warmup = 1, repetitions = 5;
+	std::string json = "benchmark.json", csv = "benchmark.csv";
+	std::vector<std::string> models;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--width") && (i+1<argc))       w = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))      h = std::stoi(argv[++i]);
+		else if ((arg == "--warmup") && (i+1<argc))      warmup = std::stoi(argv[++i]);
+		else if ((arg == "--repetitions") && (i+1<argc)) repetitions = std::stoi(argv[++i]);
+		else if ((arg == "--json") && (i+1<argc))        json = argv[++i];
+		else if ((arg == "--csv") && (i+1<argc))         csv = argv[++i];
+		else models.push_back(arg);
+	}
+
+	std::vector<BenchmarkScene> scenes;
+	scenes.push_back(BenchmarkScene{"cornell-box", [] () { return scenes::cornell_box(); },
+		tracer::Pinhole(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0)),
+		Eigen::Vector3f(0.0f,0.9f,0.0f)});
+	scenes.push_back(BenchmarkScene{"sphere-field", [] () { return scenes::sphere_field(16); },
+		tracer::Pinhole(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8)),
+		Eigen::Vector3f(2.0f,10.0f,2.0f)});
+	scenes.push_back(BenchmarkScene{"terrain", [] () { return scenes::terrain(32); },
+		tracer::Pinhole(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6)),
+		Eigen::Vector3f(0.0f,3.0f,0.0f)});
+	scenes.push_back(BenchmarkScene{"terrain-compressed", [] () { return scenes::compressed_terrain(32); },
+		tracer::Pinhole(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6)),
+		Eigen::Vector3f(0.0f,3.0f,0.0f)});
+#ifdef BENCHMARK_ASSIMP
+	for (const std::string& model : models) {
+		std::vector<tracer::Triangle> triangles = import_triangles(model);
+		Eigen::Vector3f min = Eigen::Vector3f::Constant(std::numeric_limits<float>::max()), max = -min;
+		for (const tracer::Triangle& t : triangles) {
+			min = min.cwiseMin(t.point0()).cwiseMin(t.point1()).cwiseMin(t.point2());
+			max = max.cwiseMax(t.point0()).cwiseMax(t.point1()).cwiseMax(t.point2());
+		}
+		Eigen::Vector3f center = 0.5f*(min + max); float radius = 0.5f*(max - min).norm();
+		scenes.push_back(BenchmarkScene{model, [triangles] () {
+				tracer::Scene sol;
+				for (std::size_t i = 0; i<triangles.size(); i+=8)
+					sol.add(tracer::pack<8>(std::vector<tracer::Triangle>(triangles.begin()+i, triangles.begin()+std::min(i+8,triangles.size()))));
+				return sol;
+			},
+			tracer::Pinhole(center - Eigen::Vector3f(0,0,2.5f*radius), Eigen::Vector3f(0,0,2), Eigen::Vector3f(0,1,0)),
+			center + Eigen::Vector3f(0,2.0f*radius,-radius)});
+	}
+#else
+	if (!models.empty()) std::cerr<<"Built without assimp: ignoring "<<models.size()<<" model(s)."<<std::endl;
+#endif
+
+	std::vector<benchmark::Result> results;
+	std::cout<<std::setw(16)<<"scene"<<std::setw(10)<<"workload"<<std::setw(10)<<"rays"<<std::setw(12)<<"build (s)"
+	         <<std::setw(10)<<"Mrays/s"<<std::setw(12)<<"ns/ray"<<std::setw(10)<<"stddev"<<std::endl;
+	for (const BenchmarkScene& s : scenes) {
+		tracer::Scene scene;
+		double build_seconds = benchmark::seconds([&] () { scene = s.build(); });
+		for (const benchmark::Workload& workload : benchmark::workloads(scene, s.camera, s.light, w, h)) {
+			if (workload.rays.empty()) continue; //Some scenes (e.g. enclosed by infinite planes) cannot be missed
+			benchmark::Result result;
+			result.scene = s.name; result.workload = workload.name;
+			result.rays = workload.rays.size(); result.build_seconds = build_seconds;
+			result.time = benchmark::measure([&] () { result.hits = benchmark::trace(scene, workload); }, warmup, repetitions);
+			results.push_back(result);
+			std::cout<<std::setw(16)<<result.scene<<std::setw(10)<<result.workload<<std::setw(10)<<result.rays
+			         <<std::scientific<<std::setprecision(2)<<std::setw(12)<<result.build_seconds
+			         <<std::fixed<<std::setw(10)<<result.mrays_per_second()<<std::setw(12)<<result.ns_per_ray()
+			         <<std::setw(9)<<100.0*result.time.stddev/std::max(result.time.mean,1.e-12)<<"%"<<std::endl;
+		}
+	}
+
+	std::ofstream json_file(json); benchmark::write_json(json_file, results);
+	std::ofstream csv_file(csv);   benchmark::write_csv(csv_file, results);
+}
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <cmath>
+#include <tracer/tracer.h>
+#include <render/aov.h>
+#include <render/denoise.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+#include <benchmark/workloads.h>
+#include <cimg-all.h>
+
+/**
+ * Ambient occlusion of the sphere field (one occlusion ray per sample, so few samples are
+ * very noisy) rendered at increasing sample counts, raw and denoised (see render/denoise.h),
+ * against a reference with many more samples: error (RMSE), time of the filter per megapixel and,
+ * for every denoised image, the raw sample count it matches. The noisiest images and the
+ * reference are saved as denoise-raw.hdr, denoise-filtered.hdr and denoise-reference.hdr.
+ *
+ * Usage: denoise [--width w] [--height h] [--reference spp] [--iterations n] [--color sigma]
+ *                [--normal sigma] [--depth sigma] [--threads n]
+ **/
+
+double rmse(const render::AovBuffers& a, const render::AovBuffers& b) {
+	const std::vector<float>& x = a.buffer(render::aov::color);
+	const std::vector<float>& y = b.buffer(render::aov::color);
+	double sol = 0.0;
+	for (std::size_t i = 0; i<x.size(); ++i) sol += double(x[i] - y[i])*double(x[i] - y[i]);
+	return std::sqrt(sol/double(std::max<std::size_t>(x.size(),1)));
+}
+
+void save(const render::AovBuffers& aovs, const char* filename) {
+	cimg_library::CImg<float> output(aovs.width(),aovs.height(),1,3);
+	for (int j = 0; j<aovs.height(); ++j) for (int i = 0; i<aovs.width(); ++i)
+		for (int c = 0; c<3; ++c) output(i,j,0,c) = aovs(render::aov::color,i,j)[c];
+	output.save(filename);
+	std::cout<<filename<<std::endl;
+}
+
+int main(int argc, char** argv) {
+	int w = 512, h = 512, reference_samples = 256;
+	render::DenoiseOptions denoise;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--width") && (i+1<argc))      w = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))     h = std::stoi(argv[++i]);
+		else if ((arg == "--reference") && (i+1<argc))  reference_samples = std::stoi(argv[++i]);
+		else if ((arg == "--iterations") && (i+1<argc)) denoise.iterations = std::stoi(argv[++i]);
+		else if ((arg == "--color") && (i+1<argc))      denoise.color_sigma = std::stof(argv[++i]);
+		else if ((arg == "--normal") && (i+1<argc))     denoise.normal_sigma = std::stof(argv[++i]);
+		else if ((arg == "--depth") && (i+1<argc))      denoise.depth_sigma = std::stof(argv[++i]);
+		else if ((arg == "--threads") && (i+1<argc))    denoise.threads = unsigned(std::stoi(argv[++i]));
+	}
+
+	tracer::Scene scene = scenes::sphere_field(12);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 3, -3), Eigen::Vector3f( 0, -1, 1.6), Eigen::Vector3f( 0, 1.6, 1));
+
+	//White where the occlusion ray escapes within a unit distance, black where it is blocked
+	auto occlusion = [&scene] (const tracer::Hit& hit, const tracer::Ray& ray) {
+		thread_local std::mt19937 random(std::random_device{}());
+		tracer::Ray shadow(hit.point(), benchmark::cosine_weighted(hit, ray.direction(), random), 1.e-4f, 1.0f);
+		return Eigen::Vector3f::Constant(scene.trace_shadow(shadow) ? 0.0f : 1.0f);
+	};
+	const unsigned aovs = render::aov::color | render::aov::normal | render::aov::depth;
+	auto render = [&] (int samples) {
+		render::AovOptions options;
+		options.samples = samples; options.seed = unsigned(samples);
+		options.background = Eigen::Vector3f::Ones();
+		options.threads = denoise.threads;
+		return render::render_aovs(scene, camera, w, h, aovs, options, occlusion);
+	};
+
+	render::AovBuffers reference(0,0,0);
+	double seconds = benchmark::seconds([&] () { reference = render(reference_samples); });
+	std::cout<<"Reference: "<<reference_samples<<" spp in "<<seconds<<"s"<<std::endl;
+	save(reference, "denoise-reference.hdr");
+
+	const double megapixels = double(w)*double(h)*1.e-6;
+	std::vector<int> samples{1, 2, 4, 8, 16, 32, 64};
+	std::vector<double> raw_errors, filtered_errors;
+	render::Denoiser denoiser;
+	std::cout<<std::setw(5)<<"spp"<<std::setw(12)<<"render (s)"<<std::setw(10)<<"raw"<<std::setw(10)<<"denoised"
+	         <<std::setw(14)<<"filter (ms)"<<std::setw(10)<<"ms/MP"<<std::endl;
+	for (int s : samples) {
+		render::AovBuffers raw(0,0,0);
+		double render_seconds = benchmark::seconds([&] () { raw = render(s); });
+		render::AovBuffers filtered = raw;
+		denoiser(filtered, denoise); //Warm up: the planes are allocated once
+		filtered = raw;
+		double filter_seconds = benchmark::seconds([&] () { denoiser(filtered, denoise); });
+		raw_errors.push_back(rmse(raw, reference)); filtered_errors.push_back(rmse(filtered, reference));
+		std::cout<<std::setw(5)<<s<<std::fixed<<std::setprecision(3)<<std::setw(12)<<render_seconds
+		         <<std::setprecision(4)<<std::setw(10)<<raw_errors.back()<<std::setw(10)<<filtered_errors.back()
+		         <<std::setprecision(1)<<std::setw(14)<<1000.0*filter_seconds<<std::setw(10)<<1000.0*filter_seconds/megapixels
+		         <<std::defaultfloat<<std::endl;
+		if (s == samples.front()) { save(raw, "denoise-raw.hdr"); save(filtered, "denoise-filtered.hdr"); }
+	}
+
+	//Fewest raw samples that are at least as good as each denoised image
+	for (std::size_t i = 0; i<samples.size(); ++i) {
+		std::size_t k = 0;
+		while ((k < samples.size()) && (raw_errors[k] > filtered_errors[i])) ++k;
+		std::cout<<"Denoised "<<samples[i]<<" spp ~ raw "<<((k < samples.size()) ? std::to_string(samples[k]) : ("> " + std::to_string(samples.back())))<<" spp"<<std::endl;
+	}
+}
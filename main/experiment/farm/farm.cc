@@ -0,0 +1,96 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <render/farm.h>
+#include <render/framebuffer.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Renders the sphere field with a render farm into farm.pfm. By default the coordinator forks
+ * local workers; it can also wait for workers to connect (from other processes or machines)
+ * to a Unix-domain socket path or to host:port.
+ *
+ * Usage: farm [--workers n] [--slow k] [--width w] [--height h] [--tile size] [--output file]
+ *        farm --listen address --workers n [...]   (coordinator for n remote workers)
+ *        farm --connect address [--width w] [--height h] [--tile size]   (remote worker, same sizes as the coordinator)
+ **/
+
+struct Job {
+	tracer::Scene scene = scenes::sphere_field(32);
+	tracer::Pinhole camera = tracer::Pinhole(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+	int w = 1024, h = 1024;
+
+	void render(render::TileBuffer& buffer) const {
+		const tracer::Tile& t = buffer.tile();
+		float du = 2.0f/float(w), dv = 2.0f/float(h);
+		for (int j = t.y0; j<t.y1; ++j) for (int i = t.x0; i<t.x1; ++i) {
+			tracer::Ray ray = camera.ray((float(i)+0.5f)*du - 1.0f, (float(j)+0.5f)*dv - 1.0f);
+			std::optional<tracer::Hit> hit = scene.trace(ray);
+			if (hit) buffer.set(i, j, 0.5f*hit->normal()[0] + 0.5f, 0.5f*hit->normal()[1] + 0.5f, 0.5f*hit->normal()[2] + 0.5f);
+			else buffer.set(i, j, 0.0f, 0.0f, 0.0f);
+		}
+	}
+};
+
+int main(int argc, char** argv) {
+	int workers = 4, slow = -1, tile_size = 32;
+	std::string listen, connect, output = "farm.pfm";
+	Job job;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--workers") && (i+1<argc)) workers = std::stoi(argv[++i]);
+		else if ((arg == "--slow") && (i+1<argc))    slow = std::stoi(argv[++i]);
+		else if ((arg == "--width") && (i+1<argc))   job.w = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))  job.h = std::stoi(argv[++i]);
+		else if ((arg == "--tile") && (i+1<argc))    tile_size = std::stoi(argv[++i]);
+		else if ((arg == "--output") && (i+1<argc))  output = argv[++i];
+		else if ((arg == "--listen") && (i+1<argc))  listen = argv[++i];
+		else if ((arg == "--connect") && (i+1<argc)) connect = argv[++i];
+		else { std::cerr<<"Unknown argument "<<arg<<std::endl; return 1; }
+	}
+
+	if (!connect.empty()) {
+		render::Socket coordinator = render::connect(render::Address(connect));
+		int tiles = render::farm::serve(coordinator, [&] (render::TileBuffer& b) { job.render(b); }, tile_size);
+		std::cout<<"Rendered "<<tiles<<" tiles"<<std::endl;
+		return 0;
+	}
+
+	//Workers are forked before the framebuffer starts its writer thread
+	std::vector<render::farm::Process> processes;
+	std::vector<render::Socket> sockets;
+	if (listen.empty()) {
+		processes = render::farm::spawn(workers, [&] (render::Socket& s, int index) {
+			render::farm::serve(s, [&] (render::TileBuffer& b) {
+				if (index == slow) std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				job.render(b);
+			}, tile_size);
+		});
+		sockets = render::farm::sockets(processes);
+	} else {
+		render::Listener listener{render::Address(listen)};
+		std::cout<<"Waiting for "<<workers<<" workers on "<<listen<<std::endl;
+		for (int i = 0; i<workers; ++i) sockets.push_back(listener.accept());
+	}
+
+	render::StreamingFramebuffer framebuffer(output, job.w, job.h, tile_size);
+	render::farm::Statistics stats;
+	double seconds = benchmark::seconds([&] () {
+		stats = render::farm::coordinate(sockets, framebuffer.tiles(), [&] (const render::TileBuffer& b) {
+			std::unique_ptr<render::TileBuffer> tile = framebuffer.acquire(b.tile());
+			for (int j = b.tile().y0; j<b.tile().y1; ++j) std::memcpy(tile->row(j), b.row(j), 3*sizeof(float)*b.tile().width());
+			framebuffer.commit(std::move(tile));
+		});
+		framebuffer.close();
+	});
+	sockets.clear();
+	render::farm::wait(processes);
+
+	std::cout<<output<<" ("<<job.w<<"x"<<job.h<<") in "<<seconds<<"s. Tiles per worker:";
+	for (int t : stats.tiles) std::cout<<" "<<t;
+	std::cout<<". Reissued "<<stats.reissued<<", duplicates "<<stats.duplicates<<", failed workers "<<stats.failed<<std::endl;
+}
@@ -0,0 +1,55 @@
+#define TRACER_STATS
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Primary visibility tile by tile, tracing each tile against the whole scene or only against
+ * the objects that survive culling with the frustum of the tile, both for the scene as a list
+ * and in a Bvh (culled through its nodes). Reports time and traversal counters per ray.
+ *
+ * Usage: frustum [spheres per side] [width] [height] [tile size]
+ **/
+
+int main(int argc, char** argv) {
+	int n         = (argc > 1) ? std::stoi(argv[1]) : 64;
+	int w         = (argc > 2) ? std::stoi(argv[2]) : 256;
+	int h         = (argc > 3) ? std::stoi(argv[3]) : 256;
+	int tile_size = (argc > 4) ? std::stoi(argv[4]) : 16;
+
+	tracer::Scene scene = scenes::sphere_field(n);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+	std::vector<tracer::Tile> tiles = tracer::tiles(w,h,tile_size);
+
+	tracer::Bvh<tracer::Object> bvh(scene.objects());
+
+	std::cout<<std::setw(8)<<"scene"<<std::setw(8)<<"culling"<<std::setw(12)<<"time (s)"<<std::setw(14)<<"nodes/ray"<<std::setw(14)<<"prims/ray"<<std::setw(10)<<"hits"<<std::endl;
+	auto run = [&] (const char* name, const auto& objects, bool culling) {
+		std::size_t hits = 0;
+		tracer::stats::reset();
+		double seconds = benchmark::seconds([&] () {
+			for (const tracer::Tile& tile : tiles) {
+				std::vector<std::array<int,2>> pixels = tracer::pixels(tile);
+				auto trace = [&] (const auto& objects) {
+					for (std::size_t p = 0; p<pixels.size(); p+=8) {
+						tracer::RayBlock<8> block = camera.rays<8>(&pixels[p], int(std::min<std::size_t>(8,pixels.size()-p)), w, h);
+						for (int k = 0; k<block.size(); ++k) if (objects.trace(block.ray(k))) ++hits;
+					}
+				};
+				if (culling) trace(tracer::cull(objects, camera.frustum(tile,w,h)));
+				else trace(objects);
+			}
+		});
+		tracer::Counters total = tracer::stats::total();
+		float rays = float(w*h);
+		std::cout<<std::setw(8)<<name<<std::setw(8)<<(culling?"yes":"no")<<std::scientific<<std::setprecision(3)<<std::setw(12)<<seconds
+		         <<std::fixed<<std::setprecision(1)<<std::setw(14)<<float(total.nodes)/rays<<std::setw(14)<<float(total.primitives())/rays
+		         <<std::setw(10)<<hits<<std::endl;
+	};
+	for (bool culling : { false, true }) run("list", scene, culling);
+	for (bool culling : { false, true }) run("bvh", bvh, culling);
+}
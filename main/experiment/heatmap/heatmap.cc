@@ -0,0 +1,91 @@
+#define TRACER_STATS
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <array>
+#include <functional>
+#include <tracer/tracer.h>
+#include <scenes/cornell-box.h>
+#include <scenes/procedural.h>
+#include <render/parallel.h>
+#include <cimg-all.h>
+
+/**
+ * False color: black -> blue -> magenta -> orange -> yellow -> white as t goes from 0 to 1.
+ **/
+std::array<float,3> false_color(float t) {
+	static const std::array<std::array<float,3>,6> colors{{
+		{0.0f,0.0f,0.0f}, {0.1f,0.1f,0.8f}, {0.8f,0.1f,0.7f}, {1.0f,0.5f,0.1f}, {1.0f,0.9f,0.1f}, {1.0f,1.0f,1.0f}}};
+	t = std::max(0.0f,std::min(t,1.0f))*float(colors.size()-1);
+	int i = std::min(int(t), int(colors.size())-2); float f = t - float(i);
+	return std::array<float,3>{(1.0f-f)*colors[i][0] + f*colors[i+1][0], (1.0f-f)*colors[i][1] + f*colors[i+1][1], (1.0f-f)*colors[i][2] + f*colors[i+1][2]};
+}
+
+int main(int argc, char** argv) {
+	std::string name = (argc > 1) ? argv[1] : "cornell-box";
+	tracer::Scene scene = (name == "sphere-field") ? scenes::sphere_field() :
+	                      (name == "terrain") ? scenes::terrain() : scenes::cornell_box();
+
+	int w = 512;
+	int h = 512;
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	Eigen::Vector3f light(0.0f,0.9f,0.0f);
+	if (name == "sphere-field") {
+		camera = tracer::Pinhole(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+		light = Eigen::Vector3f(2.0f,10.0f,2.0f);
+	} else if (name == "terrain") {
+		camera = tracer::Pinhole(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6));
+		light = Eigen::Vector3f(0.0f,3.0f,0.0f);
+	}
+
+	//Counters for each pixel: a primary ray and a shadow ray from its hit towards the light
+	std::vector<tracer::Counters> pixels(w*h);
+	float du = 2.0/float(w);
+	float dv = 2.0/float(h);
+	tracer::stats::reset();
+	render::parallel_for(h, [&] (int j) {
+		float v = 0.5f*dv - 1.0f + float(j)*dv;
+		float u; int i;
+		for (i=0,u=0.5*du - 1.0f; i<w; ++i, u+=du) {
+			tracer::Counters before = tracer::stats::local();
+			std::optional<tracer::Hit> hit = scene.trace(camera.ray(u,v));
+			if (hit) {
+				Eigen::Vector3f tolight = light - hit->point();
+				scene.trace_shadow(tracer::Ray(hit->point(), tolight.normalized(), 1.e-4f, tolight.norm() - 1.e-4f));
+			}
+			pixels[j*w+i] = tracer::stats::local() - before;
+		}
+	});
+
+	tracer::Counters total = tracer::stats::total();
+	float rays = float(w*h);
+	std::cout<<"Per pixel: "<<float(total.nodes)/rays<<" nodes, "<<float(total.primitives())/rays<<" primitive tests ("
+	         <<float(total.planes)/rays<<" planes, "<<float(total.spheres)/rays<<" spheres, "
+	         <<float(total.triangles)/rays<<" triangles, "<<float(total.boxes)/rays<<" boxes), "
+	         <<float(total.wasted_lanes)/rays<<" wasted lanes, "<<float(total.shadow_early_outs)/rays<<" shadow early outs"<<std::endl;
+
+	std::vector<std::tuple<std::string,std::function<std::uint64_t(const tracer::Counters&)>>> heatmaps{
+		{"nodes",            [] (const tracer::Counters& c) { return c.nodes; }},
+		{"primitives",       [] (const tracer::Counters& c) { return c.primitives(); }},
+		{"planes",           [] (const tracer::Counters& c) { return c.planes; }},
+		{"spheres",          [] (const tracer::Counters& c) { return c.spheres; }},
+		{"triangles",        [] (const tracer::Counters& c) { return c.triangles; }},
+		{"boxes",            [] (const tracer::Counters& c) { return c.boxes; }},
+		{"wasted-lanes",     [] (const tracer::Counters& c) { return c.wasted_lanes; }},
+		{"shadow-early-outs",[] (const tracer::Counters& c) { return c.shadow_early_outs; }}};
+
+	for (const auto& [counter, value] : heatmaps) {
+		std::uint64_t max = 0;
+		for (const tracer::Counters& c : pixels) max = std::max(max, value(c));
+		if (max == 0) continue;
+		cimg_library::CImg<float> output(w,h,1,3);
+		for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+			std::array<float,3> color = false_color(float(value(pixels[j*w+i]))/float(max));
+			for (int c=0;c<3;++c) output(i,j,0,c) = color[c];
+		}
+		std::cout<<"heatmap-"<<counter<<".hdr (max "<<max<<")"<<std::endl;
+		output.save(("heatmap-"+counter+".hdr").c_str());
+	}
+}
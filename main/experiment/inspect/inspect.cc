@@ -0,0 +1,142 @@
+#define TRACER_STATS
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <tracer/tracer.h>
+#include <tracer/accelerators/bvh-quality.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+#include <benchmark/workloads.h>
+#ifdef INSPECT_ASSIMP
+#include <import/assimp.h>
+#endif
+
+/**
+ * Quality of the acceleration structure (Bvh) of a scene, for several builder settings: build
+ * time, SAH cost, depth and leaf sizes (objects and packs), overlap between siblings and empty space in nodes (see
+ * tracer/accelerators/bvh-quality.h), and the nodes and primitives that the standard workloads
+ * (see benchmark/workloads.h) actually visit per ray.
+ *
+ * Usage: inspect [--scene name] [--leaf n,n,...] [--bins n,n,...] [--traversal cost] [--intersection cost]
+ *                [--width w] [--height h] [--histograms] [model]
+ * A leaf size of 0 is the one tuned for the primitives (see BvhSettings), the first one by default.
+ * Scenes: terrain (2x256x256 triangles), sphere (a 2x256x512 triangle mesh), spheres (100000 spheres
+ * spread uniformly), clusters (100000 spheres in 64 clusters), or the model, if assimp is available.
+ **/
+
+std::vector<int> integers(const std::string& s) {
+	std::vector<int> sol; std::stringstream ss(s); std::string item;
+	while (std::getline(ss, item, ',')) sol.push_back(std::stoi(item));
+	return sol;
+}
+
+std::string histogram(const std::vector<std::size_t>& h) {
+	std::ostringstream sol;
+	for (std::size_t i = 0; i<h.size(); ++i) if (h[i] > 0) sol<<" "<<i<<":"<<h[i];
+	return sol.str();
+}
+
+std::vector<tracer::Sphere> spheres(int n, int clusters) {
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	std::normal_distribution<float> normal(0.0f,0.05f);
+	std::vector<Eigen::Vector3f> centers;
+	for (int c = 0; c<clusters; ++c) centers.push_back(Eigen::Vector3f(uniform(random), uniform(random), uniform(random)));
+	std::vector<tracer::Sphere> sol;
+	for (int i = 0; i<n; ++i) {
+		Eigen::Vector3f p = (clusters > 0) ? Eigen::Vector3f(centers[i%clusters] + Eigen::Vector3f(normal(random), normal(random), normal(random))) :
+		                                     Eigen::Vector3f(uniform(random), uniform(random), uniform(random));
+		sol.push_back(tracer::Sphere(p, 0.004f));
+	}
+	return sol;
+}
+
+template<typename P>
+void inspect(const std::vector<P>& primitives, const tracer::Pinhole& camera, const Eigen::Vector3f& light, int w, int h,
+             const std::vector<int>& leaves, const std::vector<int>& bins, const tracer::BvhSettings& base, bool histograms) {
+	std::cout<<std::setw(5)<<"leaf"<<std::setw(5)<<"bins"<<std::setw(11)<<"build (s)"<<std::setw(9)<<"nodes"<<std::setw(7)<<"depth"
+	         <<std::setw(5)<<"max"<<std::setw(7)<<"leaf"<<std::setw(7)<<"packs"<<std::setw(9)<<"SAH"<<std::setw(9)<<"overlap"<<std::setw(8)<<"empty";
+	for (const char* workload : { "primary", "diffuse", "shadow", "miss" }) std::cout<<std::setw(16)<<(std::string(workload) + " n/p");
+	std::cout<<std::endl;
+	for (int leaf : leaves) for (int b : bins) {
+		tracer::BvhSettings settings = base;
+		settings.max_leaf_size = leaf; settings.bins = b;
+		std::unique_ptr<tracer::Bvh<P>> bvh;
+		double build_seconds = benchmark::seconds([&] () { bvh = std::make_unique<tracer::Bvh<P>>(primitives, settings); });
+		tracer::BvhQuality q = tracer::quality(*bvh);
+		std::cout<<std::setw(5)<<bvh->settings().max_leaf_size<<std::setw(5)<<b<<std::fixed<<std::setprecision(3)<<std::setw(11)<<build_seconds
+		         <<std::setw(9)<<q.nodes<<std::setprecision(1)<<std::setw(7)<<q.average_depth()<<std::setw(5)<<q.max_depth()
+		         <<std::setw(7)<<q.average_leaf_size()<<std::setw(7)<<q.average_leaf_packs()<<std::setw(9)<<q.sah_cost<<std::setprecision(3)
+		         <<std::setw(9)<<q.weighted_overlap<<std::setw(8)<<q.weighted_empty_space;
+		for (const benchmark::Workload& workload : benchmark::workloads(*bvh, camera, light, w, h)) {
+			tracer::stats::reset();
+			benchmark::trace(*bvh, workload);
+			tracer::Counters c = tracer::stats::total();
+			double rays = double(std::max<std::size_t>(workload.rays.size(), 1));
+			std::ostringstream visited; visited<<std::fixed<<std::setprecision(1)<<double(c.nodes)/rays<<"/"<<double(c.primitives())/rays;
+			std::cout<<std::setw(16)<<visited.str();
+		}
+		std::cout<<std::defaultfloat<<std::endl;
+		if (histograms) {
+			std::cout<<"      depths:"<<histogram(q.depths)<<std::endl;
+			std::cout<<"      leaf sizes:"<<histogram(q.leaf_sizes)<<std::endl;
+			std::cout<<"      leaf packs:"<<histogram(q.leaf_packs)<<std::endl;
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	std::string scene = "terrain", model;
+	std::vector<int> leaves{0, 1, 2, 4, 8}, bins{16};
+	tracer::BvhSettings settings;
+	int w = 128, h = 128;
+	bool histograms = false;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--scene") && (i+1<argc))        scene = argv[++i];
+		else if ((arg == "--leaf") && (i+1<argc))         leaves = integers(argv[++i]);
+		else if ((arg == "--bins") && (i+1<argc))         bins = integers(argv[++i]);
+		else if ((arg == "--traversal") && (i+1<argc))    settings.traversal_cost = std::stof(argv[++i]);
+		else if ((arg == "--intersection") && (i+1<argc)) settings.intersection_cost = std::stof(argv[++i]);
+		else if ((arg == "--width") && (i+1<argc))        w = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))       h = std::stoi(argv[++i]);
+		else if (arg == "--histograms")                   histograms = true;
+		else model = arg;
+	}
+
+	if (!model.empty()) {
+#ifdef INSPECT_ASSIMP
+		std::vector<tracer::Triangle> triangles = import_triangles(model);
+		tracer::Bounds bounds;
+		for (const tracer::Triangle& t : triangles) bounds.extend(t.bounds());
+		float radius = 0.5f*(bounds.max() - bounds.min()).norm();
+		std::cout<<model<<": "<<triangles.size()<<" triangles"<<std::endl;
+		inspect(triangles, tracer::Pinhole(bounds.center() - Eigen::Vector3f(0,0,2.5f*radius), Eigen::Vector3f(0,0,2), Eigen::Vector3f(0,1,0)),
+			bounds.center() + Eigen::Vector3f(0,2.0f*radius,-radius), w, h, leaves, bins, settings, histograms);
+#else
+		std::cerr<<"Built without assimp: cannot load "<<model<<std::endl;
+		return 1;
+#endif
+	} else if ((scene == "terrain") || (scene == "sphere")) {
+		std::vector<tracer::Triangle> triangles = (scene == "terrain") ? scenes::terrain_triangles(256) : scenes::sphere_triangles(256);
+		std::cout<<scene<<": "<<triangles.size()<<" triangles"<<std::endl;
+		if (scene == "terrain")
+			inspect(triangles, tracer::Pinhole(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6)),
+				Eigen::Vector3f(0.0f,3.0f,0.0f), w, h, leaves, bins, settings, histograms);
+		else
+			inspect(triangles, tracer::Pinhole(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0)),
+				Eigen::Vector3f(2.0f,3.0f,-2.0f), w, h, leaves, bins, settings, histograms);
+	} else if ((scene == "spheres") || (scene == "clusters")) {
+		std::vector<tracer::Sphere> s = spheres(100000, (scene == "clusters") ? 64 : 0);
+		std::cout<<scene<<": "<<s.size()<<" spheres"<<std::endl;
+		inspect(s, tracer::Pinhole(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0)),
+			Eigen::Vector3f(0.0f,3.0f,-3.0f), w, h, leaves, bins, settings, histograms);
+	} else {
+		std::cerr<<"Unknown scene "<<scene<<std::endl;
+		return 1;
+	}
+}
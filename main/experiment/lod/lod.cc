@@ -0,0 +1,112 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <import/simplify.h>
+#include <render/parallel.h>
+#include <benchmark/benchmark.h>
+#include <cimg-all.h>
+
+/**
+ * A row of instances of a dense sphere mesh going into the distance, rendered with the exact
+ * geometry (rays without a cone) and with the levels of detail picked by the footprint of each
+ * pixel, with a shadow ray towards a directional light from every hit. Shadow rays are spawned
+ * from the hits (Hit::spawn), so they keep the footprint and see the same level; a third render
+ * casts them without it, to show the acne of coarse levels against the exact one. Reports the
+ * time, how different the images are from the exact one (lod-exact.hdr, lod-footprint.hdr,
+ * lod-no-spawn.hdr) and the memory of the levels that stay resident once the ones no ray needed
+ * are released.
+ *
+ * Usage: lod [sphere resolution] [width] [instances]
+ **/
+using Mesh = decltype(lod_mesh(std::vector<tracer::Triangle>()));
+
+std::size_t triangles(const Mesh& mesh, int level) {
+	std::size_t sol = 0;
+	for (const auto& pack : mesh.level(level).objects()) sol += std::size_t(pack.size());
+	return sol;
+}
+
+std::size_t resident_bytes(const Mesh& mesh) {
+	std::size_t sol = 0;
+	for (int l = 0; l<mesh.levels(); ++l)
+		if (mesh.resident(l)) sol += mesh.level(l).objects().size()*sizeof(typename std::decay_t<decltype(mesh.level(l).objects())>::value_type);
+	return sol;
+}
+
+tracer::Scene row(const Mesh& mesh, int instances) {
+	tracer::Scene scene;
+	//Fanned out across the view, so that none hides the ones behind
+	for (int i = 0; i<instances; ++i) {
+		float z = 16.0f*std::pow(1.3f, float(i));
+		float x = 0.7f - 1.4f*float(i)/float(std::max(instances - 1, 1));
+		scene.add(tracer::Instance(Eigen::Translation3f(x*z, 0.3f*z*((i%2) ? 1.0f : -1.0f), z), mesh));
+	}
+	return scene;
+}
+
+int main(int argc, char** argv) {
+	int n = (argc > 1) ? std::stoi(argv[1]) : 96;
+	int w = (argc > 2) ? std::stoi(argv[2]) : 256;
+	int h = w;
+	int instances = (argc > 3) ? std::stoi(argv[3]) : 12;
+
+	std::vector<tracer::Triangle> sphere = scenes::sphere_triangles(n);
+	std::optional<Mesh> exact, footprint, no_spawn;
+	double build = benchmark::seconds([&] () { exact.emplace(lod_mesh(sphere)); });
+	//Their own levels, so the other renders do not count as using them
+	footprint.emplace(lod_mesh(sphere));
+	no_spawn.emplace(lod_mesh(sphere));
+
+	std::cout<<"Levels of the mesh (built in "<<build<<"s):"<<std::endl;
+	for (int l = 0; l<exact->levels(); ++l)
+		std::cout<<"  "<<l<<": "<<std::setw(8)<<triangles(*exact, l)<<" triangles, error "<<exact->error(l)<<std::endl;
+
+	tracer::Scene exact_scene = row(*exact, instances), footprint_scene = row(*footprint, instances), no_spawn_scene = row(*no_spawn, instances);
+	tracer::Pinhole camera(Eigen::Vector3f(0, 0, -1), Eigen::Vector3f(0, 0, 1), Eigen::Vector3f(0, 1, 0));
+	Eigen::Vector3f light = Eigen::Vector3f(1.0f, 2.0f, -1.0f).normalized();
+
+	const float eps = 1.e-4f;
+	auto render = [&] (const tracer::Scene& scene, bool cone, bool spawn) {
+		cimg_library::CImg<float> image(w,h,1,3,0.0f);
+		render::parallel_for(h, [&] (int j) {
+			for (int i = 0; i<w; ++i) {
+				float u = (float(i) + 0.5f)*2.0f/float(w) - 1.0f, v = (float(j) + 0.5f)*2.0f/float(h) - 1.0f;
+				auto hit = scene.trace(cone ? camera.ray(u, v, 2.0f/float(w)) : camera.ray(u, v));
+				if (!hit) continue;
+				float shading = std::max(hit->normal().dot(light), 0.0f);
+				if ((shading > 0.0f) && scene.trace_shadow(spawn ? hit->spawn(light, eps) : tracer::Ray(hit->point(), light, eps))) shading = 0.0f;
+				for (int c = 0; c<3; ++c) image(i,j,0,c) = std::max(shading, 0.05f);
+			}
+		});
+		return image;
+	};
+	cimg_library::CImg<float> exact_image, footprint_image, no_spawn_image;
+	double exact_seconds = benchmark::seconds([&] () { exact_image = render(exact_scene, false, true); });
+	double footprint_seconds = benchmark::seconds([&] () { footprint_image = render(footprint_scene, true, true); });
+	double no_spawn_seconds = benchmark::seconds([&] () { no_spawn_image = render(no_spawn_scene, true, false); });
+
+	auto report = [&] (const std::string& name, double seconds, const cimg_library::CImg<float>& image) {
+		double difference = 0.0;
+		std::size_t differ = 0;
+		for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+			float d = std::abs(exact_image(i,j,0,0) - image(i,j,0,0));
+			difference += d;
+			if (d > 0.1f) ++differ;
+		}
+		std::cout<<std::setw(12)<<(name + ": ")<<seconds<<"s ("<<exact_seconds/seconds<<"x), mean difference "
+			<<difference/double(w*h)<<", "<<differ<<" pixels differ by more than 0.1"<<std::endl;
+	};
+	std::cout<<std::setw(12)<<"exact: "<<exact_seconds<<"s"<<std::endl;
+	report("footprint", footprint_seconds, footprint_image);
+	report("no spawn", no_spawn_seconds, no_spawn_image);
+
+	std::size_t before = resident_bytes(*footprint);
+	std::cout<<"Finest level used: "<<footprint->finest_used()<<", "<<footprint->trim()<<" levels released"<<std::endl;
+	std::cout<<"Resident packs: "<<before/1024<<"KiB -> "<<resident_bytes(*footprint)/1024<<"KiB"<<std::endl;
+
+	exact_image.save("lod-exact.hdr");
+	footprint_image.save("lod-footprint.hdr");
+	no_spawn_image.save("lod-no-spawn.hdr");
+}
@@ -0,0 +1,62 @@
+#include <array>
+#define MATERIAL std::array<float,3>
+
+#include <iostream>
+#include <string>
+#include <cmath>
+#include <tracer/tracer.h>
+#include <render/gbuffer.h>
+#include <benchmark/benchmark.h>
+#include <cimg-all.h>
+
+/**
+ * A look-dev session: the colors of the materials change between renders but the camera and
+ * the geometry do not, so only the first render traces rays (lookdev-<k>.hdr).
+ *
+ * Usage: lookdev [spheres per side] [renders]
+ **/
+
+int main(int argc, char** argv) {
+	int n = (argc > 1) ? std::stoi(argv[1]) : 64;
+	int renders = (argc > 2) ? std::stoi(argv[2]) : 4;
+	int w = 512;
+	int h = 512;
+
+	std::vector<std::shared_ptr<MATERIAL>> materials;
+	for (int m = 0; m<6; ++m) materials.push_back(std::make_shared<MATERIAL>(MATERIAL{0.5f,0.5f,0.5f}));
+
+	tracer::Scene scene;
+	scene.add(tracer::Plane(Eigen::Vector3f(0,1,0), Eigen::Vector3f(0,0,0)).set_material(std::make_shared<MATERIAL>(MATERIAL{0.8f,0.8f,0.8f})));
+	std::vector<tracer::Sphere> spheres;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<n; ++i) {
+		float r = 0.2f + 0.15f*std::sin(float(3*i+7*j));
+		spheres.push_back(tracer::Sphere(Eigen::Vector3f(float(i) - 0.5f*float(n), r, float(j)), r));
+		if ((spheres.size() == 8) || ((i == n-1) && (j == n-1))) {
+			scene.add(tracer::pack<8>(spheres).set_material(materials[scene.objects().size() % materials.size()]));
+			spheres.clear();
+		}
+	}
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+	Eigen::Vector3f light = Eigen::Vector3f(1.0f,2.0f,-1.0f).normalized();
+	render::PrimaryHitCache cache;
+	cimg_library::CImg<float> output(w,h,1,3);
+
+	for (int k = 0; k<renders; ++k) {
+		//The tweak: a new palette for every render
+		for (std::size_t m = 0; m<materials.size(); ++m)
+			*materials[m] = MATERIAL{0.5f + 0.5f*std::sin(float(k + 3*m)), 0.5f + 0.5f*std::sin(float(2*k + m + 2)), 0.5f + 0.5f*std::sin(float(k*m + 4))};
+
+		bool traced = false;
+		double trace_seconds = benchmark::seconds([&] () { traced = cache.update(scene, camera, w, h); });
+		double shade_seconds = benchmark::seconds([&] () {
+			cache.shade([&] (int i, int j, const tracer::Ray& ray, const std::optional<tracer::Hit>& hit) {
+				float diffuse = hit ? std::max(0.0f, hit->normal().dot(light)) : 0.0f;
+				for (int c = 0; c<3; ++c) output(i,j,0,c) = (hit && hit->material()) ? (0.1f + 0.9f*diffuse)*hit->material()->at(c) : 0.0f;
+			});
+		});
+		std::string filename = "lookdev-" + std::to_string(k) + ".hdr";
+		std::cout<<filename<<": "<<(traced?"traced":"cached")<<" in "<<trace_seconds<<"s, shaded in "<<shade_seconds<<"s"<<std::endl;
+		output.save(filename.c_str());
+	}
+}
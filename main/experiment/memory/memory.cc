@@ -0,0 +1,106 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <functional>
+#include <random>
+#include <tracer/tracer.h>
+#include <scenes/cornell-box.h>
+#include <scenes/procedural.h>
+#include <import/simplify.h>
+#ifdef MEMORY_ASSIMP
+#include <import/assimp.h>
+#endif
+
+/**
+ * Memory footprint of scenes, by category (see tracer/memory.h): procedural scenes, the same
+ * geometry stored in different ways (triangles, packs, compressed, instanced by value or shared,
+ * levels of detail, in an arena or not) and, if assimp is available, the models given as arguments.
+ *
+ * Usage: memory [--detail] [--terrain n] [--spheres n] [model ...]
+ **/
+
+struct MemoryScene {
+	std::string name;
+	std::function<tracer::Scene()> build;
+};
+
+//Individual spheres, each one its own object (and allocation, unless there is an arena)
+tracer::Scene spheres(int n, const std::shared_ptr<tracer::Arena>& arena) {
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	tracer::Scene scene(arena);
+	scene.reserve(std::size_t(n));
+	for (int i = 0; i<n; ++i) scene.add(tracer::Sphere(Eigen::Vector3f(uniform(random), uniform(random), uniform(random)), 0.01f));
+	return scene;
+}
+
+//A 4x4 grid of copies of the same mesh, either copied into every instance or shared by all of them
+tracer::Scene instances(bool shared) {
+	using Mesh = tracer::List<tracer::Pack<tracer::Triangle,tracer::pack_width_v<tracer::Triangle>>>;
+	Mesh mesh(tracer::packs(scenes::sphere_triangles(64)));
+	const tracer::Object object(mesh);
+	tracer::Scene scene;
+	for (int j = 0; j<4; ++j) for (int i = 0; i<4; ++i) {
+		Eigen::Affine3f transform(Eigen::Translation3f(3.0f*float(i), 0.0f, 3.0f*float(j)));
+		if (shared) scene.add(tracer::Instance<>(transform, object));
+		else        scene.add(tracer::Instance<Mesh>(transform, mesh));
+	}
+	return scene;
+}
+
+int main(int argc, char** argv) {
+	bool detail = false;
+	int terrain = 256, sphere_count = 100000;
+	std::vector<std::string> models;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      (arg == "--detail")                  detail = true;
+		else if ((arg == "--terrain") && (i+1<argc)) terrain = std::stoi(argv[++i]);
+		else if ((arg == "--spheres") && (i+1<argc)) sphere_count = std::stoi(argv[++i]);
+		else models.push_back(arg);
+	}
+
+	std::vector<MemoryScene> scenes;
+	scenes.push_back(MemoryScene{"cornell-box", [] () { return scenes::cornell_box(); }});
+	scenes.push_back(MemoryScene{"sphere-field", [] () { return scenes::sphere_field(64); }});
+	scenes.push_back(MemoryScene{"spheres", [=] () { return spheres(sphere_count, nullptr); }});
+	scenes.push_back(MemoryScene{"spheres-arena", [=] () { return spheres(sphere_count, std::make_shared<tracer::Arena>()); }});
+	scenes.push_back(MemoryScene{"terrain-list", [=] () {
+		tracer::Scene sol;
+		sol.add(tracer::list(scenes::terrain_triangles(terrain)));
+		return sol; }});
+	scenes.push_back(MemoryScene{"terrain", [=] () { return scenes::terrain(terrain); }});
+	scenes.push_back(MemoryScene{"terrain-compressed", [=] () { return scenes::compressed_terrain(terrain); }});
+	scenes.push_back(MemoryScene{"terrain-lod", [=] () {
+		tracer::Scene sol;
+		sol.add(lod_mesh(scenes::terrain_triangles(terrain)));
+		return sol; }});
+	scenes.push_back(MemoryScene{"instances-copied", [] () { return instances(false); }});
+	scenes.push_back(MemoryScene{"instances-shared", [] () { return instances(true); }});
+#ifdef MEMORY_ASSIMP
+	for (const std::string& model : models) {
+		scenes.push_back(MemoryScene{model, [model] () {
+			tracer::Scene sol;
+			for (const auto& pack : tracer::packs(import_triangles(model))) sol.add(pack);
+			return sol; }});
+	}
+#else
+	if (!models.empty()) std::cerr<<"Built without assimp: ignoring "<<models.size()<<" model(s)."<<std::endl;
+#endif
+
+	if (!detail) {
+		std::cout<<std::setw(20)<<"scene";
+		for (const char* name : tracer::MemoryUsage::names) std::cout<<std::setw(12)<<name;
+		std::cout<<std::setw(12)<<"total"<<std::endl;
+	}
+	for (const MemoryScene& s : scenes) {
+		tracer::Scene scene = s.build();
+		tracer::MemoryUsage usage = tracer::memory_usage(scene);
+		if (detail) std::cout<<s.name<<" ("<<scene.objects().size()<<" objects)"<<std::endl<<usage<<std::endl;
+		else {
+			std::cout<<std::setw(20)<<s.name;
+			for (int c = 0; c<tracer::MemoryUsage::categories; ++c) std::cout<<std::setw(12)<<tracer::human_bytes(usage[tracer::MemoryUsage::Category(c)]);
+			std::cout<<std::setw(12)<<tracer::human_bytes(usage.total())<<std::endl;
+		}
+	}
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <render/numa.h>
+#include <render/parallel.h>
+#include <render/framebuffer.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Renders the sphere field with the scene shared by every NUMA node and with one replica per node
+ * (plus the usual unpinned parallel_for as a reference), and reports the time of each placement.
+ * Tile buffers are allocated by the thread that renders the tile, so they are local to its node.
+ *
+ * Usage: numa [width] [spheres per side] [repetitions]
+ **/
+int main(int argc, char** argv) {
+	int w = (argc > 1) ? std::stoi(argv[1]) : 1024;
+	int h = w;
+	int n = (argc > 2) ? std::stoi(argv[2]) : 32;
+	int repetitions = (argc > 3) ? std::stoi(argv[3]) : 3;
+
+	render::numa::Topology topology = render::numa::Topology::detect();
+	std::cout<<topology.size()<<" NUMA node(s):";
+	for (const render::numa::Node& node : topology.nodes()) std::cout<<" node"<<node.id<<" ("<<node.cpus.size()<<" CPUs)";
+	std::cout<<std::endl;
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+	std::vector<tracer::Tile> tiles = tracer::tiles(w, h, 32);
+	auto render_tile = [&] (const tracer::Scene& scene, const tracer::Tile& tile) {
+		render::TileBuffer buffer(tile.size());
+		buffer.set_tile(tile);
+		for (const std::array<int,2>& p : tracer::pixels(tile)) {
+			std::optional<tracer::Hit> hit = scene.trace(camera.ray((float(p[0]) + 0.5f)*2.0f/float(w) - 1.0f, (float(p[1]) + 0.5f)*2.0f/float(h) - 1.0f));
+			float c = hit ? std::abs(hit->normal()[1]) : 0.0f;
+			buffer.set(p[0], p[1], c, c, c);
+		}
+	};
+
+	auto report = [&] (const std::string& name, auto&& render) {
+		std::vector<double> times;
+		for (int r = 0; r<repetitions; ++r) times.push_back(benchmark::seconds(render));
+		benchmark::Statistics s = benchmark::statistics(times);
+		std::cout<<name<<": "<<s.median<<"s (min "<<s.min<<"s, max "<<s.max<<"s)"<<std::endl;
+	};
+
+	{
+		tracer::Scene scene = scenes::sphere_field(n);
+		report("unpinned, shared scene", [&] () {
+			render::parallel_for(int(tiles.size()), [&] (int t) { render_tile(scene, tiles[t]); });
+		});
+	}
+	for (render::numa::Placement placement : {render::numa::Placement::shared, render::numa::Placement::replicated}) {
+		render::numa::Replicated<tracer::Scene> scene(topology, [n] () { return scenes::sphere_field(n); }, placement);
+		std::string name = (placement == render::numa::Placement::shared) ? "pinned, shared scene" : "pinned, replicated scene";
+		report(name + " (" + std::to_string(scene.copies()) + " copies)", [&] () {
+			render::numa::parallel_for(topology, int(tiles.size()), [&] (int t, int node) { render_tile(scene[node], tiles[t]); });
+		});
+	}
+}
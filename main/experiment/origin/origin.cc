@@ -0,0 +1,93 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <random>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Primary rays of a Pinhole and shadow rays towards a point light (traced backwards, from the
+ * light) against packs of planes, spheres and triangles, as they are and seen from the fixed
+ * origin of the camera or the light. Reports the time of each (in a single thread) and checks
+ * that both find the same hits.
+ *
+ * Usage: origin [resolution of the meshes] [width] [height]
+ **/
+template<typename O>
+void compare(const std::string& name, const tracer::List<O>& list, const tracer::Pinhole& camera, const Eigen::Vector3f& light, int w, int h) {
+	Eigen::Vector3f eye = camera.transform().block<3,1>(0,3);
+	std::vector<tracer::Ray> primary;
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i)
+		primary.push_back(camera.ray((float(i) + 0.5f)*2.0f/float(w) - 1.0f, (float(j) + 0.5f)*2.0f/float(h) - 1.0f));
+
+	std::vector<float> distances(primary.size()), fixed_distances(primary.size());
+	auto trace = [&] (const auto& objects, std::vector<float>& sol) {
+		for (std::size_t r = 0; r<primary.size(); ++r) {
+			auto hit = objects.trace(primary[r]);
+			sol[r] = hit ? hit->distance() : -1.0f;
+		}
+	};
+	double primary_seconds = benchmark::seconds([&] () { trace(list, distances); });
+	double primary_fixed_seconds = benchmark::seconds([&] () { trace(tracer::fixed_origin(list, eye), fixed_distances); });
+	std::size_t hits = 0, mismatches = 0;
+	for (std::size_t r = 0; r<primary.size(); ++r) {
+		if (distances[r] >= 0.0f) ++hits;
+		if (std::abs(distances[r] - fixed_distances[r]) > 1.e-3f*std::max(1.0f, distances[r])) ++mismatches;
+	}
+
+	std::vector<tracer::Ray> shadow;
+	for (std::size_t r = 0; r<primary.size(); ++r)
+		if (distances[r] >= 0.0f) shadow.push_back(tracer::ray_to(light, primary[r].at(distances[r]), 1.e-3f));
+	std::vector<char> occluded(shadow.size()), fixed_occluded(shadow.size());
+	auto trace_shadow = [&] (const auto& objects, std::vector<char>& sol) {
+		for (std::size_t r = 0; r<shadow.size(); ++r) sol[r] = objects.trace_shadow(shadow[r]);
+	};
+	double shadow_seconds = benchmark::seconds([&] () { trace_shadow(list, occluded); });
+	double shadow_fixed_seconds = benchmark::seconds([&] () { trace_shadow(tracer::fixed_origin(list, light), fixed_occluded); });
+	std::size_t shadowed = 0, shadow_mismatches = 0;
+	for (std::size_t r = 0; r<shadow.size(); ++r) {
+		if (occluded[r]) ++shadowed;
+		if (occluded[r] != fixed_occluded[r]) ++shadow_mismatches;
+	}
+
+	std::cout<<std::setw(10)<<name<<std::setw(12)<<primary_seconds<<std::setw(12)<<primary_fixed_seconds
+	         <<std::setw(9)<<std::setprecision(3)<<primary_seconds/primary_fixed_seconds<<"x"<<std::setprecision(6)
+	         <<std::setw(12)<<shadow_seconds<<std::setw(12)<<shadow_fixed_seconds
+	         <<std::setw(9)<<std::setprecision(3)<<shadow_seconds/shadow_fixed_seconds<<"x"<<std::setprecision(6)
+	         <<std::setw(10)<<hits<<std::setw(10)<<shadowed<<std::setw(12)<<(mismatches + shadow_mismatches)<<std::endl;
+}
+
+int main(int argc, char** argv) {
+	int n = (argc > 1) ? std::stoi(argv[1]) : 48;
+	int w = (argc > 2) ? std::stoi(argv[2]) : 128;
+	int h = (argc > 3) ? std::stoi(argv[3]) : w;
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6));
+	Eigen::Vector3f light(0.5f, 2.0f, 0.0f);
+
+	//Planes all around, at different distances
+	std::mt19937 random(0);
+	std::normal_distribution<float> normal;
+	std::uniform_real_distribution<float> offset(2.0f, 6.0f);
+	std::vector<tracer::Plane> planes;
+	for (int k = 0; k<n; ++k) {
+		Eigen::Vector3f d = Eigen::Vector3f(normal(random), normal(random), normal(random)).normalized();
+		planes.push_back(tracer::Plane(d, offset(random)*d));
+	}
+	//A field of spheres over [-1,1]x[-1,1]
+	std::vector<tracer::Sphere> spheres;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<n; ++i) {
+		float r = (0.6f + 0.3f*std::sin(float(3*i+7*j)))/float(n);
+		spheres.push_back(tracer::Sphere(Eigen::Vector3f(2.0f*(float(i) + 0.5f)/float(n) - 1.0f, r, 2.0f*(float(j) + 0.5f)/float(n) - 1.0f), r));
+	}
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(n);
+
+	std::cout<<w<<"x"<<h<<" rays, "<<planes.size()<<" planes, "<<spheres.size()<<" spheres, "<<triangles.size()<<" triangles"<<std::endl;
+	std::cout<<std::setw(10)<<"packs"<<std::setw(12)<<"primary (s)"<<std::setw(12)<<"fixed (s)"<<std::setw(10)<<"speedup"
+	         <<std::setw(12)<<"shadow (s)"<<std::setw(12)<<"fixed (s)"<<std::setw(10)<<"speedup"
+	         <<std::setw(10)<<"hits"<<std::setw(10)<<"shadowed"<<std::setw(12)<<"mismatches"<<std::endl;
+	compare("planes", tracer::List(tracer::packs(planes)), camera, light, w, h);
+	compare("spheres", tracer::List(tracer::packs(spheres)), camera, light, w, h);
+	compare("triangles", tracer::List(tracer::packs(triangles)), camera, light, w, h);
+}
@@ -0,0 +1,40 @@
+#include <iostream>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/cornell-box.h>
+#include <render/parallel.h>
+#include <render/framebuffer.h>
+
+/**
+ * Normal map of the cornell box at any resolution (poster.pfm), streamed to disk tile by tile 
+ * so memory does not depend on the resolution.
+ *
+ * Usage: poster [width] [height]
+ **/
+int main(int argc, char** argv) {
+	tracer::Scene scene = scenes::cornell_box();
+
+	int w = (argc > 1) ? std::stoi(argv[1]) : 8192;
+	int h = (argc > 2) ? std::stoi(argv[2]) : w;
+
+	render::StreamingFramebuffer output("poster.pfm", w, h);
+
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+
+	std::vector<tracer::Tile> tiles = output.tiles();
+	render::parallel_for(int(tiles.size()), [&] (int t) {
+		std::unique_ptr<render::TileBuffer> tile = output.acquire(tiles[t]);
+		std::vector<std::array<int,2>> pixels = tracer::pixels(tiles[t]);
+		for (std::size_t p = 0; p<pixels.size(); p+=8) {
+			tracer::RayBlock<8> rays = camera.rays<8>(&pixels[p], int(std::min<std::size_t>(8,pixels.size()-p)), w, h);
+			for (int k = 0; k<rays.size(); ++k) {
+				std::optional<tracer::Hit> hit = scene.trace(rays.ray(k));
+				if (hit) tile->set(pixels[p+k][0], pixels[p+k][1], 0.5f*hit->normal()[0] + 0.5f, 0.5f*hit->normal()[1] + 0.5f, 0.5f*hit->normal()[2] + 0.5f);
+				else     tile->set(pixels[p+k][0], pixels[p+k][1], 0.0f, 0.0f, 0.0f);
+			}
+		}
+		output.commit(std::move(tile));
+	});
+	output.close();
+	std::cout<<"poster.pfm ("<<w<<"x"<<h<<"), at most "<<output.max_bytes()/(1024*1024)<<" MB in tile buffers"<<std::endl;
+}
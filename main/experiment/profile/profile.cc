@@ -0,0 +1,59 @@
+#define TRACER_PROFILE
+
+#include <iostream>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <render/gbuffer.h>
+#include <render/framebuffer.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Renders the sphere field with every phase timed (scene build, tracing and shading of each tile,
+ * image write) and saves the timeline as profile.json, to be opened in Perfetto or 
+ * chrome://tracing. The overhead is estimated from the cost of an empty scope.
+ *
+ * Usage: profile [width] [spheres per side]
+ **/
+int main(int argc, char** argv) {
+	int w = (argc > 1) ? std::stoi(argv[1]) : 1024;
+	int h = w;
+	int n = (argc > 2) ? std::stoi(argv[2]) : 32;
+
+	double total = benchmark::seconds([&] () {
+		tracer::Scene scene = scenes::sphere_field(n);
+		tracer::Pinhole camera(Eigen::Vector3f( 0, 4, -6), Eigen::Vector3f( 0, -0.8, 1.6), Eigen::Vector3f( 0, 1.6, 0.8));
+		Eigen::Vector3f light = Eigen::Vector3f(1.0f,2.0f,-1.0f).normalized();
+
+		render::PrimaryHitCache cache;
+		cache.update(scene, camera, w, h);
+
+		render::StreamingFramebuffer output("profile.pfm", w, h);
+		std::vector<tracer::Tile> tiles = output.tiles();
+		render::parallel_for(int(tiles.size()), [&] (int t) {
+			std::unique_ptr<render::TileBuffer> tile = output.acquire(tiles[t]);
+			{
+				TRACER_PROFILE_SCOPE("shade tile", t);
+				for (const std::array<int,2>& p : tracer::pixels(tiles[t])) {
+					const std::optional<tracer::Hit>& hit = cache.hit(p[0],p[1]);
+					float c = hit ? 0.1f + 0.9f*std::max(0.0f, hit->normal().dot(light)) : 0.0f;
+					tile->set(p[0], p[1], c, c, c);
+				}
+			}
+			output.commit(std::move(tile));
+		});
+		TRACER_PROFILE_SCOPE("write image");
+		output.close();
+	});
+
+	std::size_t events = tracer::profiler::events();
+	tracer::profiler::write("profile.json");
+
+	//Cost of a scope, measured on an empty one
+	const int repetitions = 1000000;
+	double scope = benchmark::seconds([] () { for (int i = 0; i<repetitions; ++i) { TRACER_PROFILE_SCOPE("empty"); } })/double(repetitions);
+	tracer::profiler::reset();
+
+	std::cout<<"Rendered "<<w<<"x"<<h<<" in "<<total<<"s, "<<events<<" events saved to profile.json"<<std::endl;
+	std::cout<<"A scope costs "<<scope*1.e9<<"ns, an overhead of about "<<100.0*double(events)*scope/total<<"%"<<std::endl;
+}
@@ -0,0 +1,79 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <render/parallel.h>
+#include <render/visibility.h>
+#include <benchmark/benchmark.h>
+#include <cimg-all.h>
+
+/**
+ * Primary visibility of the terrain mesh from the same Pinhole, ray traced (tile by tile, with
+ * frustum culling) and rasterized into a visibility buffer. Both build the same Hits, which are
+ * compared. Then the hybrid mode: rasterized primary hits and traced shadow rays
+ * (raster-normals.hdr, raster-shadows.hdr).
+ *
+ * Usage: raster [terrain resolution] [width] [height]
+ **/
+int main(int argc, char** argv) {
+	int n = (argc > 1) ? std::stoi(argv[1]) : 128;
+	int w = (argc > 2) ? std::stoi(argv[2]) : 512;
+	int h = (argc > 3) ? std::stoi(argv[3]) : w;
+
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(n);
+	tracer::Scene scene = scenes::terrain(n);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 1.5, -2), Eigen::Vector3f( 0, -1.2, 1.6), Eigen::Vector3f( 0, 0.8, 0.6));
+	Eigen::Vector3f light(0.0f,3.0f,0.0f);
+	std::cout<<triangles.size()<<" triangles, "<<w<<"x"<<h<<std::endl;
+
+	std::vector<std::optional<tracer::Hit>> traced(std::size_t(w)*h), rasterized(std::size_t(w)*h);
+	std::vector<tracer::Tile> tiles = tracer::tiles(w,h,16);
+	double trace_seconds = benchmark::seconds([&] () {
+		render::parallel_for(int(tiles.size()), [&] (int t) {
+			auto candidates = tracer::cull(scene, camera.frustum(tiles[t],w,h));
+			for (const std::array<int,2>& p : tracer::pixels(tiles[t]))
+				traced[std::size_t(p[1])*w + p[0]] = candidates.trace(camera.ray((float(p[0]) + 0.5f)*2.0f/float(w) - 1.0f, (float(p[1]) + 0.5f)*2.0f/float(h) - 1.0f));
+		});
+	});
+
+	double raster_seconds = benchmark::seconds([&] () {
+		render::VisibilityBuffer visibility = render::visibility(triangles, camera, w, h);
+		render::parallel_for(h, [&] (int j) {
+			for (int i = 0; i<w; ++i) rasterized[std::size_t(j)*w + i] = visibility.hit(triangles, i, j);
+		});
+	});
+
+	std::size_t hits = 0, coverage = 0, depth = 0;
+	for (std::size_t p = 0; p<traced.size(); ++p) {
+		if (traced[p]) ++hits;
+		if (bool(traced[p]) != bool(rasterized[p])) ++coverage;
+		else if (traced[p] && (std::abs(traced[p]->distance() - rasterized[p]->distance()) > 1.e-3f*traced[p]->distance())) ++depth;
+	}
+	std::cout<<std::setw(12)<<"traced: "<<trace_seconds<<"s"<<std::endl;
+	std::cout<<std::setw(12)<<"rasterized: "<<raster_seconds<<"s ("<<trace_seconds/raster_seconds<<"x)"<<std::endl;
+	std::cout<<hits<<" hits, "<<coverage<<" pixels differ in coverage and "<<depth<<" in depth (edges between triangles)"<<std::endl;
+
+	//Hybrid: rasterized primary hits, traced shadow rays
+	cimg_library::CImg<float> normals(w,h,1,3), shadows(w,h,1,3);
+	double shadow_seconds = benchmark::seconds([&] () {
+		render::parallel_for(h, [&] (int j) {
+			for (int i = 0; i<w; ++i) {
+				const std::optional<tracer::Hit>& hit = rasterized[std::size_t(j)*w + i];
+				float lit = 0.0f;
+				if (hit) {
+					Eigen::Vector3f tolight = light - hit->point();
+					bool occluded = scene.trace_shadow(tracer::Ray(hit->point(), tolight.normalized(), 1.e-4f, tolight.norm() - 1.e-4f));
+					lit = occluded ? 0.0f : std::abs(hit->normal().dot(tolight.normalized()));
+				}
+				for (int c = 0; c<3; ++c) {
+					normals(i,j,0,c) = hit ? 0.5f*hit->normal()[c] + 0.5f : 0.0f;
+					shadows(i,j,0,c) = lit;
+				}
+			}
+		});
+	});
+	std::cout<<std::setw(12)<<"shadows: "<<shadow_seconds<<"s (traced from the rasterized hits)"<<std::endl;
+	normals.save("raster-normals.hdr");
+	shadows.save("raster-shadows.hdr");
+}
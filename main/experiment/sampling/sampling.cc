@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <tracer/tracer.h>
+#include <render/parallel.h>
+#include <scenes/procedural.h>
+#include <benchmark/benchmark.h>
+
+/**
+ * Convergence of the samplers (see tracer/sensors/sampler.h) on ambient occlusion of the sphere
+ * field, antialiased: dimensions 0 and 1 place the sample in the pixel, 2 and 3 choose the
+ * direction of the occlusion ray. For every sample count, the error (RMSE) of each sampler
+ * against a reference with many more Sobol samples, the sample count that random sampling
+ * needs for the same error, and how fast each sampler generates values, one at a time and in
+ * blocks of 8 pixels.
+ *
+ * Usage: sampling [--width w] [--height h] [--reference spp] [--max spp]
+ **/
+
+constexpr int block_size = 8;
+
+//Cosine weighted direction around the normal from two sample values
+Eigen::Vector3f cosine_weighted(const tracer::Hit& hit, const Eigen::Vector3f& incoming, float u1, float u2) {
+	float phi = 2.0f*float(M_PI)*u1;
+	Eigen::Vector3f local(std::sqrt(u2)*std::cos(phi), std::sqrt(u2)*std::sin(phi), std::sqrt(1.0f - u2));
+	Eigen::Vector3f sol = hit.local_to_global()*local;
+	return (sol.dot(hit.normal())*incoming.dot(hit.normal()) > 0.0f) ? Eigen::Vector3f(-sol) : sol;
+}
+
+//Ambient occlusion of every pixel, sample blocks of consecutive pixels of each tile at a time
+std::vector<float> occlusion(const tracer::Scene& scene, const tracer::Pinhole& camera, int w, int h, int samples, const tracer::Sampler& sampler) {
+	std::vector<float> sol(std::size_t(w)*std::size_t(h), 0.0f);
+	std::vector<tracer::Tile> tiles = tracer::tiles(w, h, 16);
+	render::parallel_for(int(tiles.size()), [&] (int t) {
+		std::vector<std::array<int,2>> pixels = tracer::pixels(tiles[t]);
+		for (std::size_t p = 0; p<pixels.size(); p += block_size) {
+			int n = int(std::min<std::size_t>(block_size, pixels.size() - p));
+			Eigen::Array<float,block_size,1> x, y, occlusion = Eigen::Array<float,block_size,1>::Zero();
+			for (int k = 0; k<n; ++k) { x[k] = float(pixels[p+k][0]); y[k] = float(pixels[p+k][1]); }
+			for (int s = 0; s<samples; ++s) {
+				Eigen::Array<float,block_size,1> u = (x + sampler.block<block_size>(&pixels[p], n, unsigned(s), 0))*(2.0f/float(w)) - 1.0f;
+				Eigen::Array<float,block_size,1> v = (y + sampler.block<block_size>(&pixels[p], n, unsigned(s), 1))*(2.0f/float(h)) - 1.0f;
+				Eigen::Array<float,block_size,1> u1 = sampler.block<block_size>(&pixels[p], n, unsigned(s), 2);
+				Eigen::Array<float,block_size,1> u2 = sampler.block<block_size>(&pixels[p], n, unsigned(s), 3);
+				tracer::RayBlock<block_size> rays = camera.rays<block_size>(u, v, n);
+				for (int k = 0; k<n; ++k) {
+					tracer::Ray ray = rays.ray(k);
+					std::optional<tracer::Hit> hit = scene.trace(ray);
+					if (!hit) { occlusion[k] += 1.0f; continue; }
+					tracer::Ray shadow(hit->point(), cosine_weighted(*hit, ray.direction(), u1[k], u2[k]), 1.e-4f, 1.0f);
+					if (!scene.trace_shadow(shadow)) occlusion[k] += 1.0f;
+				}
+			}
+			for (int k = 0; k<n; ++k) sol[std::size_t(pixels[p+k][1])*w + pixels[p+k][0]] = occlusion[k]/float(samples);
+		}
+	});
+	return sol;
+}
+
+double rmse(const std::vector<float>& a, const std::vector<float>& b) {
+	double sol = 0.0;
+	for (std::size_t i = 0; i<a.size(); ++i) sol += double(a[i] - b[i])*double(a[i] - b[i]);
+	return std::sqrt(sol/double(std::max<std::size_t>(a.size(),1)));
+}
+
+int main(int argc, char** argv) {
+	int w = 256, h = 256, reference_samples = 1024, max_samples = 64;
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--width") && (i+1<argc))     w = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))    h = std::stoi(argv[++i]);
+		else if ((arg == "--reference") && (i+1<argc)) reference_samples = std::stoi(argv[++i]);
+		else if ((arg == "--max") && (i+1<argc))       max_samples = std::stoi(argv[++i]);
+	}
+
+	tracer::Scene scene = scenes::sphere_field(12);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 3, -3), Eigen::Vector3f( 0, -1, 1.6), Eigen::Vector3f( 0, 1.6, 1));
+	const tracer::Sampling samplings[] = { tracer::Sampling::Random, tracer::Sampling::Sobol, tracer::Sampling::BlueNoise };
+	const char* names[] = { "random", "sobol", "blue-noise" };
+
+	std::vector<float> reference;
+	double seconds = benchmark::seconds([&] () { reference = occlusion(scene, camera, w, h, reference_samples, tracer::Sampler(tracer::Sampling::Sobol, 1234)); });
+	std::cout<<"Reference: "<<reference_samples<<" spp in "<<seconds<<"s"<<std::endl;
+
+	std::vector<int> samples;
+	for (int s = 1; s<=max_samples; s *= 2) samples.push_back(s);
+	std::vector<std::vector<double>> errors(3);
+	std::cout<<std::setw(5)<<"spp";
+	for (const char* name : names) std::cout<<std::setw(12)<<name;
+	std::cout<<std::endl;
+	for (int s : samples) {
+		std::cout<<std::setw(5)<<s<<std::fixed<<std::setprecision(4);
+		for (int k = 0; k<3; ++k) {
+			errors[k].push_back(rmse(occlusion(scene, camera, w, h, s, tracer::Sampler(samplings[k])), reference));
+			std::cout<<std::setw(12)<<errors[k].back();
+		}
+		std::cout<<std::defaultfloat<<std::endl;
+	}
+
+	//Random samples for the same error, interpolated on a log-log scale (random error goes as 1/sqrt(spp))
+	for (int k = 1; k<3; ++k) {
+		std::cout<<names[k]<<" ~ random at:";
+		for (std::size_t i = 0; i<samples.size(); ++i)
+			std::cout<<" "<<samples[i]<<"->"<<std::setprecision(3)<<double(samples[i])*std::pow(errors[0][i]/errors[k][i], 2.0);
+		std::cout<<std::defaultfloat<<std::endl;
+	}
+
+	//Generation speed, on a 256x256 image with 16 samples and 4 dimensions per pixel
+	std::vector<std::array<int,2>> pixels = tracer::pixels(tracer::Tile{0, 0, 256, 256});
+	const int count = int(pixels.size())*16*4;
+	for (int k = 0; k<3; ++k) {
+		tracer::Sampler sampler(samplings[k]);
+		float sum = 0.0f;
+		double scalar = benchmark::seconds([&] () {
+			for (const std::array<int,2>& p : pixels) for (unsigned s = 0; s<16; ++s) for (int d = 0; d<4; ++d) sum += sampler(p[0], p[1], s, d);
+		});
+		double block = benchmark::seconds([&] () {
+			for (std::size_t p = 0; p<pixels.size(); p += block_size) for (unsigned s = 0; s<16; ++s) for (int d = 0; d<4; ++d)
+				sum += sampler.block<block_size>(&pixels[p], block_size, s, d).sum();
+		});
+		std::cout<<std::setw(12)<<names[k]<<": "<<std::setprecision(1)<<std::fixed<<1.e-6*count/scalar<<" M samples/s, "
+		         <<1.e-6*count/block<<" M samples/s in blocks"<<std::defaultfloat<<(sum < 0.0f ? "!" : "")<<std::endl;
+	}
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <render/server.h>
+#include <cimg-all.h>
+
+/**
+ * Resident render server. Without arguments, it starts a server in this process and measures,
+ * from clients connected to it, a first request (which builds the scene), repeated requests
+ * (which only trace) and concurrent requests sharing the thread pool. It saves the color of the
+ * last one in server.hdr.
+ *
+ * Usage: server [--scene name] [--width w] [--height h] [--budget ms] [--clients n]
+ *        server --listen address     (runs a server until killed)
+ *        server --connect address [--scene name] [--width w] [--height h] [--budget ms] [--output file]
+ * Scenes: spheres (a field of 32x32 spheres), terrain (a 128x128 heightfield).
+ **/
+
+void add_scenes(render::server::Server& server) {
+	server.add("spheres", [] () { return scenes::sphere_field(32); });
+	server.add("terrain", [] () { return scenes::terrain(128); });
+}
+
+void save(const render::AovBuffers& buffers, const std::string& filename) {
+	cimg_library::CImg<float> image(buffers.width(), buffers.height(), 1, 3);
+	for (int j = 0; j<buffers.height(); ++j) for (int i = 0; i<buffers.width(); ++i)
+		for (int c = 0; c<3; ++c) image(i,j,0,c) = buffers(render::aov::color,i,j)[c];
+	image.save(filename.c_str());
+}
+
+void report(const std::string& name, const render::server::Result& r) {
+	std::cout<<std::setw(14)<<name<<std::setw(12)<<r.seconds<<"s, "<<r.rendered<<"/"<<r.tiles<<" tiles"<<std::endl;
+}
+
+int main(int argc, char** argv) {
+	std::string listen, connect, output = "server.hdr";
+	int clients = 4;
+	render::server::Request request;
+	request.scene = "spheres"; request.width = 512; request.height = 512;
+	request.origin = Eigen::Vector3f(0, 4, -6); request.front = Eigen::Vector3f(0, -0.8, 1.6); request.up = Eigen::Vector3f(0, 1.6, 0.8);
+	for (int i = 1; i<argc; ++i) {
+		std::string arg = argv[i];
+		if      ((arg == "--scene") && (i+1<argc))   request.scene = argv[++i];
+		else if ((arg == "--width") && (i+1<argc))   request.width = std::stoi(argv[++i]);
+		else if ((arg == "--height") && (i+1<argc))  request.height = std::stoi(argv[++i]);
+		else if ((arg == "--budget") && (i+1<argc))  request.budget = std::stod(argv[++i]);
+		else if ((arg == "--clients") && (i+1<argc)) clients = std::stoi(argv[++i]);
+		else if ((arg == "--output") && (i+1<argc))  output = argv[++i];
+		else if ((arg == "--listen") && (i+1<argc))  listen = argv[++i];
+		else if ((arg == "--connect") && (i+1<argc)) connect = argv[++i];
+		else { std::cerr<<"Unknown argument "<<arg<<std::endl; return 1; }
+	}
+
+	if (!listen.empty()) {
+		render::server::Server server;
+		add_scenes(server);
+		render::Listener listener{render::Address(listen)};
+		std::cout<<"Serving on "<<listen<<" with "<<server.pool().size()<<" threads"<<std::endl;
+		server.run(listener);
+		return 0;
+	}
+
+	if (!connect.empty()) {
+		render::Socket socket = render::connect(render::Address(connect));
+		render::server::Result r = render::server::request(socket, request);
+		report(request.scene, r);
+		save(r.buffers, output);
+		return 0;
+	}
+
+	render::server::Server server;
+	add_scenes(server);
+	render::Listener listener{render::Address("server.sock")};
+	std::thread running([&] () { server.run(listener); });
+	std::cout<<request.scene<<", "<<request.width<<"x"<<request.height<<", "<<server.pool().size()<<" threads"<<std::endl;
+
+	render::server::Result last;
+	{
+		render::Socket socket = render::connect(listener.address());
+		report("first", render::server::request(socket, request));
+		for (int k = 0; k<3; ++k) report("repeated", last = render::server::request(socket, request));
+	}
+
+	//Concurrent clients, each one with a slightly different camera
+	std::vector<render::server::Result> results(clients);
+	std::vector<std::thread> threads;
+	auto start = std::chrono::steady_clock::now();
+	for (int c = 0; c<clients; ++c) threads.emplace_back([&, c] () {
+		render::server::Request r = request;
+		r.origin[0] += 0.2f*float(c);
+		render::Socket socket = render::connect(listener.address());
+		results[c] = render::server::request(socket, r);
+	});
+	for (std::thread& t : threads) t.join();
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (const render::server::Result& r : results) report("concurrent", r);
+	std::cout<<clients<<" concurrent requests in "<<seconds<<"s, "<<server.builds()<<" scene builds for "<<server.requests()<<" requests"<<std::endl;
+
+	server.stop();
+	running.join();
+	save(last.buffers, output);
+}
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <tracer/tracer.h>
+#include <benchmark/kernels.h>
+
+/**
+ * Measures the kernels of the packing experiment on this machine and writes the header with
+ * the best pack width and leaf size per primitive type (see tracer/pack/pack-widths.h).
+ *
+ *   - Pack width: the knee of the cost per object of Pack<O,N>, the first N for which doubling
+ *     it improves the cost per object by less than 10% (wider packs waste lanes and culling).
+ *   - Leaf size: doubling a leaf of n objects pays off while tracing 2n costs less than a
+ *     node (a pair of boxes) plus the two halves of n, each one reached with probability 2/3.
+ *
+ * Usage: tune [output header] [seconds per measurement]
+ **/
+
+const std::array<int,7> widths{1,2,4,8,16,32,64};
+
+//Seconds per ray of the intersection kernel alone (what a leaf costs, the hit is built only once per ray)
+template<typename Object>
+float kernel_time(const Object& o, float seconds) {
+	tracer::PreparedRay r(tracer::Ray(Eigen::Vector3f(0.0f,0.0f,0.0f),Eigen::Vector3f(0.0f,0.0f,1.0f)));
+	std::chrono::duration<float> duration(0);
+	auto start = std::chrono::steady_clock::now();
+	unsigned long n = 0; volatile bool hit = false;
+	while ((duration.count() < seconds) || (n == 0)) {
+		for (int i = 0; i<64; ++i) hit = bool(o.trace_general(r));
+		n += 64;
+		duration = std::chrono::steady_clock::now() - start;
+	}
+	(void)hit;
+	return duration.count()/float(n);
+}
+
+//Exactly n objects of the kernel: add_all only gives about n of them (how many depends on the type),
+//so they are repeated or cut, otherwise the cost per object would be divided by the wrong count
+template<typename O>
+std::vector<O> kernel_objects(int n) {
+	std::list<O> all;
+	benchmark::add_all(all, n);
+	std::vector<O> sol(all.begin(), all.end());
+	for (std::size_t i = 0; sol.size() < std::size_t(n); ++i) sol.push_back(sol[i]);
+	sol.resize(std::size_t(n), sol.front());
+	return sol;
+}
+
+template<typename O, int N>
+float measure(float seconds) {
+	return kernel_time(tracer::Pack<O,N>(kernel_objects<O>(N)), seconds);
+}
+
+struct Tuning { std::string name; int width, leaf_size; };
+
+template<typename O>
+Tuning tune(const std::string& name, float node, float seconds) {
+	std::vector<float> t{measure<O,1>(seconds), measure<O,2>(seconds), measure<O,4>(seconds), measure<O,8>(seconds),
+	                                   measure<O,16>(seconds), measure<O,32>(seconds), measure<O,64>(seconds)};
+	Tuning sol{name, 1, 1};
+	std::size_t leaf = 0;
+	while ((leaf+1 < t.size()) && (t[leaf+1]/float(widths[leaf+1]) < 0.9f*t[leaf]/float(widths[leaf]))) ++leaf;
+	sol.width = widths[leaf];
+	while ((leaf+1 < t.size()) && (t[leaf+1] <= node + (4.0f/3.0f)*t[leaf])) ++leaf;
+	sol.leaf_size = widths[leaf];
+
+	std::cout<<std::setw(16)<<name;
+	for (std::size_t i = 0; i<t.size(); ++i) std::cout<<std::setw(8)<<std::fixed<<std::setprecision(2)<<1.e9f*t[i]/float(widths[i]);
+	std::cout<<std::setw(8)<<sol.width<<std::setw(8)<<sol.leaf_size<<std::endl;
+	return sol;
+}
+
+int main(int argc, char** argv) {
+	std::string output = (argc > 1) ? argv[1] : "pack-widths.generated.h";
+	float seconds = (argc > 2) ? std::stof(argv[2]) : 0.05f;
+
+	//A node of an acceleration structure: the two boxes of its children
+	tracer::Pack<tracer::AxisAlignedBox,2> node(std::vector<tracer::AxisAlignedBox>{
+		tracer::AxisAlignedBox(Eigen::Vector3f(-1,-1,1), Eigen::Vector3f(1,1,2)), tracer::AxisAlignedBox(Eigen::Vector3f(-1,-1,3), Eigen::Vector3f(1,1,4))});
+	float node_time = kernel_time(node, seconds);
+
+	std::cout<<"Nanoseconds per object in Pack<O,N> for N =";
+	for (int w : widths) std::cout<<" "<<w;
+	std::cout<<" (node: "<<std::scientific<<std::setprecision(3)<<node_time<<" s)"<<std::endl;
+	std::cout<<std::setw(16)<<"type";
+	for (int w : widths) std::cout<<std::setw(8)<<w;
+	std::cout<<std::setw(8)<<"width"<<std::setw(8)<<"leaf"<<std::endl;
+	std::vector<Tuning> tunings{
+		tune<tracer::Plane>("PLANE", node_time, seconds),
+		tune<tracer::Sphere>("SPHERE", node_time, seconds),
+		tune<tracer::Triangle>("TRIANGLE", node_time, seconds),
+		tune<tracer::AxisAlignedBox>("AXIS_ALIGNED_BOX", node_time, seconds)};
+
+	std::ofstream file(output);
+	if (!file) { std::cerr<<"Cannot write "<<output<<std::endl; return 1; }
+	file<<"#pragma once\n\n// Generated by the tune tool (main/experiment/tune) on the target machine. Do not edit.\n\n";
+	for (const Tuning& t : tunings) {
+		file<<"#define TRACER_PACK_WIDTH_"<<t.name<<" "<<t.width<<"\n";
+		file<<"#define TRACER_LEAF_SIZE_"<<t.name<<" "<<t.leaf_size<<"\n";
+	}
+	std::cout<<"Written "<<output<<std::endl;
+}
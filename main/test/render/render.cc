@@ -0,0 +1,508 @@
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include <catch.hpp>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <cstring>
+#include <cstdio>
+#include <tracer/tracer.h>
+#include <render/parallel.h>
+#include <render/framebuffer.h>
+#include <render/aov.h>
+#include <render/denoise.h>
+#include <render/farm.h>
+#include <render/gbuffer.h>
+#include <render/numa.h>
+#include <render/visibility.h>
+#include <render/server.h>
+#include <chrono>
+#include <thread>
+
+TEST_CASE( "Streaming framebuffer writes every tile in place", "[framebuffer]" ) {
+	int w = 45, h = 23;
+	{
+		render::StreamingFramebuffer fb("test-framebuffer.pfm", w, h, 8, 2);
+		std::vector<tracer::Tile> tiles = fb.tiles();
+		render::parallel_for(int(tiles.size()), [&] (int t) {
+			auto tile = fb.acquire(tiles[t]);
+			for (int j = tiles[t].y0; j<tiles[t].y1; ++j) for (int i = tiles[t].x0; i<tiles[t].x1; ++i)
+				tile->set(i, j, float(i), float(j), float(t));
+			fb.commit(std::move(tile));
+		}, 4);
+		REQUIRE( fb.max_bytes() <= 2*(8*8*3*sizeof(float) + 64) );
+	}
+	std::ifstream file("test-framebuffer.pfm", std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::string header = "PF\n45 23\n-1.0\n";
+	REQUIRE( data.size() == header.size() + std::size_t(w*h*3)*sizeof(float) );
+	REQUIRE( data.compare(0, header.size(), header) == 0 );
+	bool correct = true;
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		float rgb[3];
+		std::memcpy(rgb, data.data() + header.size() + 3*sizeof(float)*((h-1-j)*w + i), sizeof(rgb));
+		correct = correct && (rgb[0] == float(i)) && (rgb[1] == float(j));
+	}
+	REQUIRE( correct );
+	std::remove("test-framebuffer.pfm");
+}
+
+//Seekable stream that runs out of space after a number of bytes, like a full disk
+class FullDisk : public std::streambuf {
+	std::streamsize left;
+	pos_type position = 0;
+protected:
+	pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+		if (dir != std::ios_base::beg) return pos_type(off_type(-1));
+		return position = pos_type(off);
+	}
+	pos_type seekpos(pos_type p, std::ios_base::openmode) override { return position = p; }
+	std::streamsize xsputn(const char*, std::streamsize n) override {
+		if (n > left) return 0;
+		left -= n; position += n;
+		return n;
+	}
+	int_type overflow(int_type c) override { return (xsputn(nullptr, 1) == 1) ? c : traits_type::eof(); }
+public:
+	explicit FullDisk(std::streamsize left) : left(left) {}
+};
+
+TEST_CASE( "Streaming framebuffer reports write errors", "[framebuffer]" ) {
+	int w = 45, h = 23;
+	FullDisk disk(200);
+	render::StreamingFramebuffer fb(std::make_unique<std::ostream>(&disk), "full disk", w, h, 8, 2);
+	std::vector<tracer::Tile> tiles = fb.tiles();
+	render::parallel_for(int(tiles.size()), [&] (int t) {
+		auto tile = fb.acquire(tiles[t]);
+		for (int j = tiles[t].y0; j<tiles[t].y1; ++j) for (int i = tiles[t].x0; i<tiles[t].x1; ++i) tile->set(i, j, 0.0f, 0.0f, 0.0f);
+		fb.commit(std::move(tile));
+	}, 4);
+	REQUIRE_THROWS_AS( fb.close(), render::FramebufferException );
+
+	//The header does not even fit
+	FullDisk tiny(4);
+	REQUIRE_THROWS_AS( render::StreamingFramebuffer(std::make_unique<std::ostream>(&tiny), "tiny disk", w, h), render::FramebufferException );
+}
+
+TEST_CASE( "All AOVs from a single pass", "[aov]" ) {
+	tracer::Scene scene;
+	scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
+	scene.add(tracer::Sphere(Eigen::Vector3f(1.5f,1.5f,0.0f), 0.5f));
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	int w = 24, h = 16;
+	render::AovOptions options; options.tile_size = 8; options.threads = 2;
+	render::AovBuffers aovs = render::render_aovs(scene, camera, w, h, render::aov::depth | render::aov::primitive_id | render::aov::object_id | render::aov::hit_count | render::aov::normal, options);
+	REQUIRE( !aovs.has(render::aov::color) );
+	REQUIRE( aovs.buffer(render::aov::color).empty() );
+	REQUIRE( aovs.buffer(render::aov::normal).size() == std::size_t(3*w*h) );
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		tracer::Ray r = camera.ray((float(i)+0.5f)*2.0f/float(w) - 1.0f, (float(j)+0.5f)*2.0f/float(h) - 1.0f);
+		std::optional<tracer::Hit> hit = scene.trace(r);
+		REQUIRE( *aovs(render::aov::hit_count,i,j) == (hit ? 1.0f : 0.0f) );
+		if (hit) {
+			REQUIRE( *aovs(render::aov::depth,i,j) == Approx(hit->distance()) );
+			//Spheres are single primitives, numbered by the scene
+			REQUIRE( *aovs(render::aov::object_id,i,j) == ((hit->point() - Eigen::Vector3f(1.5f,1.5f,0.0f)).norm() < 0.51f ? 1.0f : 0.0f) );
+			REQUIRE( *aovs(render::aov::primitive_id,i,j) == *aovs(render::aov::object_id,i,j) );
+			REQUIRE( aovs(render::aov::normal,i,j)[2] == Approx(hit->normal()[2]) );
+		} else {
+			REQUIRE( *aovs(render::aov::primitive_id,i,j) == -1.0f );
+			REQUIRE( *aovs(render::aov::object_id,i,j) == -1.0f );
+		}
+	}
+
+	//Triangles in the same pack: same object, each its own primitive
+	std::vector<tracer::Triangle> triangles{tracer::Triangle(Eigen::Vector3f(-2,-1,0), Eigen::Vector3f(0,-1,0), Eigen::Vector3f(-1,1,0)),
+		tracer::Triangle(Eigen::Vector3f(0,-1,0), Eigen::Vector3f(2,-1,0), Eigen::Vector3f(1,1,0))};
+	tracer::List<tracer::Pack<tracer::Triangle,4>> packed(std::vector<tracer::Pack<tracer::Triangle,4>>{tracer::Pack<tracer::Triangle,4>(triangles)});
+	aovs = render::render_aovs(packed, camera, w, h, render::aov::primitive_id | render::aov::object_id, options);
+	std::array<int,2> seen{0,0};
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		tracer::Ray r = camera.ray((float(i)+0.5f)*2.0f/float(w) - 1.0f, (float(j)+0.5f)*2.0f/float(h) - 1.0f);
+		std::optional<tracer::Hit> hit = packed.trace(r);
+		if (!hit) continue;
+		REQUIRE( *aovs(render::aov::object_id,i,j) == 0.0f );
+		REQUIRE( *aovs(render::aov::primitive_id,i,j) == ((hit->point()[0] < 0.0f) ? 0.0f : 1.0f) );
+		++seen[int(*aovs(render::aov::primitive_id,i,j))];
+	}
+	REQUIRE( seen[0] > 0 );
+	REQUIRE( seen[1] > 0 );
+}
+
+TEST_CASE( "Denoiser smooths noise without crossing normal and depth edges", "[denoise][aov]" ) {
+	//Two noisy flat halves, facing different ways at different depths
+	int w = 64, h = 32;
+	render::AovBuffers aovs(w, h, render::aov::color | render::aov::normal | render::aov::depth);
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> noise(-0.2f,0.2f);
+	auto value = [&] (int i) { return (i < w/2) ? 0.2f : 0.8f; };
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		float v = value(i) + noise(random);
+		for (int c = 0; c<3; ++c) aovs(render::aov::color,i,j)[c] = v;
+		aovs(render::aov::normal,i,j)[(i < w/2) ? 2 : 0] = 1.0f;
+		*aovs(render::aov::depth,i,j) = (i < w/2) ? 2.0f : 3.0f;
+	}
+	//RMS error of the columns [begin,end)
+	auto error = [&] (const render::AovBuffers& a, int begin, int end) {
+		float sol = 0.0f;
+		for (int j = 0; j<h; ++j) for (int i = begin; i<end; ++i) sol += std::pow(a(render::aov::color,i,j)[0] - value(i), 2.0f);
+		return std::sqrt(sol/float(h*(end - begin)));
+	};
+	REQUIRE( error(aovs,0,w) > 0.1f );
+
+	render::DenoiseOptions options; options.tile_size = 8; options.threads = 2;
+	render::denoise(aovs, options);
+	REQUIRE( error(aovs,0,w) < 0.02f );
+	//Nothing leaks across the edge
+	REQUIRE( error(aovs,w/2 - 1,w/2 + 1) < 0.02f );
+	REQUIRE( aovs(render::aov::color,w/2,0)[1] == aovs(render::aov::color,w/2,0)[0] );
+}
+
+TEST_CASE( "Render farm with a slow worker and a failing one", "[farm][socket]" ) {
+	int w = 64, h = 48;
+	std::vector<tracer::Tile> tiles = tracer::tiles(w,h,8);
+	auto pattern = [] (render::TileBuffer& buffer) {
+		const tracer::Tile& t = buffer.tile();
+		for (int j = t.y0; j<t.y1; ++j) for (int i = t.x0; i<t.x1; ++i) buffer.set(i, j, float(i), float(j), float(i*j));
+	};
+	std::vector<render::farm::Process> processes = render::farm::spawn(3, [&] (render::Socket& s, int index) {
+		if (index == 0) render::farm::serve(s, pattern);
+		else if (index == 1) render::farm::serve(s, [&] (render::TileBuffer& b) { std::this_thread::sleep_for(std::chrono::milliseconds(20)); pattern(b); });
+		else { //Goes away after two tiles
+			int count = 0;
+			render::farm::serve(s, [&] (render::TileBuffer& b) { if (++count > 2) ::_exit(0); pattern(b); });
+		}
+	});
+	std::vector<render::Socket> workers = render::farm::sockets(processes);
+
+	std::vector<float> image(3*w*h, -1.0f);
+	render::farm::Statistics stats = render::farm::coordinate(workers, tiles, [&] (const render::TileBuffer& b) {
+		const tracer::Tile& t = b.tile();
+		for (int j = t.y0; j<t.y1; ++j) std::memcpy(&image[3*(j*w + t.x0)], b.row(j), 3*sizeof(float)*t.width());
+	});
+	workers.clear();
+	REQUIRE( render::farm::wait(processes) == 0 );
+
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		REQUIRE( image[3*(j*w+i)+0] == float(i) );
+		REQUIRE( image[3*(j*w+i)+1] == float(j) );
+		REQUIRE( image[3*(j*w+i)+2] == float(i*j) );
+	}
+	REQUIRE( stats.failed == 1 );
+	REQUIRE( stats.tiles[0] + stats.tiles[1] + stats.tiles[2] == int(tiles.size()) );
+	REQUIRE( stats.tiles[2] <= 2 );
+	REQUIRE( stats.tiles[0] > stats.tiles[1] );
+}
+
+TEST_CASE( "Primary hits are cached while camera and geometry do not change", "[gbuffer][hash]" ) {
+	tracer::Scene scene;
+	scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
+	scene.add(tracer::pack(tracer::Triangle(Eigen::Vector3f(-2,-2,1), Eigen::Vector3f(2,-2,1), Eigen::Vector3f(0,2,1)),
+	                       tracer::Triangle(Eigen::Vector3f(-2,-2,2), Eigen::Vector3f(2,-2,2), Eigen::Vector3f(0,2,2))));
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	int w = 20, h = 10;
+	render::PrimaryHitCache cache(8, 2);
+	REQUIRE( cache.update(scene, camera, w, h) );
+	REQUIRE( !cache.update(scene, camera, w, h) );
+
+	int hits = 0;
+	cache.shade([&] (int i, int j, const tracer::Ray& ray, const std::optional<tracer::Hit>& hit) {
+		std::optional<tracer::Hit> expected = scene.trace(ray);
+		REQUIRE( bool(hit) == bool(expected) );
+		if (hit) REQUIRE( hit->distance() == Approx(expected->distance()) );
+		if (hit) ++hits;
+		REQUIRE( (cache.object(i,j) >= 0) == bool(hit) );
+	});
+	REQUIRE( hits > 0 );
+
+	//Typed scenes keep the compact hits of their objects (distance, barycentrics and lane for triangles)
+	std::vector<tracer::Triangle> triangles;
+	for (int k = 0; k<12; ++k)
+		triangles.push_back(tracer::Triangle(Eigen::Vector3f(-2.0f + 0.3f*float(k),-2,1.0f + 0.1f*float(k)), Eigen::Vector3f(2,-1.5f + 0.2f*float(k),1.5f), Eigen::Vector3f(0,2,1.2f)));
+	using TrianglePack = tracer::Pack<tracer::Triangle,tracer::pack_width_v<tracer::Triangle>>;
+	tracer::List<TrianglePack> mesh(tracer::packs(triangles));
+	render::PrimaryHitCache<TrianglePack> compact(8, 2);
+	REQUIRE( compact.pixel_bytes() < sizeof(tracer::Hit)/2 );
+	REQUIRE( compact.update(mesh, camera, w, h) );
+	hits = 0;
+	compact.shade([&] (int i, int j, const tracer::Ray& ray, const std::optional<tracer::Hit>& hit) {
+		std::optional<tracer::Hit> expected = mesh.trace(ray);
+		REQUIRE( bool(hit) == bool(expected) );
+		if (!hit) return;
+		++hits;
+		REQUIRE( hit->distance() == Approx(expected->distance()) );
+		REQUIRE( hit->normal().isApprox(expected->normal(), 1.e-4f) );
+	});
+	REQUIRE( hits > 0 );
+
+	//A different camera or geometry traces again
+	REQUIRE( cache.update(scene, tracer::Pinhole(Eigen::Vector3f( 0, 0, -4), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0)), w, h) );
+	tracer::Scene copy(scene.objects());
+	REQUIRE( copy.geometry_hash() == scene.geometry_hash() );
+	copy.add(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 0.5f));
+	REQUIRE( copy.geometry_hash() != scene.geometry_hash() );
+	REQUIRE( cache.update(copy, camera, w, h) );
+}
+
+TEST_CASE( "Profiler writes nested scopes of every thread", "[profiler]" ) {
+	tracer::profiler::reset();
+	render::parallel_for(8, [] (int t) {
+		tracer::profiler::Scope tile("tile", t);
+		tracer::profiler::Scope inner("inner");
+	}, 2);
+	REQUIRE( tracer::profiler::events() == 16 );
+
+	std::ostringstream os;
+	tracer::profiler::write(os);
+	std::string json = os.str();
+	REQUIRE( json.find("\"traceEvents\"") != std::string::npos );
+	REQUIRE( json.find("\"name\":\"inner\",\"cat\":\"tracer\",\"ph\":\"X\"") != std::string::npos );
+	REQUIRE( json.find("\"args\":{\"arg\":7}") != std::string::npos );
+	for (const auto& t : tracer::profiler::registry().all())
+		for (std::size_t e = 1; e<t->events.size(); e+=2) {
+			//Inner scopes finish first, within their tile
+			const tracer::profiler::Event& inner = t->events[e-1]; const tracer::profiler::Event& tile = t->events[e];
+			REQUIRE( std::string(tile.name) == "tile" );
+			REQUIRE( inner.begin >= tile.begin );
+			REQUIRE( inner.begin + inner.duration <= tile.begin + tile.duration );
+		}
+	tracer::profiler::reset();
+}
+
+TEST_CASE( "Profiler keeps the latest events and reuses the buffers of finished threads", "[profiler]" ) {
+	std::size_t capacity = tracer::profiler::registry().capacity();
+	tracer::profiler::set_capacity(4);
+	std::thread([] { for (int i = 0; i<10; ++i) tracer::profiler::Scope scope("bounded", i); }).join();
+	REQUIRE( tracer::profiler::events() == 4 );
+	REQUIRE( tracer::profiler::dropped() == 6 );
+	for (const auto& t : tracer::profiler::registry().all()) if (t->events.size() > 0) {
+		//Oldest first
+		REQUIRE( t->events[0].arg == 6 );
+		REQUIRE( t->events[3].arg == 9 );
+	}
+	std::size_t threads = tracer::profiler::registry().all().size();
+	for (int i = 0; i<4; ++i) std::thread([] { tracer::profiler::Scope scope("reused"); }).join();
+	REQUIRE( tracer::profiler::registry().all().size() == threads );
+	REQUIRE( tracer::profiler::events() <= 8 );
+	tracer::profiler::set_capacity(capacity);
+	REQUIRE( tracer::profiler::events() == 0 );
+}
+
+TEST_CASE( "Exceptions in parallel loops reach the caller", "[parallel][numa]" ) {
+	auto fails = [] (std::atomic<int>& calls) {
+		return [&calls] (int i) { ++calls; if (i == 37) throw std::runtime_error("tile 37"); };
+	};
+	std::atomic<int> calls{0};
+	REQUIRE_THROWS_WITH( render::parallel_for(1000, fails(calls), 3), "tile 37" );
+	calls = 0;
+	REQUIRE_THROWS_WITH( render::parallel_for(1000, fails(calls), 1), "tile 37" );
+	REQUIRE( calls == 38 ); //No more indices once it failed
+
+	//The pool stops handing out the indices of the loop that failed, and keeps working for the others
+	render::ThreadPool single(1);
+	calls = 0;
+	REQUIRE_THROWS_WITH( single.parallel_for(1000, fails(calls)), "tile 37" );
+	REQUIRE( calls == 38 );
+	render::ThreadPool pool(3);
+	std::atomic<int> others{0};
+	std::thread other([&] () { pool.parallel_for(500, [&] (int) { ++others; }); });
+	REQUIRE_THROWS_WITH( pool.parallel_for(1000, fails(calls)), "tile 37" );
+	other.join();
+	REQUIRE( others == 500 );
+	calls = 0;
+	pool.parallel_for(100, [&] (int) { ++calls; });
+	REQUIRE( calls == 100 );
+
+	std::vector<int> cpus = render::numa::allowed_cpus();
+	render::numa::Topology topology({render::numa::Node{0,cpus}, render::numa::Node{1,cpus}});
+	render::numa::Options options; options.threads_per_node = 2;
+	calls = 0;
+	auto failing = fails(calls);
+	REQUIRE_THROWS_WITH( render::numa::parallel_for(topology, 1000, [&] (int i, int) { failing(i); }, options), "tile 37" );
+}
+
+TEST_CASE( "NUMA parallel for and replicas", "[numa]" ) {
+	REQUIRE( render::numa::parse_list("0-3,8,10-11\n") == std::vector<int>{0,1,2,3,8,10,11} );
+
+	//Three nodes sharing whatever CPUs we have, so every placement path runs on any machine
+	std::vector<int> cpus = render::numa::allowed_cpus();
+	render::numa::Topology topology({render::numa::Node{0,cpus}, render::numa::Node{1,cpus}, render::numa::Node{2,cpus}});
+	render::numa::Options options; options.threads_per_node = 2;
+	std::vector<std::atomic<int>> calls(1000);
+	std::vector<std::atomic<int>> nodes(3);
+	render::numa::parallel_for(topology, int(calls.size()), [&] (int i, int node) { ++calls[i]; ++nodes[node]; }, options);
+	for (const auto& c : calls) REQUIRE( c == 1 );
+	REQUIRE( nodes[0] + nodes[1] + nodes[2] == 1000 );
+
+	render::numa::Replicated<std::vector<int>> replicated(topology, [] () { return std::vector<int>(100, 7); });
+	REQUIRE( replicated.copies() == 3 );
+	REQUIRE( &replicated[0] != &replicated[2] );
+	REQUIRE( replicated[2][99] == 7 );
+	render::numa::Replicated<std::vector<int>> shared(topology, [] () { return std::vector<int>(100, 7); }, render::numa::Placement::shared);
+	REQUIRE( shared.copies() == 1 );
+	REQUIRE( &shared[0] == &shared[2] );
+}
+
+TEST_CASE( "NUMA rendering of AOVs, cached hits and streamed tiles", "[numa][aov][gbuffer][framebuffer]" ) {
+	std::vector<int> cpus = render::numa::allowed_cpus();
+	render::numa::Topology topology({render::numa::Node{0,cpus}, render::numa::Node{1,cpus}, render::numa::Node{2,cpus}});
+	auto spheres = [] () {
+		tracer::Scene scene;
+		for (int i = 0; i<5; ++i) scene.add(tracer::Sphere(Eigen::Vector3f(float(i) - 2.0f, 0.3f*float(i%2), 1.0f), 0.45f));
+		return scene;
+	};
+	render::numa::Replicated<tracer::Scene> scene(topology, spheres);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	int w = 37, h = 21;
+	render::AovOptions options; options.tile_size = 8; options.numa.threads_per_node = 2;
+	unsigned aovs = render::aov::color | render::aov::depth | render::aov::primitive_id;
+	render::AovBuffers numa = render::render_aovs(topology, scene, camera, w, h, aovs, options);
+	render::AovBuffers expected = render::render_aovs(scene[0], camera, w, h, aovs, options);
+	for (unsigned a : {unsigned(render::aov::color), unsigned(render::aov::depth), unsigned(render::aov::primitive_id)})
+		REQUIRE( numa.buffer(a) == expected.buffer(a) );
+
+	render::PrimaryHitCache cache(topology, 8, options.numa), plain(8, 2);
+	REQUIRE( cache.update(scene[1], camera, w, h) );
+	REQUIRE( !cache.update(scene[1], camera, w, h) );
+	plain.update(scene[1], camera, w, h);
+	std::atomic<int> differences(0), hits(0);
+	cache.shade([&] (int i, int j, const tracer::Ray&, const std::optional<tracer::Hit>& hit) {
+		std::optional<tracer::Hit> other = plain.hit(i,j);
+		if ((cache.object(i,j) != plain.object(i,j)) || (bool(hit) != bool(other))) ++differences;
+		else if (hit && (hit->distance() != other->distance())) ++differences;
+		if (hit) ++hits;
+	});
+	REQUIRE( differences == 0 );
+	REQUIRE( hits > 0 );
+
+	//Tile buffers go back to the node that allocated them
+	{
+		render::StreamingFramebuffer fb("test-numa-framebuffer.pfm", w, h, 8, 4, topology.size());
+		REQUIRE( fb.nodes() == 3 );
+		std::vector<tracer::Tile> tiles = fb.tiles();
+		render::numa::parallel_for(topology, int(tiles.size()), [&] (int t, int node) {
+			auto tile = fb.acquire(tiles[t], node);
+			for (int j = tiles[t].y0; j<tiles[t].y1; ++j) for (int i = tiles[t].x0; i<tiles[t].x1; ++i)
+				tile->set(i, j, float(i), float(j), float(tile->node()));
+			fb.commit(std::move(tile));
+		}, options.numa);
+		fb.close();
+	}
+	std::ifstream file("test-numa-framebuffer.pfm", std::ios::binary);
+	std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	std::string header = "PF\n37 21\n-1.0\n";
+	REQUIRE( data.size() == header.size() + std::size_t(w*h*3)*sizeof(float) );
+	bool correct = true;
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		float rgb[3];
+		std::memcpy(rgb, data.data() + header.size() + 3*sizeof(float)*((h-1-j)*w + i), sizeof(rgb));
+		correct = correct && (rgb[0] == float(i)) && (rgb[1] == float(j)) && (rgb[2] >= 0.0f) && (rgb[2] < 3.0f);
+	}
+	REQUIRE( correct );
+	std::remove("test-numa-framebuffer.pfm");
+}
+
+TEST_CASE( "Rasterized visibility matches ray traced primary hits", "[raster][triangle]" ) {
+	std::vector<tracer::Triangle> triangles;
+	triangles.push_back(tracer::Triangle(Eigen::Vector3f(-1,-1,1), Eigen::Vector3f(1,-1,1), Eigen::Vector3f(0,1,1)));
+	triangles.push_back(tracer::Triangle(Eigen::Vector3f(-0.5f,-2,0.5f), Eigen::Vector3f(0.5f,-2,0.5f), Eigen::Vector3f(0,0.2f,2)));
+	//Crosses the near plane (behind the camera and in front of it)
+	triangles.push_back(tracer::Triangle(Eigen::Vector3f(-3,0.3f,-5), Eigen::Vector3f(3,0.3f,-5), Eigen::Vector3f(0,0.6f,4)));
+#ifdef MATERIAL
+	for (tracer::Triangle& t : triangles) t.set_material(std::make_shared<MATERIAL>());
+#endif
+	tracer::List<tracer::Triangle> list(triangles);
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	int w = 61, h = 47;
+	render::RasterOptions options; options.tile_size = 8; options.threads = 3;
+	render::VisibilityBuffer visibility = render::visibility(triangles, camera, w, h, options);
+
+	int hits = 0, differences = 0;
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		std::optional<tracer::Hit> expected = list.trace(visibility.ray(i,j));
+		std::optional<tracer::Hit> hit = visibility.hit(triangles, i, j);
+		if (bool(hit) != bool(expected)) { ++differences; continue; }
+		if (!hit) continue;
+		++hits;
+		REQUIRE( hit->distance() == Approx(expected->distance()).epsilon(1.e-4) );
+		REQUIRE( (hit->point() - expected->point()).norm() < 1.e-3f );
+#ifdef MATERIAL
+		//Typed lists do not carry the materials of their objects, the triangle itself does
+		std::optional<tracer::Hit> own = triangles[std::size_t(visibility.triangle(i,j))].trace(visibility.ray(i,j));
+		REQUIRE( own );
+		REQUIRE( hit->material() );
+		REQUIRE( hit->material() == own->material() );
+#endif
+	}
+	REQUIRE( hits > w*h/4 );
+	REQUIRE( differences <= 2 ); //Pixel centers exactly on an edge
+
+	//Vertices on the near plane far off axis project beyond the range of int (or to infinity)
+	std::vector<render::ScreenTriangle> screen;
+	for (float near : {options.near, 1.e-30f}) for (float far : {1.e6f, 1.e18f}) {
+		tracer::Triangle t(Eigen::Vector3f(-far,-1.0f,near), Eigen::Vector3f(far,-1.0f,near), Eigen::Vector3f(0.0f,1.0f,1.0f));
+		render::project(t, 0, Eigen::Matrix3f::Identity(), Eigen::Vector3f::Zero(), w, h, near, screen);
+	}
+	REQUIRE( !screen.empty() );
+	for (const render::ScreenTriangle& s : screen) {
+		REQUIRE( 0 <= s.x0 ); REQUIRE( s.x0 < s.x1 ); REQUIRE( s.x1 <= w );
+		REQUIRE( 0 <= s.y0 ); REQUIRE( s.y0 < s.y1 ); REQUIRE( s.y1 <= h );
+	}
+}
+
+TEST_CASE( "Render server keeps scenes loaded and streams concurrent requests", "[server][socket]" ) {
+	auto spheres = [] () {
+		tracer::Scene scene;
+		for (int i = 0; i<5; ++i) scene.add(tracer::Sphere(Eigen::Vector3f(float(i) - 2.0f, 0.3f*float(i%2), 1.0f), 0.45f));
+		return scene;
+	};
+	render::server::Server server(3);
+	server.add("spheres", spheres);
+	render::Listener listener{render::Address("test-server-" + std::to_string(::getpid()) + ".sock")};
+	std::thread running([&] () { server.run(listener); });
+
+	render::server::Request request;
+	request.scene = "spheres"; request.width = 40; request.height = 24; request.tile_size = 8;
+	request.origin = Eigen::Vector3f(0, 0, -3); request.front = Eigen::Vector3f(0, 0, 2);
+	request.aovs = render::aov::color | render::aov::depth | render::aov::primitive_id;
+	render::server::Request parsed = render::server::parse(render::server::format(request));
+	REQUIRE( parsed.aovs == request.aovs );
+	REQUIRE( parsed.front.isApprox(request.front) );
+	REQUIRE( render::server::format(parsed) == render::server::format(request) );
+
+	render::AovOptions options; options.tile_size = request.tile_size;
+	render::AovBuffers expected = render::render_aovs(spheres(), request.camera(), request.width, request.height, request.aovs, options);
+
+	//Several clients at once, each one asking twice on the same connection
+	std::vector<render::server::Result> results(6);
+	std::vector<int> streamed(results.size(), 0);
+	std::vector<std::thread> clients;
+	for (int c = 0; c<3; ++c) clients.emplace_back([&, c] () {
+		render::Socket socket = render::connect(listener.address());
+		for (int k = 0; k<2; ++k)
+			results[2*c + k] = render::server::request(socket, request, [&] (const render::AovBuffers&, const tracer::Tile&) { ++streamed[2*c + k]; });
+	});
+	for (std::thread& t : clients) t.join();
+	REQUIRE( server.builds() == 1 );
+	REQUIRE( server.requests() == 6 );
+	for (std::size_t r = 0; r<results.size(); ++r) {
+		REQUIRE( results[r].complete() );
+		REQUIRE( streamed[r] == results[r].tiles );
+		for (unsigned a : { render::aov::color, render::aov::depth, render::aov::primitive_id })
+			REQUIRE( results[r].buffers.buffer(a) == expected.buffer(a) );
+	}
+	//The threads of clients that went away are joined
+	for (int k = 0; (k<200) && (server.client_threads() > 0); ++k) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	REQUIRE( server.client_threads() == 0 );
+
+	render::Socket socket = render::connect(listener.address());
+	request.scene = "missing";
+	REQUIRE_THROWS_AS( render::server::request(socket, request), render::server::Exception );
+	//The connection survives errors. A budget that is over before the first tile renders nothing.
+	request.scene = "spheres"; request.budget = 1.e-6;
+	render::server::Result late = render::server::request(socket, request);
+	REQUIRE( !late.complete() );
+	REQUIRE( late.tiles == int(tracer::tiles(request.width, request.height, request.tile_size).size()) );
+
+	server.stop();
+	running.join();
+}
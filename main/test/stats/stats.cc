@@ -0,0 +1,47 @@
+#define TRACER_STATS
+#define CATCH_CONFIG_MAIN  // This tells Catch to provide a main() - only do this in one cpp file
+#include <catch.hpp>
+#include <tracer/tracer.h>
+#include <render/gbuffer.h>
+
+TEST_CASE( "Reading cached primary hits of a Scene traces nothing", "[gbuffer][stats]" ) {
+	//A row of triangles, used as every kind of geometry a Scene can hold
+	auto triangles = [] (float x) {
+		std::vector<tracer::Triangle> sol;
+		for (int k = 0; k<10; ++k)
+			sol.push_back(tracer::Triangle(Eigen::Vector3f(x + 0.1f*float(k),-1,1.0f + 0.05f*float(k)), Eigen::Vector3f(x + 0.1f*float(k) + 0.8f,-1,1.2f), Eigen::Vector3f(x + 0.1f*float(k) + 0.4f,1,1.1f)));
+		return sol;
+	};
+	tracer::Scene scene;
+	scene.add(tracer::List(tracer::packs(triangles(-4.0f))));
+	scene.add(tracer::Bvh<tracer::Triangle>(triangles(-2.0f)));
+	scene.add(tracer::CompressedMesh(triangles(0.0f)));
+	scene.add(tracer::Instance(Eigen::Affine3f(Eigen::Translation3f(2.0f,0.0f,0.0f)), tracer::Object(tracer::Bvh<tracer::Triangle>(triangles(0.0f)))));
+	scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,2.5f,1.0f), 0.5f));
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -4), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	int w = 48, h = 32;
+
+	render::PrimaryHitCache cache(8, 2);
+	tracer::stats::reset();
+	REQUIRE( cache.update(scene, camera, w, h) );
+	REQUIRE( tracer::stats::total().primitives() > 0 );
+
+	std::vector<std::optional<tracer::Hit>> hits(std::size_t(w*h));
+	tracer::stats::reset();
+	cache.shade([&] (int i, int j, const tracer::Ray&, const std::optional<tracer::Hit>& hit) { hits[std::size_t(j*w + i)] = hit; });
+	REQUIRE( tracer::stats::total().nodes == 0 );
+	REQUIRE( tracer::stats::total().primitives() == 0 );
+
+	std::vector<int> seen(scene.objects().size(), 0);
+	for (int j = 0; j<h; ++j) for (int i = 0; i<w; ++i) {
+		const std::optional<tracer::Hit>& hit = hits[std::size_t(j*w + i)];
+		std::optional<tracer::Hit> expected = scene.trace(cache.ray(i,j));
+		REQUIRE( bool(hit) == bool(expected) );
+		if (!hit) continue;
+		++seen[std::size_t(cache.object(i,j))];
+		REQUIRE( hit->distance() == Approx(expected->distance()) );
+		REQUIRE( hit->normal().isApprox(expected->normal(), 1.e-4f) );
+		REQUIRE( hit->primitive() == expected->primitive() );
+	}
+	for (int s : seen) REQUIRE( s > 0 );
+}
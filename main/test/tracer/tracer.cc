@@ -2,7 +2,12 @@
 #include <catch.hpp>
 #include <Eigen/Dense>
 #include <Eigen/Geometry>
+#include <set>
+#include <thread>
 #include <tracer/tracer.h>
+#include <scenes/procedural.h>
+#include <import/simplify.h>
+#include <tracer/accelerators/bvh-quality.h>
 
 TEST_CASE( "Intersection with plane", "[plane]" ) {
 	tracer::Ray r(Eigen::Vector3f(0.0f,0.0f,2.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f));
@@ -145,6 +150,62 @@ TEST_CASE( "Intersection with pack of boxes", "[pack][box]" ) {
 	REQUIRE( hit->distance() == Approx(1.0f) );
 }
 
+TEST_CASE( "Partially filled packs only trace their valid lanes", "[pack][triangle][sphere]" ) {
+	//A curved patch with vertex normals and tangents, 5 triangles in a pack of 8
+	std::vector<tracer::Triangle> triangles;
+	auto vertex = [] (float x, float y) { return Eigen::Vector3f(x, y, 0.2f*x*x); };
+	auto normal = [] (float x, float) { return Eigen::Vector3f(-0.4f*x, 0.0f, 1.0f).normalized(); };
+	auto tangent = [] (float x, float) { return Eigen::Vector3f(1.0f, 0.0f, 0.4f*x).normalized(); };
+	for (int i = 0; i<5; ++i) {
+		float x0 = float(i) - 2.5f, x1 = x0 + 1.0f;
+		triangles.push_back(tracer::Triangle(vertex(x0,-1), normal(x0,-1), tangent(x0,-1), vertex(x1,-1), normal(x1,-1), tangent(x1,-1),
+		                                     vertex(x0, 1), normal(x0, 1), tangent(x0, 1)));
+	}
+	tracer::Pack<tracer::Triangle,8> pack(triangles, 3);
+	tracer::List<tracer::Triangle> list(triangles);
+	REQUIRE( pack.size() == 5 );
+	REQUIRE( pack.index(4) == 7 );
+	REQUIRE( pack.bounds().min().isApprox(list.bounds().min()) );
+	REQUIRE( pack.bounds().max().isApprox(list.bounds().max()) );
+
+	for (float x = -3.0f; x<=3.0f; x+=0.37f) {
+		tracer::Ray r(Eigen::Vector3f(x,-0.5f,4.0f), Eigen::Vector3f(0.1f,0.0f,-1.0f).normalized());
+		std::optional<tracer::Hit> expected = list.trace(r), hit = pack.trace(r);
+		REQUIRE( bool(hit) == bool(expected) );
+		if (!hit) continue;
+		REQUIRE( hit->distance() == Approx(expected->distance()) );
+		REQUIRE( hit->normal().isApprox(expected->normal(), 1.e-4f) );
+		REQUIRE( hit->tangent().isApprox(expected->tangent(), 1.e-4f) );
+	}
+
+	//Packs of spheres from a collection that does not fill the last one
+	std::vector<tracer::Sphere> spheres;
+	for (int i = 0; i<11; ++i) spheres.push_back(tracer::Sphere(Eigen::Vector3f(float(i), 0.0f, 0.0f), 0.3f));
+	auto packs = tracer::packs(spheres);
+	REQUIRE( packs.back().index(packs.back().size() - 1) == 10 );
+	//A ray behind the last sphere: nothing can be hit from the padding
+	REQUIRE( !packs.back().trace(tracer::Ray(Eigen::Vector3f(20.0f,0.0f,-1.0f), Eigen::Vector3f(0.0f,0.0f,1.0f))) );
+	std::optional<tracer::Hit> last = packs.back().trace(tracer::Ray(Eigen::Vector3f(10.0f,0.0f,-1.0f), Eigen::Vector3f(0.0f,0.0f,1.0f)));
+	REQUIRE( last );
+	REQUIRE( last->distance() == Approx(0.7f) );
+}
+
+TEST_CASE( "Geometry hash of packs of triangles sees translations within their plane", "[pack][triangle][hash]" ) {
+	auto triangles = [] (const Eigen::Vector3f& offset) {
+		return std::vector<tracer::Triangle>{tracer::Triangle(Eigen::Vector3f(-1,-1,1), Eigen::Vector3f(1,-1,1), Eigen::Vector3f(0,1,1)),
+			tracer::Triangle(Eigen::Vector3f(-1,-1,2) + offset, Eigen::Vector3f(1,-1,2) + offset, Eigen::Vector3f(0,1,2) + offset)};
+	};
+	tracer::Pack<tracer::Triangle,4> pack(triangles(Eigen::Vector3f::Zero())), same(triangles(Eigen::Vector3f::Zero()));
+	tracer::Pack<tracer::Triangle,4> moved(triangles(Eigen::Vector3f(0.5f,0.25f,0.0f)));
+	REQUIRE( same.geometry_hash() == pack.geometry_hash() );
+	//Same supporting planes (z = 1 and z = 2), different triangles
+	for (int k = 0; k<3; ++k) REQUIRE( (moved.vertices(k).col(2) == pack.vertices(k).col(2)).all() );
+	REQUIRE( moved.geometry_hash() != pack.geometry_hash() );
+	tracer::Ray r(Eigen::Vector3f(0.9f,0.4f,0.0f), Eigen::Vector3f(0.0f,0.0f,1.0f));
+	REQUIRE( !pack.trace(r) );
+	REQUIRE( moved.trace(r) );
+}
+
 TEST_CASE( "Intersection with instance of sphere (translation)", "[instance][sphere][translation]" ) {
 	tracer::Ray r(Eigen::Vector3f(0.0f,0.0f,2.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f));
 	tracer::Instance i1(Eigen::Translation3f(0.0f,0.0f,1.0f),tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
@@ -179,5 +240,654 @@ TEST_CASE( "Intersection with instance of sphere (composition)", "[instance][sph
 	REQUIRE( !hit );
 }
 
+TEST_CASE( "Intersection with instance of pack of spheres (devirtualized)", "[instance][pack][sphere][scaling]" ) {
+	tracer::Ray r(Eigen::Vector3f(0.0f,0.0f,4.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f));
+	auto spheres = tracer::pack(
+		tracer::Sphere(Eigen::Vector3f(0,0,-10), 2),
+		tracer::Sphere(Eigen::Vector3f(0,0,0), 1));
+	tracer::Instance i1(Eigen::Translation3f(0.0f,0.0f,1.0f)*Eigen::Vector3f(1.0f,1.0f,2.0f).asDiagonal(),spheres);
+	static_assert(std::is_same_v<decltype(i1),tracer::Instance<tracer::Pack<tracer::Sphere,2>>>);
+	std::optional<tracer::Hit> hit = i1.trace(r);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(1.0f) );
+	REQUIRE( hit->point()[2] == Approx(3.0f) );
+	REQUIRE( hit->normal()[2] == Approx(1.0f) );
+	REQUIRE( hit->normal().norm() == Approx(1.0f) );
+}
+
+TEST_CASE( "Tangents of instances under non-uniform scale stay perpendicular to the normal", "[instance][sphere][triangle][scaling]" ) {
+	Eigen::Affine3f transform(Eigen::Translation3f(0.0f,0.0f,1.0f)*Eigen::Vector3f(1.0f,3.0f,0.5f).asDiagonal());
+	transform.linear()(0,1) = 0.7f; //And a shear
+	tracer::Instance spheres(transform, tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
+	tracer::Instance triangles(transform, tracer::Triangle(Eigen::Vector3f(-1,-1,0), Eigen::Vector3f(1,-1,0.5f), Eigen::Vector3f(0,1,-0.5f)));
+	int hits = 0;
+	for (int i = -4; i<=4; ++i) for (int j = -4; j<=4; ++j) {
+		tracer::Ray r(Eigen::Vector3f(0.2f*float(i), 0.5f*float(j), 5.0f), Eigen::Vector3f(0.1f,-0.2f,-1.0f).normalized());
+		for (const std::optional<tracer::Hit>& hit : { spheres.trace(r), triangles.trace(r) }) if (hit) {
+			++hits;
+			REQUIRE( std::abs(hit->normal().dot(hit->tangent())) < 1.e-4f );
+			REQUIRE( hit->tangent().norm() == Approx(1.0f) );
+		}
+	}
+	REQUIRE( hits > 0 );
+}
+
+TEST_CASE( "Intersection with instance reference of list of triangles (rotation)", "[instance][list][triangle][rotation]" ) {
+	tracer::Ray r(Eigen::Vector3f(2.0f,0.0f,0.0f), Eigen::Vector3f(-1.0f,0.0f,0.0f));
+	auto triangles = tracer::list(
+		tracer::Triangle(Eigen::Vector3f(-1,-1,-20), Eigen::Vector3f(1,-1,-20), Eigen::Vector3f(0,1,-20)),
+		tracer::Triangle(Eigen::Vector3f(-1,-1,0), Eigen::Vector3f(1,-1,0), Eigen::Vector3f(0,1,0)));
+	auto i1 = tracer::instance_ref(Eigen::Affine3f(Eigen::AngleAxisf(0.5f*float(M_PI),Eigen::Vector3f(0,1,0))),triangles);
+	std::optional<tracer::Hit> hit = i1.trace(r);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(2.0f) );
+	REQUIRE( std::abs(hit->normal()[0]) == Approx(1.0f) );
+	REQUIRE( &i1.object() == &triangles );
+	REQUIRE( i1.trace_shadow(r) );
+}
 
+TEST_CASE( "Intersection with polymorphic instance", "[instance][object]" ) {
+	tracer::Ray r(Eigen::Vector3f(0.0f,0.0f,2.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f));
+	tracer::Instance<> i1(Eigen::Translation3f(0.0f,0.0f,1.0f),tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
+	std::optional<tracer::Hit> hit = i1.trace(r);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(0.0f) );
+	REQUIRE( hit->normal()[2] == Approx(1.0f) );
+}
+
+TEST_CASE( "Morton ordered tiles cover the image", "[sensor][tiles]" ) {
+	REQUIRE( tracer::morton_encode(3,5) == 0b100111 );
+	REQUIRE( tracer::morton_decode(tracer::morton_encode(1234,567))[0] == 1234 );
+	REQUIRE( tracer::morton_decode(tracer::morton_encode(1234,567))[1] == 567 );
+	int w = 37, h = 21;
+	std::vector<int> covered(w*h,0);
+	for (const tracer::Tile& tile : tracer::tiles(w,h,8))
+		for (const auto& p : tracer::pixels(tile)) ++covered[p[1]*w+p[0]];
+	REQUIRE( std::all_of(covered.begin(), covered.end(), [] (int c) { return c == 1; }) );
+}
+
+TEST_CASE( "Batched camera rays", "[sensor][pinhole]" ) {
+	tracer::Pinhole camera(Eigen::Vector3f( 0, 0, -3), Eigen::Vector3f( 0, 0, 2), Eigen::Vector3f( 0, 1, 0));
+	auto pixels = tracer::pixels(tracer::Tile{4,6,10,9});
+	tracer::RayBlock<8> block = camera.rays<8>(&pixels[2], 7, 16, 16);
+	REQUIRE( block.size() == 7 );
+	for (int k = 0; k<block.size(); ++k) {
+		tracer::Ray r = camera.ray((float(pixels[2+k][0])+0.5f)/8.0f - 1.0f, (float(pixels[2+k][1])+0.5f)/8.0f - 1.0f);
+		REQUIRE( (block.ray(k).origin() - r.origin()).norm() == Approx(0.0f).margin(1.e-6f) );
+		REQUIRE( (block.ray(k).direction() - r.direction()).norm() == Approx(0.0f).margin(1.e-5f) );
+	}
+}
+
+TEST_CASE( "Prepared ray", "[ray][box]" ) {
+	tracer::PreparedRay r(tracer::Ray(Eigen::Vector3f(0.0f,0.0f,2.0f), Eigen::Vector3f(0.1f,-0.2f,-1.0f)));
+	REQUIRE( r.octant() == 6 );
+	REQUIRE( r.permutation()[0] == 1 );
+	REQUIRE( r.permutation()[1] == 0 );
+	REQUIRE( r.permutation()[2] == 2 );
+	REQUIRE( r.shear()[0] == Approx(0.2f) );
+	REQUIRE( r.shear()[2] == Approx(-1.0f) );
+
+	//Boxes (single and packed) from every octant
+	tracer::AxisAlignedBox b(Eigen::Vector3f(-1.0f,-1.0f,-1.0f), Eigen::Vector3f(1.0f,1.0f,1.0f));
+	auto boxes = tracer::pack(b, tracer::AxisAlignedBox(Eigen::Vector3f(5.0f,5.0f,5.0f), Eigen::Vector3f(6.0f,6.0f,6.0f)));
+	for (int octant = 0; octant < 8; ++octant) {
+		Eigen::Vector3f d((octant&1)?-1.0f:1.0f, (octant&2)?-1.0f:1.0f, (octant&4)?-1.0f:1.0f);
+		tracer::Ray r(-3.0f*d, d.normalized());
+		REQUIRE( tracer::PreparedRay(r).octant() == octant );
+		std::optional<tracer::Hit> hit = b.trace(r);
+		REQUIRE( hit );
+		REQUIRE( hit->distance() == Approx(2.0f*std::sqrt(3.0f)) );
+		hit = boxes.trace(r);
+		REQUIRE( hit );
+		REQUIRE( hit->distance() == Approx(2.0f*std::sqrt(3.0f)) );
+	}
+}
+
+TEST_CASE( "Rays do not slip between triangles that share an edge", "[ray][triangle]" ) {
+	//A fan of thin triangles on a tilted plane (Möller-Trumbore misses hundreds of these rays)
+	Eigen::Vector3f center(0.0f, 0.0f, 0.7f);
+	std::vector<tracer::Triangle> fan;
+	const int n = 97;
+	auto rim = [&] (int i) { float a = 2.0f*float(M_PI)*float(i%n)/float(n); return Eigen::Vector3f(std::cos(a), std::sin(a), 0.7f + 0.2f*std::cos(a) - 0.3f*std::sin(a)); };
+	for (int i = 0; i<n; ++i) fan.push_back(tracer::Triangle(center, rim(i), rim(i+1)));
+	//Packs and the Bvh (whose leaves are packs) run the same test as single triangles
+	tracer::List<tracer::Triangle> list(fan);
+	tracer::List packs(tracer::packs(fan));
+	tracer::Bvh<tracer::Triangle> bvh(fan);
+	for (const tracer::ObjectBase* mesh : std::initializer_list<const tracer::ObjectBase*>{ &list, &packs, &bvh }) {
+		int missed = 0;
+		for (int i = 0; i<n; ++i) for (int k = 1; k<64; ++k) {
+			//Aimed exactly at points of the shared edges, from several directions
+			Eigen::Vector3f target = center + (float(k)/64.0f)*(rim(i) - center);
+			for (const Eigen::Vector3f& d : { Eigen::Vector3f(0.0f,0.0f,-1.0f), Eigen::Vector3f(0.3f,-0.2f,-1.0f), Eigen::Vector3f(-0.7f,0.1f,-0.4f) })
+				if (!mesh->trace(tracer::Ray(target - 3.0f*d, d))) ++missed;
+		}
+		REQUIRE( missed == 0 );
+	}
+}
+
+TEST_CASE( "Scene allocated in an arena", "[scene][arena]" ) {
+	tracer::Ray r(Eigen::Vector3f(0.0f,0.0f,2.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f));
+	std::unique_ptr<tracer::Scene> copy;
+	{
+		tracer::Scene scene(std::make_shared<tracer::Arena>(1024));
+		scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f));
+		scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,-5.0f), 1.0f));
+		scene.add(tracer::Object(tracer::Plane(Eigen::Vector3f(0.0f,0.0f,1.0f), Eigen::Vector3f(0.0f,0.0f,-10.0f))));
+		REQUIRE( scene.arena() );
+		copy = std::make_unique<tracer::Scene>(scene);
+	}
+	//The copy keeps the arena alive
+	std::optional<tracer::Hit> hit = copy->trace(r);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(1.0f) );
+	REQUIRE( copy->trace_shadow(tracer::Ray(Eigen::Vector3f(0.0f,0.0f,-7.0f), Eigen::Vector3f(0.0f,0.0f,-1.0f))) );
+
+	//Reassigning a scene releases its objects before its arena (run under ASan to see it otherwise)
+	auto build = [] (float z) {
+		tracer::Scene scene(std::make_shared<tracer::Arena>(1024));
+		for (int i = 0; i<16; ++i) scene.add(tracer::Sphere(Eigen::Vector3f(float(i),0.0f,z), 0.5f));
+		return scene;
+	};
+	tracer::Scene scene = build(0.0f);
+	scene = build(-1.0f);
+	hit = scene.trace(r);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(2.5f) );
+	tracer::Scene other = build(-2.0f);
+	scene = other;
+	other = build(-3.0f);
+	REQUIRE( scene.trace(r)->distance() == Approx(3.5f) );
+	REQUIRE( other.trace(r)->distance() == Approx(4.5f) );
+}
 
+TEST_CASE( "Bounds", "[bounds][pack][instance]" ) {
+	auto spheres = tracer::pack<4>(std::vector<tracer::Sphere>{tracer::Sphere(Eigen::Vector3f(0.0f,0.0f,0.0f), 1.0f), tracer::Sphere(Eigen::Vector3f(3.0f,0.0f,0.0f), 0.5f)});
+	tracer::Bounds b = spheres.bounds();
+	REQUIRE( (b.min() - Eigen::Vector3f(-1.0f,-1.0f,-1.0f)).norm() == Approx(0.0f).margin(1.e-6f) );
+	REQUIRE( (b.max() - Eigen::Vector3f(3.5f,1.0f,1.0f)).norm() == Approx(0.0f).margin(1.e-6f) );
+	tracer::Instance instance(Eigen::Translation3f(0.0f,2.0f,0.0f)*Eigen::Scaling(2.0f), spheres);
+	b = instance.bounds();
+	REQUIRE( (b.min() - Eigen::Vector3f(-2.0f,0.0f,-2.0f)).norm() == Approx(0.0f).margin(1.e-5f) );
+	REQUIRE( (b.max() - Eigen::Vector3f(7.0f,4.0f,2.0f)).norm() == Approx(0.0f).margin(1.e-5f) );
+	REQUIRE( !tracer::Plane().bounds().bounded() );
+	REQUIRE( !tracer::Object(tracer::Plane()).bounds().bounded() );
+}
+
+TEST_CASE( "Hits report the primitive that was hit", "[hit][pack][bvh][compressed][instance]" ) {
+	std::vector<tracer::Triangle> triangles;
+	for (int i = 0; i<20; ++i) triangles.push_back(tracer::Triangle(Eigen::Vector3f(float(i),0,0), Eigen::Vector3f(float(i)+0.9f,0,0), Eigen::Vector3f(float(i),0.9f,0)));
+	auto ray = [] (int i) { return tracer::Ray(Eigen::Vector3f(float(i)+0.2f,0.2f,-1.0f), Eigen::Vector3f(0.0f,0.0f,1.0f)); };
+	tracer::List<tracer::Triangle> list(triangles);
+	tracer::List packs(tracer::packs(triangles));
+	tracer::CompressedMesh mesh(triangles);
+	tracer::Bvh<tracer::Triangle> bvh(triangles);
+	tracer::Instance instance(Eigen::Affine3f(Eigen::Translation3f(0.0f,0.0f,1.0f)), packs);
+	tracer::Scene scene;
+	scene.add(tracer::Sphere(Eigen::Vector3f(0.0f,5.0f,0.0f), 1.0f));
+	scene.add(mesh);
+	std::set<std::int32_t> bvh_primitives;
+	for (int i = 0; i<20; ++i) {
+		REQUIRE( list.trace(ray(i))->primitive() == i );
+		REQUIRE( packs.trace(ray(i))->primitive() == i );
+		REQUIRE( instance.trace(ray(i))->primitive() == i );
+		REQUIRE( scene.trace(ray(i))->primitive() == i ); //Numbered inside the mesh, not by the scene
+		std::optional<tracer::Hit> hit = mesh.trace(ray(i));
+		REQUIRE( hit->primitive() == i ); //In the order of the collection, not the one of the clusters
+		//The Bvh numbers the triangles in the order of its leaves
+		hit = bvh.trace(ray(i));
+		REQUIRE( hit->primitive() >= 0 );
+		REQUIRE( hit->primitive() < 20 );
+		bvh_primitives.insert(hit->primitive());
+	}
+	REQUIRE( bvh_primitives.size() == 20 );
+	//A lone primitive has no index, but a List numbers it
+	tracer::Ray sphere_ray(Eigen::Vector3f(0.0f,5.0f,-3.0f), Eigen::Vector3f(0.0f,0.0f,1.0f));
+	REQUIRE( tracer::Sphere(Eigen::Vector3f(0.0f,5.0f,0.0f), 1.0f).trace(sphere_ray)->primitive() == -1 );
+	REQUIRE( scene.trace(sphere_ray)->primitive() == 0 );
+}
+
+TEST_CASE( "Tile frustum culling", "[sensor][frustum][scene][bvh][compressed]" ) {
+	tracer::Scene scene;
+	scene.add(tracer::Plane(Eigen::Vector3f(0.0f,1.0f,0.0f), Eigen::Vector3f(0.0f,-2.0f,0.0f)));
+	for (int j = -4; j<=4; ++j) for (int i = -4; i<=4; ++i)
+		scene.add(tracer::Sphere(Eigen::Vector3f(float(i), float(j), 5.0f), 0.3f));
+	tracer::Pinhole camera(Eigen::Vector3f(0.0f,0.0f,0.0f), Eigen::Vector3f(0.0f,0.0f,1.0f), Eigen::Vector3f(0.0f,1.0f,0.0f));
+	int w = 64, h = 64;
+	for (const tracer::Tile& tile : tracer::tiles(w,h,16)) {
+		tracer::Frustum frustum = camera.frustum(tile,w,h);
+		auto candidates = tracer::cull(scene, frustum);
+		REQUIRE( candidates.size() < scene.objects().size() );
+		REQUIRE( candidates.size() > 0 ); //The plane is never culled
+		for (const std::array<int,2>& p : tracer::pixels(tile)) {
+			tracer::Ray r = camera.ray((float(p[0])+0.5f)*2.0f/float(w) - 1.0f, (float(p[1])+0.5f)*2.0f/float(h) - 1.0f);
+			REQUIRE( frustum.contains(r.at(1.0f)) );
+			std::optional<tracer::Hit> expected = scene.trace(r), hit = candidates.trace(r);
+			REQUIRE( bool(hit) == bool(expected) );
+			if (hit) REQUIRE( hit->distance() == Approx(expected->distance()) );
+		}
+	}
+
+	//Accelerators are culled through their nodes: a whole scene in one Bvh or mesh still gets culled
+	std::vector<tracer::Sphere> spheres;
+	std::vector<tracer::Triangle> triangles;
+	for (int j = -8; j<8; ++j) for (int i = -8; i<8; ++i) {
+		spheres.push_back(tracer::Sphere(Eigen::Vector3f(0.5f*float(i) + 0.25f, 0.5f*float(j) + 0.25f, 5.0f), 0.15f));
+		Eigen::Vector3f p(0.5f*float(i), 0.5f*float(j), 6.0f), dx(0.5f,0.0f,0.0f), dy(0.0f,0.5f,0.0f);
+		triangles.push_back(tracer::Triangle(p, p + dx, p + dy));
+		triangles.push_back(tracer::Triangle(p + dx, p + dx + dy, p + dy));
+	}
+	tracer::Bvh<tracer::Sphere> bvh(spheres);
+	tracer::CompressedMesh mesh(triangles);
+	for (const tracer::Tile& tile : tracer::tiles(w,h,16)) {
+		tracer::Frustum frustum = camera.frustum(tile,w,h);
+		auto bvh_candidates = tracer::cull(bvh, frustum);
+		auto mesh_candidates = tracer::cull(mesh, frustum);
+		REQUIRE( bvh_candidates.size() < bvh.leaves().size() );
+		REQUIRE( mesh_candidates.size() < mesh.clusters().size() );
+		for (const std::array<int,2>& p : tracer::pixels(tile)) {
+			tracer::Ray r = camera.ray((float(p[0])+0.5f)*2.0f/float(w) - 1.0f, (float(p[1])+0.5f)*2.0f/float(h) - 1.0f);
+			std::optional<tracer::Hit> expected = bvh.trace(r), hit = bvh_candidates.trace(r);
+			REQUIRE( bool(hit) == bool(expected) );
+			if (hit) REQUIRE( hit->distance() == Approx(expected->distance()) );
+			expected = mesh.trace(r); hit = mesh_candidates.trace(r);
+			REQUIRE( bool(hit) == bool(expected) );
+			if (hit) {
+				REQUIRE( hit->distance() == Approx(expected->distance()) );
+				REQUIRE( hit->normal().isApprox(expected->normal()) );
+			}
+		}
+	}
+}
+
+TEST_CASE( "Compressed mesh", "[triangle][compressed]" ) {
+	//A smooth bumpy grid (vertices are shared)
+	int n = 24;
+	auto vertex = [n] (int i, int j) {
+		float x = 2.0f*float(i)/float(n) - 1.0f, z = 2.0f*float(j)/float(n) - 1.0f;
+		float dx = 0.8f*std::cos(4.0f*x)*std::cos(3.0f*z), dz = -0.6f*std::sin(4.0f*x)*std::sin(3.0f*z);
+		return std::array<Eigen::Vector3f,3>{Eigen::Vector3f(x, 0.2f*std::sin(4.0f*x)*std::cos(3.0f*z), z),
+			Eigen::Vector3f(-dx, 1.0f, -dz).normalized(), Eigen::Vector3f(1.0f, dx, 0.0f).normalized()};
+	};
+	auto triangle = [] (const std::array<Eigen::Vector3f,3>& a, const std::array<Eigen::Vector3f,3>& b, const std::array<Eigen::Vector3f,3>& c) {
+		return tracer::Triangle(a[0], a[1], a[2], b[0], b[1], b[2], c[0], c[1], c[2]);
+	};
+	std::vector<tracer::Triangle> triangles;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<n; ++i) {
+		triangles.push_back(triangle(vertex(i,j), vertex(i,j+1), vertex(i+1,j)));
+		triangles.push_back(triangle(vertex(i+1,j), vertex(i,j+1), vertex(i+1,j+1)));
+	}
+	tracer::CompressedMesh mesh(triangles);
+	REQUIRE( mesh.size() == triangles.size() );
+	REQUIRE( mesh.clusters().size() == (triangles.size() + 63)/64 );
+	REQUIRE( 4*mesh.bytes() < triangles.size()*sizeof(tracer::Triangle) );
+	REQUIRE( (mesh.triangle(100).point0() - triangles[mesh.original(100)].point0()).norm() < 1.e-4f );
+
+	//Clusters are spatially compact whatever the order of the triangles
+	auto footprint = [] (const tracer::CompressedMesh& m) {
+		float sol = 0.0f;
+		for (const auto& c : m.clusters()) sol += (c.upper[0] - c.lower[0])*(c.upper[2] - c.lower[2]);
+		return sol;
+	};
+	std::vector<tracer::Triangle> shuffled = triangles;
+	std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+	tracer::CompressedMesh spatial(shuffled);
+	REQUIRE( spatial.clusters().size() == mesh.clusters().size() );
+	//The grid covers 4 and random clusters would each cover most of it (about 70 for the 18 of them)
+	REQUIRE( footprint(spatial) < 3.0f*4.0f );
+	std::vector<bool> found(shuffled.size(), false);
+	for (std::uint32_t t = 0; t<std::uint32_t(spatial.size()); ++t) {
+		REQUIRE( !found[spatial.original(t)] );
+		found[spatial.original(t)] = true;
+		REQUIRE( (spatial.triangle(t).point1() - shuffled[spatial.original(t)].point1()).norm() < 1.e-4f );
+	}
+
+	auto exact = tracer::list(triangles);
+	std::mt19937 random(0);
+	std::uniform_real_distribution<float> uniform(-0.8f,0.8f);
+	for (int k = 0; k<500; ++k) {
+		//Every vertical ray over the grid hits it: decoding does not open cracks
+		tracer::Ray r(Eigen::Vector3f(uniform(random), 1.0f, uniform(random)), Eigen::Vector3f(0.1f*uniform(random), -1.0f, 0.1f*uniform(random)).normalized());
+		auto expected = exact.trace_general(tracer::PreparedRay(r));
+		std::optional<tracer::Hit> hit = mesh.trace(r);
+		REQUIRE( expected );
+		REQUIRE( hit );
+		REQUIRE( hit->distance() == Approx(std::get<0>(std::get<0>(*expected))).margin(1.e-3f) );
+		REQUIRE( hit->normal()[1] > 0.5f );
+		REQUIRE( mesh.trace_shadow(r) );
+	}
+	REQUIRE( !mesh.trace(tracer::Ray(Eigen::Vector3f(0.0f,1.0f,0.0f), Eigen::Vector3f(0.0f,1.0f,0.0f))) );
+}
+
+TEST_CASE( "Compressed mesh without cracks between clusters", "[triangle][compressed]" ) {
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(64);
+	tracer::CompressedMesh mesh(triangles);
+	REQUIRE( mesh.clusters().size() > 4 );
+	auto cluster = [&] (std::size_t t) {
+		std::size_t c = 0;
+		while ((c + 1 < mesh.clusters().size()) && (mesh.clusters()[c+1].first_triangle <= t)) ++c;
+		return c;
+	};
+	//Where each triangle of the collection is stored
+	std::vector<std::uint32_t> stored(triangles.size());
+	for (std::uint32_t t = 0; t<std::uint32_t(triangles.size()); ++t) stored[mesh.original(t)] = t;
+	//Every vertex decodes to the same position in every cluster that has it
+	std::map<std::array<float,3>,Eigen::Vector3f> decoded;
+	for (std::size_t t = 0; t<triangles.size(); ++t) {
+		tracer::Triangle d = mesh.triangle(stored[t]);
+		std::array<Eigen::Vector3f,3> original{triangles[t].point0(), triangles[t].point1(), triangles[t].point2()};
+		std::array<Eigen::Vector3f,3> points{d.point0(), d.point1(), d.point2()};
+		for (int k = 0; k<3; ++k) {
+			auto found = decoded.emplace(std::array<float,3>{original[k][0], original[k][1], original[k][2]}, points[k]).first;
+			REQUIRE( found->second == points[k] );
+		}
+	}
+	//Rays through the decoded edges between triangles of different clusters do not slip through
+	int seams = 0;
+	for (std::size_t t = 0; t<triangles.size(); t+=2) {
+		//The first triangle of each quad shares its diagonal with the second one, and its lower edge with the second one of the row below
+		for (std::size_t other : {t + 1, (t >= 2*64) ? t + 1 - 2*64 : t + 1}) {
+			if (cluster(stored[other]) == cluster(stored[t])) continue;
+			++seams;
+			tracer::Triangle a = mesh.triangle(stored[t]), b = mesh.triangle(stored[other]);
+			std::vector<Eigen::Vector3f> shared;
+			for (const Eigen::Vector3f& p : {a.point0(), a.point1(), a.point2()})
+				for (const Eigen::Vector3f& q : {b.point0(), b.point1(), b.point2()}) if (p == q) shared.push_back(p);
+			REQUIRE( shared.size() == 2 );
+			for (float s : {0.0f, 0.25f, 0.5f, 1.0f}) {
+				Eigen::Vector3f target = (1.0f - s)*shared[0] + s*shared[1];
+				if (std::max(std::abs(target[0]), std::abs(target[2])) >= 1.0f) continue; //Rays may miss the border of the mesh
+				tracer::Ray r(target + Eigen::Vector3f(0.1f, 1.0f, 0.2f), Eigen::Vector3f(-0.1f, -1.0f, -0.2f).normalized());
+				REQUIRE( mesh.trace(r) );
+			}
+		}
+	}
+	REQUIRE( seams > 0 );
+}
+
+TEST_CASE( "Level of detail picked by the ray footprint", "[lod][instance][triangle]" ) {
+	std::vector<tracer::Triangle> sphere = scenes::sphere_triangles(48);
+	REQUIRE( simplify_triangles(sphere, 0.5f).size() < sphere.size()/4 );
+	auto mesh = lod_mesh(sphere, 4);
+	REQUIRE( mesh.levels() == 4 );
+	for (int l = 1; l<mesh.levels(); ++l) REQUIRE( mesh.error(l) > mesh.error(l-1) );
+
+	tracer::Ray exact(Eigen::Vector3f(0.0f,0.0f,-100.0f), Eigen::Vector3f(0.0f,0.0f,1.0f));
+	tracer::Ray cone = exact; cone.set_cone(0.0f, 0.01f);
+	REQUIRE( mesh.select(exact, 99.0f) == 0 );
+	REQUIRE( mesh.select(cone, 1.0f) == 0 );
+	REQUIRE( mesh.select(cone, 99.0f) == 3 );
+
+	//Instances trace the shared levels with the cone in their local space: scaling them up picks finer levels
+	std::optional<tracer::Hit> hit = tracer::Instance(Eigen::Affine3f::Identity(), mesh).trace(cone);
+	REQUIRE( hit );
+	REQUIRE( hit->distance() == Approx(99.0f).margin(mesh.error(3)) );
+	REQUIRE( mesh.finest_used() == 3 );
+	//The footprint the level was picked with (entering the bounds at 99), back in world space
+	std::optional<tracer::Hit> scaled = tracer::Instance(Eigen::Affine3f(Eigen::Scaling(4.0f)), mesh).trace(cone);
+	REQUIRE( scaled );
+	REQUIRE( scaled->footprint() == Approx(cone.footprint(96.0f)) );
+	REQUIRE( mesh.finest_used() == 1 );
+
+	//Rays spawned from coarse hits see the same coarse surface. Without the footprint they would take the
+	//exact level, which is outside the (inscribed) coarse one, and hit it on their way out
+	int lit = 0, acne = 0;
+	for (int k = 0; k<100; ++k) {
+		float a = 0.6f*float(k)/100.0f - 0.3f;
+		tracer::Ray r(Eigen::Vector3f(a, 0.5f*a, -100.0f), Eigen::Vector3f(0.0f,0.0f,1.0f)); r.set_cone(0.0f, 0.01f);
+		std::optional<tracer::Hit> h = mesh.trace(r);
+		REQUIRE( h );
+		REQUIRE( h->footprint() > mesh.error(3) );
+		Eigen::Vector3f light = (h->normal() + Eigen::Vector3f(0.3f,0.2f,0.0f)).normalized();
+		if (!mesh.trace_shadow(h->spawn(light, 1.e-4f))) ++lit;
+		if (mesh.trace_shadow(tracer::Ray(h->point(), light, 1.e-4f))) ++acne;
+	}
+	REQUIRE( lit == 100 );
+	REQUIRE( acne > 50 );
+
+	//Trimming keeps the exact level for rays without a cone
+	REQUIRE( mesh.trim() == 0 ); //The finest level used is 1
+	auto other = lod_mesh(sphere, 4);
+	REQUIRE( other.trace(cone) );
+	REQUIRE( other.select(cone, 40.0f) < 3 );
+	REQUIRE( other.trim() == 2 );
+	REQUIRE( other.resident(0) );
+	REQUIRE( !other.resident(1) );
+	REQUIRE( !other.resident(2) );
+	REQUIRE( other.select(cone, 40.0f) == 3 ); //The closest coarser level that is still there
+	REQUIRE( other.select(exact, 99.0f) == 0 );
+	std::optional<tracer::Hit> h = other.trace(exact);
+	REQUIRE( h );
+	REQUIRE( h->footprint() == 0.0f );
+	REQUIRE( h->distance() == Approx(99.0f).margin(other.error(1)) );
+}
+
+TEST_CASE( "Packs seen from a fixed origin", "[pack][origin][plane][sphere][triangle]" ) {
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	std::vector<tracer::Sphere> spheres;
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(4);
+	for (int i = 0; i<13; ++i) spheres.push_back(tracer::Sphere(Eigen::Vector3f(uniform(random), 0.3f*uniform(random), uniform(random)), 0.2f));
+	auto sphere_list = tracer::List(tracer::packs(spheres));
+	auto triangle_list = tracer::List(tracer::packs(triangles));
+	tracer::List<tracer::Pack<tracer::Plane,4>> plane_list(std::vector<tracer::Pack<tracer::Plane,4>>{tracer::Pack<tracer::Plane,4>(std::vector<tracer::Plane>{
+		tracer::Plane(Eigen::Vector3f(0,1,0), Eigen::Vector3f(0,-1,0)), tracer::Plane(Eigen::Vector3f(1,0,0), Eigen::Vector3f(3,0,0)),
+		tracer::Plane(Eigen::Vector3f(0,0,1), Eigen::Vector3f(0,0,3))})});
+
+	Eigen::Vector3f origin(0.3f, 2.0f, -2.5f);
+	auto fixed_spheres = tracer::fixed_origin(sphere_list, origin);
+	auto fixed_triangles = tracer::fixed_origin(triangle_list, origin);
+	auto fixed_planes = tracer::fixed_origin(plane_list, origin);
+	auto same = [] (const std::optional<tracer::Hit>& a, const std::optional<tracer::Hit>& b) {
+		REQUIRE( bool(a) == bool(b) );
+		if (a) {
+			REQUIRE( a->distance() == Approx(b->distance()).epsilon(1.e-4f) );
+			REQUIRE( a->normal().isApprox(b->normal(), 1.e-3f) );
+		}
+	};
+	int hits = 0;
+	for (int k = 0; k<300; ++k) {
+		tracer::Ray r = tracer::ray_to(origin, Eigen::Vector3f(uniform(random), 0.3f*uniform(random), uniform(random)), 0.0f);
+		r.set_range_max(std::numeric_limits<float>::infinity());
+		same(fixed_spheres.trace(r), sphere_list.trace(r));
+		same(fixed_triangles.trace(r), triangle_list.trace(r));
+		same(fixed_planes.trace(r), plane_list.trace(r));
+		if (sphere_list.trace(r)) ++hits;
+	}
+	REQUIRE( hits > 0 );
+
+	//Shadow rays traced backwards from the light stop before the point they leave from
+	tracer::Ray shadow = tracer::ray_to(origin, spheres[0].center() + Eigen::Vector3f(0.0f,0.2f,0.0f));
+	REQUIRE( shadow.range_max() < (spheres[0].center() + Eigen::Vector3f(0.0f,0.2f,0.0f) - origin).norm() );
+	REQUIRE( fixed_spheres.trace_shadow(shadow) == sphere_list.trace_shadow(shadow) );
+}
+
+TEST_CASE( "Memory usage of scenes", "[memory][scene][instance]" ) {
+	tracer::Scene spheres;
+	for (int i = 0; i<10; ++i) spheres.add(tracer::Sphere(Eigen::Vector3f(float(i),0.0f,0.0f), 0.5f));
+	tracer::MemoryUsage usage = tracer::memory_usage(spheres);
+	REQUIRE( usage[tracer::MemoryUsage::geometry] == 10*sizeof(tracer::Sphere) );
+	REQUIRE( usage[tracer::MemoryUsage::nodes] >= 10*sizeof(tracer::Object) );
+	REQUIRE( usage[tracer::MemoryUsage::duplicated] == 0 );
+
+	//Packs of the same triangles: SoA data instead of geometry
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(4);
+	tracer::MemoryUsage packs = tracer::memory_usage(tracer::List(tracer::packs(triangles)));
+	REQUIRE( packs[tracer::MemoryUsage::geometry] == 0 );
+	REQUIRE( packs[tracer::MemoryUsage::packs] > 0 );
+
+	//Copies of a mesh in every instance are duplicates, an object shared by every instance is counted once
+	using Mesh = tracer::List<tracer::Triangle>;
+	Mesh mesh(triangles);
+	const tracer::Object shared(mesh);
+	tracer::Scene copied, instanced;
+	for (int i = 0; i<4; ++i) {
+		Eigen::Affine3f transform(Eigen::Translation3f(float(i),0.0f,0.0f));
+		copied.add(tracer::Instance<Mesh>(transform, mesh));
+		instanced.add(tracer::Instance<>(transform, shared));
+	}
+	tracer::MemoryUsage c = tracer::memory_usage(copied), s = tracer::memory_usage(instanced);
+	REQUIRE( c[tracer::MemoryUsage::geometry] == triangles.size()*sizeof(tracer::Triangle) );
+	REQUIRE( c[tracer::MemoryUsage::duplicated] >= 3*triangles.size()*sizeof(tracer::Triangle) );
+	REQUIRE( s[tracer::MemoryUsage::geometry] == triangles.size()*sizeof(tracer::Triangle) );
+	REQUIRE( s[tracer::MemoryUsage::duplicated] == 0 );
+
+	//Everything an arena reserved is accounted for, used or not
+	auto arena = std::make_shared<tracer::Arena>(1 << 16);
+	tracer::Scene in_arena(arena);
+	for (int i = 0; i<10; ++i) in_arena.add(tracer::Sphere(Eigen::Vector3f(float(i),0.0f,0.0f), 0.5f));
+	tracer::MemoryUsage a = tracer::memory_usage(in_arena);
+	REQUIRE( arena->used() > 10*sizeof(tracer::Sphere) );
+	REQUIRE( a.total() >= arena->reserved() );
+	REQUIRE( a[tracer::MemoryUsage::overhead] >= arena->reserved() - arena->used() );
+}
+
+TEST_CASE( "Bvh finds the same hits as a list", "[bvh][sphere][triangle][plane]" ) {
+	std::mt19937 random(2);
+	std::uniform_real_distribution<float> uniform(-1.0f,1.0f);
+	std::vector<tracer::Sphere> spheres;
+	for (int i = 0; i<500; ++i) spheres.push_back(tracer::Sphere(Eigen::Vector3f(uniform(random), uniform(random), uniform(random)), 0.05f));
+	std::vector<tracer::Triangle> triangles = scenes::terrain_triangles(16);
+	std::vector<tracer::Object> objects;
+	for (const auto& pack : tracer::packs(triangles)) objects.push_back(tracer::Object(pack));
+	objects.push_back(tracer::Object(tracer::Plane(Eigen::Vector3f(0,1,0), Eigen::Vector3f(0,-1,0)))); //Unbounded, kept aside
+
+	tracer::BvhSettings settings; settings.max_leaf_size = 3;
+	tracer::Bvh<tracer::Sphere> sphere_bvh(spheres, settings);
+	tracer::Bvh<tracer::Object> object_bvh(objects);
+	//Leaves of spheres are packs, which round like packs
+	tracer::List<tracer::Pack<tracer::Sphere,tracer::pack_width_v<tracer::Sphere>>> sphere_list(tracer::packs(spheres));
+	tracer::List<tracer::Object> object_list(objects);
+	REQUIRE( object_bvh.unbounded() == 1 );
+	REQUIRE( !object_bvh.bounds().bounded() );
+
+	for (int k = 0; k<500; ++k) {
+		tracer::Ray r(Eigen::Vector3f(uniform(random), uniform(random), -3.0f), Eigen::Vector3f(0.5f*uniform(random), 0.5f*uniform(random), 1.0f).normalized());
+		std::optional<tracer::Hit> a = sphere_bvh.trace(r), b = sphere_list.trace(r);
+		REQUIRE( bool(a) == bool(b) );
+		if (a) REQUIRE( a->distance() == Approx(b->distance()) );
+		REQUIRE( sphere_bvh.trace_shadow(r) == bool(b) );
+		a = object_bvh.trace(r); b = object_list.trace(r);
+		REQUIRE( bool(a) == bool(b) );
+		if (a) REQUIRE( a->distance() == Approx(b->distance()) );
+	}
+
+	tracer::BvhQuality q = tracer::quality(sphere_bvh);
+	REQUIRE( q.objects == spheres.size() );
+	REQUIRE( q.nodes == sphere_bvh.nodes().size() );
+	REQUIRE( q.nodes == 2*q.leaves - 1 );
+	REQUIRE( q.leaf_sizes.size() <= std::size_t(settings.max_leaf_size + 1) );
+	REQUIRE( q.sah_cost > 1.0 );
+	REQUIRE( q.sah_cost < double(spheres.size())/4.0 );
+	REQUIRE( (q.weighted_overlap >= 0.0 && q.weighted_overlap <= 1.0) );
+	REQUIRE( (q.weighted_empty_space >= 0.0 && q.weighted_empty_space <= 1.0) );
+
+	//Tuned primitives get the tuned leaf size and leaves in packs of the tuned width
+	tracer::Bvh<tracer::Triangle> triangle_bvh(triangles);
+	tracer::List<tracer::Triangle> triangle_list(triangles);
+	REQUIRE( triangle_bvh.settings().max_leaf_size == tracer::pack_width<tracer::Triangle>::leaf_size );
+	REQUIRE( std::is_same_v<tracer::Bvh<tracer::Triangle>::Leaf, tracer::Pack<tracer::Triangle,tracer::pack_width_v<tracer::Triangle>>> );
+	REQUIRE( object_bvh.settings().max_leaf_size == 4 );
+	std::size_t lanes = 0;
+	for (const auto& pack : triangle_bvh.leaves()) lanes += std::size_t(pack.size());
+	REQUIRE( lanes == triangles.size() );
+	//Leaves cost their packs, as in the builder
+	tracer::BvhQuality tq = tracer::quality(triangle_bvh);
+	REQUIRE( tq.objects == triangles.size() );
+	REQUIRE( tq.packs == triangle_bvh.leaves().size() );
+	REQUIRE( tq.packs < tq.objects );
+	//A single leaf of one full pack costs as much as testing one object
+	constexpr int width = tracer::Bvh<tracer::Triangle>::width;
+	tracer::BvhSettings single; single.max_leaf_size = width; single.traversal_cost = 1000.0f;
+	tracer::Bvh<tracer::Triangle> one_pack(std::vector<tracer::Triangle>(triangles.begin(), triangles.begin() + width), single);
+	REQUIRE( one_pack.nodes().size() == 1 );
+	REQUIRE( tracer::quality(one_pack).leaf_packs == std::vector<std::size_t>{0, 1} );
+	REQUIRE( tracer::quality(one_pack).sah_cost == Approx(single.intersection_cost) );
+	for (int k = 0; k<500; ++k) {
+		tracer::Ray r(Eigen::Vector3f(uniform(random), 3.0f, uniform(random)), Eigen::Vector3f(0.5f*uniform(random), -1.0f, 0.5f*uniform(random)).normalized());
+		std::optional<tracer::Hit> a = triangle_bvh.trace(r), b = triangle_list.trace(r);
+		REQUIRE( bool(a) == bool(b) );
+		if (a) {
+			REQUIRE( a->distance() == Approx(b->distance()) );
+			REQUIRE( a->normal().dot(b->normal()) == Approx(1.0f) );
+		}
+		REQUIRE( triangle_bvh.trace_shadow(r) == bool(b) );
+	}
+	//Rays aimed exactly at the edges shared by two triangles hit one of them
+	std::map<std::array<float,6>,int> edges;
+	for (const tracer::Triangle& t : triangles) {
+		std::array<Eigen::Vector3f,3> p{t.point0(), t.point1(), t.point2()};
+		for (int e = 0; e<3; ++e) {
+			Eigen::Vector3f a = p[e], b = p[(e+1)%3];
+			if (std::lexicographical_compare(b.data(), b.data() + 3, a.data(), a.data() + 3)) std::swap(a, b);
+			++edges[{a[0], a[1], a[2], b[0], b[1], b[2]}];
+		}
+	}
+	int shared = 0;
+	for (const auto& [e, count] : edges) if (count == 2) {
+		++shared;
+		for (float s : {0.25f, 0.5f, 0.75f}) {
+			Eigen::Vector3f target = (1.0f - s)*Eigen::Vector3f(e[0], e[1], e[2]) + s*Eigen::Vector3f(e[3], e[4], e[5]);
+			tracer::Ray r(target + Eigen::Vector3f(0.1f, 1.0f, 0.2f), Eigen::Vector3f(-0.1f, -1.0f, -0.2f).normalized());
+			REQUIRE( triangle_bvh.trace(r) );
+			REQUIRE( triangle_bvh.trace_shadow(r) );
+		}
+	}
+	REQUIRE( shared > 0 );
+}
+
+TEST_CASE( "Samplers are stratified and deterministic", "[sampler]" ) {
+	//256 Owen-scrambled Sobol samples of a pixel: one in each of their 2^8 intervals in one dimension,
+	//and in each 2^-a x 2^-(8-a) box in the first two dimensions of a group (a (0,8,2)-net)
+	const int m = 8, n = 1<<m;
+	tracer::Sampler sobol(tracer::Sampling::Sobol, 7);
+	for (std::array<int,2> pixel : { std::array<int,2>{0,0}, std::array<int,2>{13,5} }) {
+		for (int d = 0; d<12; ++d) {
+			std::vector<int> count(n, 0);
+			for (int s = 0; s<n; ++s) ++count[int(sobol(pixel[0], pixel[1], unsigned(s), d)*float(n))];
+			REQUIRE( std::count(count.begin(), count.end(), 1) == n );
+		}
+		for (int d : { 0, tracer::sampling::sobol_dimensions }) for (int a = 0; a<=m; ++a) {
+			std::vector<int> count(n, 0);
+			for (int s = 0; s<n; ++s) {
+				int x = int(sobol(pixel[0], pixel[1], unsigned(s), d)*float(1<<a));
+				int y = int(sobol(pixel[0], pixel[1], unsigned(s), d + 1)*float(1<<(m - a)));
+				++count[(x<<(m - a)) | y];
+			}
+			REQUIRE( std::count(count.begin(), count.end(), 1) == n );
+		}
+	}
+	//Pixels are scrambled differently
+	REQUIRE( sobol(0,0,1,0) != sobol(1,0,1,0) );
+
+	//Every rank once in the blue noise mask
+	std::vector<float> mask = tracer::sampling::blue_noise_mask();
+	std::sort(mask.begin(), mask.end());
+	for (std::size_t i = 0; i<mask.size(); ++i) REQUIRE( mask[i] == Approx((float(i) + 0.5f)/float(mask.size())) );
+
+	//Blocks give the same values as single samples, whatever the order
+	std::vector<std::array<int,2>> pixels = tracer::pixels(tracer::Tile{3, 2, 11, 4});
+	for (tracer::Sampling sampling : { tracer::Sampling::Random, tracer::Sampling::Sobol, tracer::Sampling::BlueNoise }) {
+		tracer::Sampler sampler(sampling, 3);
+		for (int d = 9; d>=0; d -= 3) {
+			Eigen::Array<float,8,1> block = sampler.block<8>(pixels.data() + 8, 5, 17, d);
+			for (int k = 0; k<5; ++k) {
+				REQUIRE( block[k] == sampler(pixels[8 + k][0], pixels[8 + k][1], 17, d) );
+				REQUIRE( (block[k] >= 0.0f && block[k] < 1.0f) );
+			}
+			REQUIRE( block[5] == 0.0f );
+		}
+	}
+}
+
+TEST_CASE( "Counters of finished threads are kept but their entries released", "[stats]" ) {
+	tracer::stats::reset();
+	tracer::stats::local().triangles += 1;
+	std::size_t threads = tracer::stats::registry().threads();
+	for (int i = 0; i<16; ++i)
+		std::thread([] () { tracer::stats::local().triangles += 2; }).join();
+	REQUIRE( tracer::stats::registry().threads() == threads );
+	REQUIRE( tracer::stats::total().triangles == 33 );
+	tracer::stats::reset();
+	REQUIRE( tracer::stats::total().triangles == 0 );
+}
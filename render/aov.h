@@ -0,0 +1,208 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include "parallel.h"
+#include "numa.h"
+#include <array>
+#include <vector>
+#include <limits>
+#include <unordered_map>
+
+namespace render {
+
+/**
+ * Arbitrary output variables (render passes). They are bit flags, so any set of them can be
+ * requested at once.
+ **/
+namespace aov {
+	enum : unsigned {
+		color        = 1u<<0, //Shaded color (3 channels)
+		normal       = 1u<<1, //World space normal (3 channels)
+		depth        = 1u<<2, //Distance along the ray
+		position     = 1u<<3, //World space point (3 channels)
+		primitive_id = 1u<<4, //Index of the primitive that was hit in its object (see Hit::primitive), -1 if none
+		material_id  = 1u<<5, //Consecutive index of the material that was hit, -1 if none (or no materials)
+		hit_count    = 1u<<6, //Number of samples of the pixel that hit something
+		object_id    = 1u<<7, //Index of the object of the scene that was hit, -1 if none
+		all          = (1u<<8) - 1u
+	};
+	constexpr int count = 8;
+
+	constexpr int index(unsigned a) noexcept { int i = 0; while ((a >>= 1) != 0) ++i; return i; }
+	constexpr int channels(unsigned a) noexcept { return ((a == color) || (a == normal) || (a == position)) ? 3 : 1; }
+	inline const char* name(unsigned a) noexcept {
+		static const char* names[count] = { "color", "normal", "depth", "position", "primitive-id", "material-id", "hit-count", "object-id" };
+		return names[index(a)];
+	}
+}
+
+/**
+ * One buffer of interleaved floats per selected AOV, in scanline order. IDs are stored as
+ * floats too (exact up to 2^24).
+ **/
+class AovBuffers {
+	int w_, h_;
+	unsigned selected_;
+	std::array<std::vector<float>,aov::count> buffers_;
+public:
+	AovBuffers(int w, int h, unsigned selected) : w_(w), h_(h), selected_(selected & aov::all) {
+		for (int i = 0; i<aov::count; ++i)
+			if (has(1u<<i)) buffers_[i].resize(std::size_t(w)*std::size_t(h)*aov::channels(1u<<i), 0.0f);
+	}
+
+	int width() const noexcept { return w_; }
+	int height() const noexcept { return h_; }
+	unsigned selected() const noexcept { return selected_; }
+	bool has(unsigned a) const noexcept { return (selected_ & a) != 0; }
+
+	std::vector<float>& buffer(unsigned a) noexcept { return buffers_[aov::index(a)]; }
+	const std::vector<float>& buffer(unsigned a) const noexcept { return buffers_[aov::index(a)]; }
+	float* operator()(unsigned a, int i, int j) noexcept { return buffer(a).data() + (std::size_t(j)*w_ + i)*aov::channels(a); }
+	const float* operator()(unsigned a, int i, int j) const noexcept { return buffer(a).data() + (std::size_t(j)*w_ + i)*aov::channels(a); }
+};
+
+struct AovOptions {
+	int samples = 1;                        //Per pixel (jittered), 1 traces through the center of the pixel
+	unsigned int seed = 0;
+	tracer::Sampling sampling = tracer::Sampling::Sobol; //Of the positions in the pixel (dimensions 0 and 1)
+	Eigen::Vector3f background = Eigen::Vector3f::Zero();
+	float miss_depth = std::numeric_limits<float>::infinity();
+	int tile_size = 16;
+	unsigned int threads = std::thread::hardware_concurrency();
+	numa::Options numa;                     //Threads when rendering on a NUMA topology (instead of threads)
+};
+
+//Default color: gray, darker at grazing angles
+struct FacingRatio {
+	Eigen::Vector3f operator()(const tracer::Hit& hit, const tracer::Ray& ray) const noexcept {
+		return Eigen::Vector3f::Constant(std::abs(hit.normal().dot(ray.direction())));
+	}
+};
+
+/**
+ * Renders the pixels of one tile of every selected AOV (see render_aovs). With MATERIAL, the
+ * material of each pixel is stored in materials (if given, one per pixel of the image) so they
+ * can be numbered once the whole image is done: the material ID AOV is left at -1 here.
+ **/
+template<typename O, typename Shader = FacingRatio>
+void render_aovs_tile(const tracer::List<O>& scene, const tracer::Pinhole& camera, int w, int h, const tracer::Tile& tile,
+                      AovBuffers& sol, const AovOptions& options = AovOptions(), Shader&& shade = Shader()
+#ifdef MATERIAL
+                      , std::vector<const MATERIAL*>* materials = nullptr
+#endif
+                      ) {
+	int samples = std::max(options.samples,1);
+	float du = 2.0f/float(w), dv = 2.0f/float(h);
+	tracer::Sampler sampler(options.sampling, options.seed);
+	for (const std::array<int,2>& p : tracer::pixels(tile)) {
+		int i = p[0], j = p[1];
+		Eigen::Vector3f color = Eigen::Vector3f::Zero(), normal = Eigen::Vector3f::Zero(), position = Eigen::Vector3f::Zero();
+		float nearest = std::numeric_limits<float>::infinity();
+		int hits = 0, object = -1, primitive = -1;
+#ifdef MATERIAL
+		const MATERIAL* material = nullptr;
+#endif
+		for (int s = 0; s<samples; ++s) {
+			float ju = (samples > 1) ? sampler(i,j,unsigned(s),0) : 0.5f, jv = (samples > 1) ? sampler(i,j,unsigned(s),1) : 0.5f;
+			tracer::Ray ray = camera.ray((float(i) + ju)*du - 1.0f, (float(j) + jv)*dv - 1.0f);
+			auto r = tracer::List<O>::extend_ray(ray);
+			auto h = scene.trace_general(r);
+			if (!h) { color += options.background; continue; }
+			tracer::Hit hit = scene.hit(r,*h);
+			++hits;
+			if (sol.has(aov::color)) color += shade(hit, ray);
+			normal += hit.normal(); position += hit.point();
+			if (hit.distance() < nearest) {
+				nearest = hit.distance();
+				object = int(std::get<1>(*h) - scene.objects().data());
+				primitive = int(hit.primitive());
+#ifdef MATERIAL
+				material = hit.material().get();
+#endif
+			}
+		}
+
+		if (sol.has(aov::color)) { color /= float(samples); for (int c = 0; c<3; ++c) sol(aov::color,i,j)[c] = color[c]; }
+		if (sol.has(aov::normal)) {
+			if (normal.squaredNorm() > 0.0f) normal.normalize();
+			for (int c = 0; c<3; ++c) sol(aov::normal,i,j)[c] = normal[c];
+		}
+		if (sol.has(aov::position)) {
+			if (hits > 0) position /= float(hits);
+			for (int c = 0; c<3; ++c) sol(aov::position,i,j)[c] = position[c];
+		}
+		if (sol.has(aov::depth)) *sol(aov::depth,i,j) = (hits > 0) ? nearest : options.miss_depth;
+		if (sol.has(aov::primitive_id)) *sol(aov::primitive_id,i,j) = float(primitive);
+		if (sol.has(aov::object_id)) *sol(aov::object_id,i,j) = float(object);
+		if (sol.has(aov::material_id)) *sol(aov::material_id,i,j) = -1.0f;
+		if (sol.has(aov::hit_count)) *sol(aov::hit_count,i,j) = float(hits);
+#ifdef MATERIAL
+		if (materials && sol.has(aov::material_id)) (*materials)[std::size_t(j)*w + i] = material;
+#endif
+	}
+}
+
+/**
+ * Renders the tiles of every selected AOV with the given parallel loop, for_each(n, f) calling
+ * f(tile, node), where node picks the scene to read with scene(node).
+ **/
+template<typename SceneOfNode, typename ForEach, typename Shader>
+AovBuffers render_aovs_tiles(SceneOfNode&& scene, ForEach&& for_each, const tracer::Pinhole& camera, int w, int h, unsigned aovs,
+                             const AovOptions& options, Shader&& shade) {
+	AovBuffers sol(w,h,aovs);
+#ifdef MATERIAL
+	//Materials are only known by their address while rendering, they are numbered afterwards
+	std::vector<const MATERIAL*> materials(sol.has(aov::material_id) ? std::size_t(w)*std::size_t(h) : 0, nullptr);
+#endif
+
+	std::vector<tracer::Tile> tiles = tracer::tiles(w,h,options.tile_size);
+	for_each(int(tiles.size()), [&] (int t, int node) {
+		TRACER_PROFILE_SCOPE("render tile", t);
+#ifdef MATERIAL
+		render_aovs_tile(scene(node), camera, w, h, tiles[t], sol, options, shade, &materials);
+#else
+		render_aovs_tile(scene(node), camera, w, h, tiles[t], sol, options, shade);
+#endif
+	});
+
+#ifdef MATERIAL
+	//Numbered in order of appearance (scanline)
+	if (sol.has(aov::material_id)) {
+		std::unordered_map<const MATERIAL*,int> ids;
+		for (std::size_t p = 0; p<materials.size(); ++p)
+			if (materials[p]) sol.buffer(aov::material_id)[p] = float(ids.emplace(materials[p], int(ids.size())).first->second);
+	}
+#endif
+	return sol;
+}
+
+/**
+ * Renders every selected AOV at once: each sample is traced once and all the buffers are
+ * filled from that single hit. With several samples per pixel, color is averaged over all of
+ * them, normal and position over the ones that hit, depth and IDs come from the nearest hit
+ * and hit count counts them.
+ *
+ * shade(hit, ray) returns the color of a hit as an Eigen::Vector3f.
+ **/
+template<typename O, typename Shader = FacingRatio>
+AovBuffers render_aovs(const tracer::List<O>& scene, const tracer::Pinhole& camera, int w, int h, unsigned aovs,
+                       const AovOptions& options = AovOptions(), Shader&& shade = Shader()) {
+	return render_aovs_tiles([&scene] (int) -> const tracer::List<O>& { return scene; },
+		[&options] (int n, auto&& f) { parallel_for(n, [&f] (int t) { f(t, 0); }, options.threads); },
+		camera, w, h, aovs, options, std::forward<Shader>(shade));
+}
+
+/**
+ * The same on a NUMA topology (see numa.h): tiles are split between nodes by numa::parallel_for,
+ * with threads pinned to their node, and each node reads its own copy of the scene (the AOV
+ * buffers are written once per pixel and shared).
+ **/
+template<typename S, typename Shader = FacingRatio>
+AovBuffers render_aovs(const numa::Topology& topology, const numa::Replicated<S>& scene, const tracer::Pinhole& camera, int w, int h, unsigned aovs,
+                       const AovOptions& options = AovOptions(), Shader&& shade = Shader()) {
+	return render_aovs_tiles([&scene] (int node) -> const S& { return scene[node]; },
+		[&topology, &options] (int n, auto&& f) { numa::parallel_for(topology, n, f, options.numa); },
+		camera, w, h, aovs, options, std::forward<Shader>(shade));
+}
+
+}
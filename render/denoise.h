@@ -0,0 +1,173 @@
+#pragma once
+
+#include "aov.h"
+#include "parallel.h"
+#include <Eigen/Dense>
+#include <array>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace render {
+
+struct DenoiseOptions {
+	int iterations = 5;         //Passes of the filter: the footprint grows to 4*2^iterations - 3 pixels
+	float color_sigma = 8.0f;   //Color differences tolerated, in standard deviations of the noise of the pixel
+	float normal_sigma = 64.0f; //Weight falls as exp(-normal_sigma*(1 - n.n'))
+	float depth_sigma = 0.02f;  //Relative depth difference tolerated per pixel of distance
+	int tile_size = 16;         //Rows per task
+	unsigned int threads = std::thread::hardware_concurrency();
+};
+
+/**
+ * Edge-avoiding à-trous wavelet filter (Dammertz et al. 2010) for the color AOV, guided by the
+ * normal and depth AOVs: every pass is a 5x5 B3-spline kernel whose taps are 2^pass pixels apart,
+ * weighted down across differences in color, normal and depth, so noise is averaged over large
+ * areas while silhouettes, creases and shadow boundaries stay sharp. Missing guides are taken as
+ * constant (the filter then only stops at color edges).
+ *
+ * Color differences are measured against the noise of each pixel, as in SVGF (Schied et al. 2017):
+ * its variance is estimated from the luminance of its 3x3 neighborhood and filtered along with
+ * the color, so the same settings work at 1 sample per pixel and at 64.
+ *
+ * Channels are copied into planes padded by the widest step (edges replicated), so that every
+ * tap of a row is a contiguous, unchecked slice: each tap is a handful of Eigen array operations
+ * over the whole row (the exp of the weights is approximated by products). Rows are filtered in
+ * parallel, in bands.
+ **/
+class Denoiser {
+	using Plane = std::vector<float>;
+	using Row = Eigen::Map<const Eigen::ArrayXf>;
+
+	int w_ = 0, h_ = 0, pad_ = 0, stride_ = 0;
+	std::array<Plane,3> color_[2], normal_;
+	Plane variance_[2], depth_;
+
+	std::size_t at(int i, int j) const noexcept { return std::size_t(j + pad_)*std::size_t(stride_) + std::size_t(i + pad_); }
+
+	//Copies a channel of an interleaved buffer into a plane, replicating the edges into the padding
+	void load(Plane& plane, const float* source, int channels, int channel) {
+		plane.resize(std::size_t(stride_)*std::size_t(h_ + 2*pad_));
+		for (int j = -pad_; j<h_ + pad_; ++j) for (int i = -pad_; i<w_ + pad_; ++i) {
+			int si = std::clamp(i, 0, w_ - 1), sj = std::clamp(j, 0, h_ - 1);
+			plane[at(i,j)] = source[(std::size_t(sj)*w_ + si)*channels + channel];
+		}
+	}
+
+	//Replicates the edges of the image into the padding again, after a pass wrote the inside
+	void pad(Plane& plane) const {
+		for (int j = 0; j<h_; ++j) for (int i = 1; i<=pad_; ++i) {
+			plane[at(-i,j)] = plane[at(0,j)];
+			plane[at(w_ - 1 + i,j)] = plane[at(w_ - 1,j)];
+		}
+		for (int i = 1; i<=pad_; ++i) {
+			std::copy_n(plane.begin() + at(-pad_,0), stride_, plane.begin() + at(-pad_,-i));
+			std::copy_n(plane.begin() + at(-pad_,h_ - 1), stride_, plane.begin() + at(-pad_,h_ - 1 + i));
+		}
+	}
+
+	//Variance of the luminance of the 3x3 neighborhood of every pixel
+	void estimate_variance(const std::array<Plane,3>& color, Plane& variance, unsigned int threads) const {
+		variance.resize(color[0].size());
+		auto luminance = [&] (std::size_t p) { return 0.2126f*color[0][p] + 0.7152f*color[1][p] + 0.0722f*color[2][p]; };
+		parallel_for(h_, [&] (int j) {
+			for (int i = 0; i<w_; ++i) {
+				float sum = 0.0f, squares = 0.0f;
+				for (int dy = -1; dy<=1; ++dy) for (int dx = -1; dx<=1; ++dx) {
+					float l = luminance(at(i + dx, j + dy));
+					sum += l; squares += l*l;
+				}
+				variance[at(i,j)] = std::max(squares/9.0f - (sum/9.0f)*(sum/9.0f), 0.0f);
+			}
+		}, threads);
+		pad(variance);
+	}
+
+	void pass(const std::array<Plane,3>& in, const Plane& variance_in, std::array<Plane,3>& out, Plane& variance_out,
+	          int step, const DenoiseOptions& options) const {
+		static constexpr float kernel[5] = { 1.0f/16.0f, 1.0f/4.0f, 3.0f/8.0f, 1.0f/4.0f, 1.0f/16.0f };
+		const float color_sigma2 = options.color_sigma*options.color_sigma;
+		const int rows = std::max(options.tile_size, 1), bands = (h_ + rows - 1)/rows;
+		parallel_for(bands, [&] (int band) {
+			TRACER_PROFILE_SCOPE("denoise band", band);
+			Eigen::ArrayXf weights(w_), r(w_), g(w_), b(w_), v(w_), color_weight(w_), depth_weight(w_), e(w_), weight(w_);
+			for (int j = band*rows; j<std::min(h_, (band + 1)*rows); ++j) {
+				const std::size_t p = at(0,j);
+				Row r0(in[0].data() + p, w_), g0(in[1].data() + p, w_), b0(in[2].data() + p, w_), v0(variance_in.data() + p, w_);
+				Row nx0(normal_[0].data() + p, w_), ny0(normal_[1].data() + p, w_), nz0(normal_[2].data() + p, w_);
+				Row d0(depth_.data() + p, w_);
+				const float center = kernel[2]*kernel[2];
+				weights.setConstant(center); r = center*r0; g = center*g0; b = center*b0; v = (center*center)*v0;
+				color_weight = 1.0f/(color_sigma2*v0 + 1.e-4f);
+				depth_weight = 1.0f/(options.depth_sigma*float(step)*d0.max(1.e-6f));
+				for (int dy = -2; dy<=2; ++dy) for (int dx = -2; dx<=2; ++dx) {
+					if ((dx == 0) && (dy == 0)) continue;
+					const std::size_t q = std::size_t(std::ptrdiff_t(p) + std::ptrdiff_t(step)*(std::ptrdiff_t(dy)*stride_ + dx));
+					Row rq(in[0].data() + q, w_), gq(in[1].data() + q, w_), bq(in[2].data() + q, w_), vq(variance_in.data() + q, w_);
+					Row nxq(normal_[0].data() + q, w_), nyq(normal_[1].data() + q, w_), nzq(normal_[2].data() + q, w_);
+					Row dq(depth_.data() + q, w_);
+					e = color_weight*((rq - r0).square() + (gq - g0).square() + (bq - b0).square()) +
+					    options.normal_sigma*(1.0f - (nx0*nxq + ny0*nyq + nz0*nzq)) +
+					    depth_weight*(dq - d0).abs();
+					//exp(-e) as (1 - e/8)^8: three products instead of an exp, and exactly 0 past e = 8 (exp(-8) = 0.0003)
+					weight = kernel[dx + 2]*kernel[dy + 2]*(1.0f - 0.125f*e).max(0.0f).square().square().square();
+					weights += weight; r += weight*rq; g += weight*gq; b += weight*bq; v += weight.square()*vq;
+				}
+				Eigen::Map<Eigen::ArrayXf>(out[0].data() + p, w_) = r/weights;
+				Eigen::Map<Eigen::ArrayXf>(out[1].data() + p, w_) = g/weights;
+				Eigen::Map<Eigen::ArrayXf>(out[2].data() + p, w_) = b/weights;
+				Eigen::Map<Eigen::ArrayXf>(variance_out.data() + p, w_) = v/weights.square();
+			}
+		}, options.threads);
+		for (int c = 0; c<3; ++c) pad(out[c]);
+		pad(variance_out);
+	}
+
+public:
+	/**
+	 * Replaces the color AOV of aovs with its filtered version. Buffers without a color AOV are
+	 * left as they are.
+	 **/
+	void operator()(AovBuffers& aovs, const DenoiseOptions& options = DenoiseOptions()) {
+		if (!aovs.has(aov::color) || (aovs.width() <= 0) || (aovs.height() <= 0)) return;
+		TRACER_PROFILE_SCOPE("denoise");
+		const int iterations = std::max(options.iterations, 0);
+		w_ = aovs.width(); h_ = aovs.height();
+		pad_ = 2 << std::max(iterations - 1, 0);
+		stride_ = w_ + 2*pad_;
+
+		for (int c = 0; c<3; ++c) { load(color_[0][c], aovs.buffer(aov::color).data(), 3, c); color_[1][c].resize(color_[0][c].size()); }
+		const float up[3] = { 0.0f, 0.0f, 1.0f };
+		for (int c = 0; c<3; ++c) {
+			if (aovs.has(aov::normal)) load(normal_[c], aovs.buffer(aov::normal).data(), 3, c);
+			else normal_[c].assign(color_[0][c].size(), up[c]);
+		}
+		if (aovs.has(aov::depth)) {
+			load(depth_, aovs.buffer(aov::depth).data(), 1, 0);
+			//Misses (infinite depth) are kept apart from hits
+			for (float& d : depth_) if (!std::isfinite(d)) d = 1.e30f;
+		} else depth_.assign(color_[0][0].size(), 1.0f);
+
+		estimate_variance(color_[0], variance_[0], options.threads);
+		variance_[1].resize(variance_[0].size());
+
+		int current = 0;
+		for (int i = 0; i<iterations; ++i, current = 1 - current)
+			pass(color_[current], variance_[current], color_[1 - current], variance_[1 - current], 1<<i, options);
+
+		float* color = aovs.buffer(aov::color).data();
+		for (int j = 0; j<h_; ++j) for (int i = 0; i<w_; ++i)
+			for (int c = 0; c<3; ++c) color[(std::size_t(j)*w_ + i)*3 + c] = color_[current][c][at(i,j)];
+	}
+};
+
+/**
+ * Filters the color AOV of aovs in place (see Denoiser, which keeps its planes from one image to
+ * the next).
+ **/
+inline void denoise(AovBuffers& aovs, const DenoiseOptions& options = DenoiseOptions()) {
+	Denoiser denoiser;
+	denoiser(aovs, options);
+}
+
+}
@@ -0,0 +1,210 @@
+#pragma once
+
+#include "socket.h"
+#include "framebuffer.h"
+#include <tracer/sensors/tiles.h>
+#include <tracer/profiler.h>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace render {
+
+/**
+ * Render farm: a coordinator hands out the tiles of a frame to worker processes (local, through
+ * Unix-domain sockets, or remote, through TCP) and assembles the tiles they send back.
+ *
+ * Wire format (native endianness, so every process should run on the same architecture):
+ *   request: int32 tile, x0, y0, x1, y1   (tile < 0 means there is no more work)
+ *   reply:   the same 5 int32 followed by the RGB floats of the tile, row by row
+ **/
+namespace farm {
+
+struct Header { std::int32_t tile, x0, y0, x1, y1; };
+
+/**
+ * Worker side: renders every tile it is asked for until the coordinator says there is no more
+ * work or goes away. render(buffer) fills the buffer (buffer.tile() is the tile to render).
+ * Returns the number of tiles rendered.
+ **/
+template<typename Renderer>
+int serve(Socket& coordinator, Renderer&& render, int max_tile_size = 256) {
+	TileBuffer buffer(max_tile_size*max_tile_size);
+	int tiles = 0;
+	Header header;
+	while (coordinator.receive(&header, sizeof(header)) && (header.tile >= 0)) {
+		tracer::Tile tile{header.x0, header.y0, header.x1, header.y1};
+		if (tile.size() > max_tile_size*max_tile_size) return tiles;
+		buffer.set_tile(tile);
+		{
+			TRACER_PROFILE_SCOPE("render tile", header.tile);
+			render(buffer);
+		}
+		if (!coordinator.send(&header, sizeof(header)) ||
+		    !coordinator.send(buffer.row(tile.y0), 3*sizeof(float)*std::size_t(tile.size()))) return tiles;
+		++tiles;
+	}
+	return tiles;
+}
+
+struct Statistics {
+	std::vector<int> tiles;   //Tiles accepted from each worker
+	int reissued = 0;         //Tiles also given to a second worker because the first one was behind
+	int duplicates = 0;       //Tiles that were received more than once (and ignored)
+	int failed = 0;           //Workers that went away before the end
+};
+
+class Exception : public std::exception {
+	std::string w;
+public:
+	Exception(const std::string& w) : w(w) {}
+	const char* what() const noexcept override { return w.c_str(); }
+};
+
+/**
+ * Coordinator side. Workers pull work: each one has up to in_flight tiles requested at a time
+ * and gets a new one as soon as it returns one, so faster workers render more tiles. Once every
+ * tile has been handed out, idle workers get the oldest tiles still pending from the ones that
+ * are behind (each tile at most max_copies times), and whichever copy arrives first is kept.
+ * The tiles of a worker that goes away are handed out again.
+ *
+ * sink(const TileBuffer&) is called once per tile, from this thread.
+ **/
+template<typename Sink>
+Statistics coordinate(std::vector<Socket>& workers, const std::vector<tracer::Tile>& tiles, Sink&& sink,
+                      int in_flight = 2, int max_copies = 2) {
+	Statistics stats; stats.tiles.resize(workers.size(), 0);
+	std::vector<char> done(tiles.size(), 0);
+	std::vector<int> copies(tiles.size(), 0);
+	std::deque<int> pending;
+	for (int t = 0; t<int(tiles.size()); ++t) pending.push_back(t);
+	std::vector<std::deque<int>> outstanding(workers.size()); //Requested from each worker, in order
+	std::vector<char> alive(workers.size(), 1);
+	std::size_t remaining = tiles.size();
+
+	int max_tile = 0;
+	for (const tracer::Tile& t : tiles) max_tile = std::max(max_tile, t.size());
+	TileBuffer buffer(std::max(max_tile,1));
+
+	auto fail = [&] (std::size_t w) {
+		alive[w] = 0; ++stats.failed; workers[w].close();
+		for (auto t = outstanding[w].rbegin(); t != outstanding[w].rend(); ++t)
+			if (!done[*t]) { --copies[*t]; pending.push_front(*t); }
+		outstanding[w].clear();
+	};
+
+	auto next_tile = [&] (std::size_t w) {
+		while (!pending.empty()) {
+			int t = pending.front(); pending.pop_front();
+			if (!done[t]) return t;
+		}
+		//Everything has been handed out: help the workers that are behind, oldest requests first
+		int sol = -1; std::size_t position = std::size_t(-1);
+		for (std::size_t o = 0; o<workers.size(); ++o) {
+			if ((o == w) || !alive[o]) continue;
+			for (std::size_t p = 0; p<outstanding[o].size(); ++p) {
+				int t = outstanding[o][p];
+				if (!done[t] && (copies[t] < max_copies) && (p < position) &&
+				    (std::find(outstanding[w].begin(), outstanding[w].end(), t) == outstanding[w].end())) { sol = t; position = p; }
+			}
+		}
+		if (sol >= 0) ++stats.reissued;
+		return sol;
+	};
+
+	while (remaining > 0) {
+		for (std::size_t w = 0; w<workers.size(); ++w) {
+			while (alive[w] && (int(outstanding[w].size()) < in_flight)) {
+				int t = next_tile(w);
+				if (t < 0) break;
+				Header header{t, tiles[t].x0, tiles[t].y0, tiles[t].x1, tiles[t].y1};
+				if (!workers[w].send(&header, sizeof(header))) { pending.push_front(t); fail(w); break; }
+				++copies[t];
+				outstanding[w].push_back(t);
+			}
+		}
+
+		std::vector<pollfd> fds; std::vector<std::size_t> index;
+		for (std::size_t w = 0; w<workers.size(); ++w)
+			if (alive[w] && !outstanding[w].empty()) { fds.push_back(pollfd{workers[w].fd(), POLLIN, 0}); index.push_back(w); }
+		if (fds.empty()) throw Exception("Every worker is gone, "+std::to_string(remaining)+" tiles left");
+		if (::poll(fds.data(), fds.size(), -1) < 0) {
+			if (errno == EINTR) continue;
+			throw SocketException("poll");
+		}
+
+		for (std::size_t f = 0; f<fds.size(); ++f) {
+			if (!(fds[f].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+			std::size_t w = index[f];
+			Header header;
+			if (!workers[w].receive(&header, sizeof(header)) || outstanding[w].empty() || (header.tile != outstanding[w].front())) { fail(w); continue; }
+			tracer::Tile tile = tiles[header.tile];
+			buffer.set_tile(tile);
+			if (!workers[w].receive(buffer.row(tile.y0), 3*sizeof(float)*std::size_t(tile.size()))) { fail(w); continue; }
+			outstanding[w].pop_front();
+			if (done[header.tile]) { ++stats.duplicates; continue; }
+			done[header.tile] = 1; --remaining;
+			++stats.tiles[w];
+			sink(static_cast<const TileBuffer&>(buffer));
+		}
+	}
+
+	Header quit{-1, 0, 0, 0, 0};
+	for (std::size_t w = 0; w<workers.size(); ++w) if (alive[w]) workers[w].send(&quit, sizeof(quit));
+	return stats;
+}
+
+struct Process {
+	pid_t pid;
+	Socket socket; //The coordinator's end
+};
+
+/**
+ * Forks n local worker processes, each one running worker(socket, i) and exiting. This should
+ * be called before starting any thread in the coordinator.
+ **/
+template<typename F>
+std::vector<Process> spawn(int n, F&& worker) {
+	std::vector<Process> sol;
+	for (int i = 0; i<n; ++i) {
+		std::array<Socket,2> ends = socket_pair();
+		pid_t pid = ::fork();
+		if (pid < 0) throw SocketException("fork");
+		if (pid == 0) {
+			for (Process& p : sol) p.socket.close();
+			ends[0].close();
+			worker(ends[1], i);
+			ends[1].close();
+			::_exit(0);
+		}
+		ends[1].close();
+		sol.push_back(Process{pid, std::move(ends[0])});
+	}
+	return sol;
+}
+
+//The coordinator's ends of the connections, ready for coordinate()
+inline std::vector<Socket> sockets(std::vector<Process>& processes) {
+	std::vector<Socket> sol;
+	for (Process& p : processes) sol.push_back(std::move(p.socket));
+	return sol;
+}
+
+//Waits for every process to finish, returns how many did not exit cleanly
+inline int wait(std::vector<Process>& processes) {
+	int failures = 0;
+	for (Process& p : processes) {
+		p.socket.close();
+		int status = 0;
+		if ((::waitpid(p.pid, &status, 0) < 0) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0)) ++failures;
+	}
+	return failures;
+}
+
+}
+
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <tracer/sensors/tiles.h>
+#include <tracer/profiler.h>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdlib>
+#include <cassert>
+#include <stdexcept>
+#include <algorithm>
+
+namespace render {
+
+class FramebufferException : public std::exception {
+	std::string w;
+public:
+	FramebufferException(const std::string& w) : w(w) {}
+	const char* what() const noexcept override { return w.c_str(); }
+};
+
+/**
+ * Interleaved RGB pixels of a tile, in a cache-line aligned block. Pixels are addressed with
+ * image coordinates. The block is not initialized, so its memory belongs to the NUMA node of the
+ * thread that first writes it (see numa.h): node is the one it was allocated for.
+ **/
+class TileBuffer {
+	struct Free { void operator()(float* p) const noexcept { std::free(p); } };
+	tracer::Tile tile_;
+	int capacity_; //In pixels
+	int node_;
+	std::unique_ptr<float[],Free> data_;
+public:
+	TileBuffer(int capacity, int node = 0) : tile_{0,0,0,0}, capacity_(capacity), node_(node),
+		data_(static_cast<float*>(std::aligned_alloc(64, bytes(capacity)))) {
+		if (!data_) throw std::bad_alloc();
+	}
+
+	static std::size_t bytes(int capacity) noexcept { return ((3*sizeof(float)*std::size_t(capacity) + 63)/64)*64; }
+
+	const tracer::Tile& tile() const noexcept { return tile_; }
+	int node() const noexcept { return node_; }
+	void set_tile(const tracer::Tile& t) noexcept { assert(t.size() <= capacity_); tile_ = t; }
+	std::size_t bytes() const noexcept { return bytes(capacity_); }
+
+	float* row(int j) noexcept { return data_.get() + 3*(j - tile_.y0)*tile_.width(); }
+	const float* row(int j) const noexcept { return data_.get() + 3*(j - tile_.y0)*tile_.width(); }
+	float* operator()(int i, int j) noexcept { return row(j) + 3*(i - tile_.x0); }
+	void set(int i, int j, float r, float g, float b) noexcept { float* p = (*this)(i,j); p[0] = r; p[1] = g; p[2] = b; }
+};
+
+/**
+ * RGB framebuffer for images of any resolution (gigapixel posters): tiles are rendered into
+ * a bounded pool of buffers and, once committed, a background thread writes them straight
+ * into their place in the output file (PFM) and recycles them. Only acquire() may wait, and
+ * only when max_tiles tiles are already waiting to be written, which bounds peak memory to
+ * max_tiles tiles regardless of resolution.
+ *
+ * acquire() and commit() can be called concurrently from any number of rendering threads.
+ * With several NUMA nodes, recycled buffers are kept per node: acquire(tile, node) hands out a
+ * buffer allocated (and first written) by a thread of that node, and only takes one of another
+ * node when every buffer of its own is waiting to be written and no more can be allocated.
+ * Write errors (a full disk...) are reported by close(), which throws a FramebufferException
+ * instead of leaving a truncated image behind unnoticed.
+ **/
+class StreamingFramebuffer {
+	int w_, h_, tile_size_, max_tiles_;
+	std::string name_;
+	std::unique_ptr<std::ostream> file_;
+	std::streamoff header_;
+
+	std::mutex mutex_;
+	std::condition_variable available_, pending_;
+	std::vector<std::vector<std::unique_ptr<TileBuffer>>> free_; //Per node
+	std::deque<std::unique_ptr<TileBuffer>> queue_;
+	int allocated_ = 0;
+	bool closing_ = false;
+	bool failed_ = false; //Only accessed by the writer thread until it is joined
+	std::thread writer_;
+
+	void write(const TileBuffer& buffer) {
+		TRACER_PROFILE_SCOPE("write tile");
+		const tracer::Tile& t = buffer.tile();
+		//PFM stores rows bottom to top
+		for (int j = t.y0; (j<t.y1) && !failed_; ++j) {
+			file_->seekp(header_ + 3*std::streamoff(sizeof(float))*(std::streamoff(h_ - 1 - j)*w_ + t.x0));
+			file_->write(reinterpret_cast<const char*>(buffer.row(j)), 3*sizeof(float)*t.width());
+			failed_ = file_->fail();
+		}
+	}
+
+	void writer() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		for (;;) {
+			pending_.wait(lock, [this] { return closing_ || !queue_.empty(); });
+			if (queue_.empty()) return; //Closing and nothing left
+			std::unique_ptr<TileBuffer> buffer = std::move(queue_.front()); queue_.pop_front();
+			lock.unlock();
+			if (!failed_) write(*buffer); //After an error tiles are only recycled
+			lock.lock();
+			free_[buffer->node()].push_back(std::move(buffer));
+			available_.notify_one();
+		}
+	}
+
+public:
+	StreamingFramebuffer(const std::string& filename, int w, int h, int tile_size = 32, int max_tiles = 256, int nodes = 1) :
+		StreamingFramebuffer(std::make_unique<std::ofstream>(filename, std::ios::binary | std::ios::out | std::ios::trunc),
+		                     filename, w, h, tile_size, max_tiles, nodes) {}
+
+	//Writes into any seekable stream (name is only used in error messages)
+	StreamingFramebuffer(std::unique_ptr<std::ostream>&& file, const std::string& name, int w, int h, int tile_size = 32, int max_tiles = 256, int nodes = 1) :
+		w_(w), h_(h), tile_size_(tile_size), max_tiles_(std::max(max_tiles,1)), name_(name), file_(std::move(file)), free_(std::max(nodes,1)) {
+		if (!(*file_)) throw FramebufferException("Cannot open "+name_);
+		std::ostringstream header; header<<"PF\n"<<w<<" "<<h<<"\n-1.0\n"; //Negative scale: little endian
+		(*file_)<<header.str();
+		header_ = std::streamoff(header.str().size());
+		//The file gets its final size, so tiles can be written in any order
+		file_->seekp(header_ + 3*std::streamoff(sizeof(float))*std::streamoff(w)*h - 1);
+		file_->put(0);
+		if (file_->fail()) throw FramebufferException("Cannot write "+name_);
+		writer_ = std::thread([this] { writer(); });
+	}
+
+	//Errors are only reported by an explicit close()
+	~StreamingFramebuffer() { try { close(); } catch (const FramebufferException&) { } }
+
+	int width() const noexcept { return w_; }
+	int height() const noexcept { return h_; }
+	int tile_size() const noexcept { return tile_size_; }
+	std::vector<tracer::Tile> tiles(tracer::PixelOrder order = tracer::PixelOrder::Morton) const { return tracer::tiles(w_, h_, tile_size_, order); }
+
+	//Upper bound of the memory held by tile buffers
+	std::size_t max_bytes() const noexcept { return std::size_t(max_tiles_)*TileBuffer::bytes(tile_size_*tile_size_); }
+
+	int nodes() const noexcept { return int(free_.size()); }
+
+	//A buffer for the tile, from a thread of the given NUMA node (the index in numa::Topology)
+	std::unique_ptr<TileBuffer> acquire(const tracer::Tile& tile, int node = 0) {
+		assert((node >= 0) && (node < nodes()));
+		std::unique_lock<std::mutex> lock(mutex_);
+		std::unique_ptr<TileBuffer> sol;
+		for (;;) {
+			if (!free_[node].empty()) { sol = std::move(free_[node].back()); free_[node].pop_back(); break; }
+			if (allocated_ < max_tiles_) {
+				++allocated_;
+				lock.unlock();
+				sol = std::make_unique<TileBuffer>(tile_size_*tile_size_, node);
+				break;
+			}
+			auto other = std::find_if(free_.begin(), free_.end(), [] (const auto& f) { return !f.empty(); });
+			if (other != free_.end()) { sol = std::move(other->back()); other->pop_back(); break; }
+			available_.wait(lock);
+		}
+		sol->set_tile(tile);
+		return sol;
+	}
+
+	void commit(std::unique_ptr<TileBuffer>&& buffer) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.push_back(std::move(buffer));
+		pending_.notify_one();
+	}
+
+	//Waits until every committed tile is written and closes the file. Throws if any write failed.
+	void close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (closing_) return;
+			closing_ = true;
+			pending_.notify_one();
+		}
+		writer_.join();
+		if (!failed_) failed_ = file_->flush().fail();
+		if (auto f = dynamic_cast<std::ofstream*>(file_.get())) { f->close(); failed_ = failed_ || f->fail(); }
+		if (failed_) throw FramebufferException("Error writing "+name_+", the image is incomplete");
+	}
+};
+
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include "parallel.h"
+#include "numa.h"
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <type_traits>
+
+namespace render {
+
+/**
+ * Primary hits of every pixel (through the center of the pixel), kept from one render to the
+ * next: while the camera and the geometry (ObjectBase::geometry_hash) do not change, update()
+ * does not trace anything and the image can go straight to shading.
+ *
+ * Each pixel keeps only the index of the object of the scene that was hit and the hit of that
+ * object in its own compact form (its HitType: distance and barycentrics and lane of a pack of
+ * triangles, distance and lane of a pack of spheres...). The full Hit, material included, is
+ * rebuilt when it is read, so materials are not part of the key and changing them (their values
+ * or the materials themselves) is seen by the next shading pass. Polymorphic objects (Object)
+ * only produce full hits, so for them the pixel keeps the CompactHit of the object behind the
+ * pointer (see ObjectBase::trace_compact), which is rebuilt without tracing anything as long as
+ * that object (and everything in it) has a HitType that fits.
+ *
+ * Hits are read from the scene given to the last update(), which should still be alive.
+ *
+ * Pixels are stored per tile, each tile in its own block allocated by the thread that traces it.
+ * Given a NUMA topology, tiles are traced and shaded with numa::parallel_for, which hands the same
+ * ranges of tiles to the same nodes every time, so each node mostly reads blocks in its own memory.
+ **/
+template<typename O = tracer::Object>
+class PrimaryHitCache {
+	using ChildHit = typename tracer::object_traits<O>::HitType;
+	static constexpr bool compact = !std::is_same_v<ChildHit,tracer::Hit>;
+	using Stored = std::conditional_t<compact, ChildHit, tracer::CompactHit>;
+
+	struct Block {
+		std::vector<std::int32_t> objects; //Index of the object of the scene that was hit, -1 if none
+		std::vector<Stored> hits;
+	};
+
+	const tracer::List<O>* scene_ = nullptr;
+	tracer::Pinhole camera_;
+	int w_ = 0, h_ = 0;
+	std::size_t key_ = 0;
+	bool valid_ = false;
+	std::vector<tracer::Tile> tiles_;
+	std::vector<Block> blocks_;           //One per tile
+	std::vector<std::int32_t> tile_index_; //Index in tiles_ of each tile of the image (scanline)
+	int tile_size_;
+	unsigned int threads_;
+	std::optional<numa::Topology> topology_;
+	numa::Options numa_;
+
+	std::pair<const Block*,std::size_t> pixel(int i, int j) const noexcept {
+		int tiles_per_row = (w_ + tile_size_ - 1)/tile_size_;
+		std::size_t t = std::size_t(tile_index_[std::size_t(j/tile_size_)*tiles_per_row + i/tile_size_]);
+		return std::make_pair(&blocks_[t], std::size_t(j - tiles_[t].y0)*tiles_[t].width() + (i - tiles_[t].x0));
+	}
+
+	template<typename F>
+	void for_each_tile(F&& f) const {
+		if (topology_) numa::parallel_for(*topology_, int(tiles_.size()), [&] (int t, int) { f(t); }, numa_);
+		else parallel_for(int(tiles_.size()), f, threads_);
+	}
+
+public:
+	PrimaryHitCache(int tile_size = 16, unsigned int threads = std::thread::hardware_concurrency()) :
+		camera_(Eigen::Vector3f::Zero(), Eigen::Vector3f::UnitZ(), Eigen::Vector3f::UnitY()), tile_size_(tile_size), threads_(threads) {}
+	//Traces and shades with threads pinned to the nodes of the topology
+	PrimaryHitCache(const numa::Topology& topology, int tile_size = 16, const numa::Options& options = numa::Options()) :
+		PrimaryHitCache(tile_size) { topology_ = topology; numa_ = options; }
+
+	static std::size_t key(const tracer::Pinhole& camera, int w, int h, std::size_t geometry_hash) noexcept {
+		return tracer::hash_combine(tracer::hash_combine(tracer::hash(std::size_t(w)*31 + std::size_t(h), camera.transform()), geometry_hash), 11);
+	}
+
+	bool valid() const noexcept { return valid_; }
+	void invalidate() noexcept { valid_ = false; }
+	int width() const noexcept { return w_; }
+	int height() const noexcept { return h_; }
+	const tracer::Pinhole& camera() const noexcept { return camera_; }
+	//Bytes kept per pixel
+	static constexpr std::size_t pixel_bytes() noexcept { return sizeof(std::int32_t) + sizeof(Stored); }
+
+	tracer::Ray ray(int i, int j) const {
+		return camera_.ray((float(i) + 0.5f)*2.0f/float(w_) - 1.0f, (float(j) + 0.5f)*2.0f/float(h_) - 1.0f);
+	}
+	int object(int i, int j) const noexcept { auto [block, index] = pixel(i,j); return block->objects[index]; }
+
+	//Rebuilds the hit of a pixel, with the current material of the object
+	std::optional<tracer::Hit> hit(int i, int j) const {
+		auto [block, index] = pixel(i,j);
+		if (block->objects[index] < 0) return std::nullopt;
+		const O& o = scene_->objects()[std::size_t(block->objects[index])];
+		std::optional<tracer::Hit> sol;
+		if constexpr (compact) {
+			auto r = tracer::List<O>::extend_ray(ray(i,j));
+			sol = scene_->hit(r, std::tuple<ChildHit,const O*>(block->hits[index], &o));
+#ifdef MATERIAL
+			sol->set_material(o.material());
+#endif
+		} else {
+			sol = o.rebuild(tracer::PreparedRay(ray(i,j)), block->hits[index]);
+			if (sol && (sol->primitive() < 0)) sol->set_primitive(block->objects[index]); //As the List does
+		}
+#ifdef MATERIAL
+		if (sol) sol->set_material(scene_->material());
+#endif
+		return sol;
+	}
+
+	/**
+	 * Traces the primary hits unless the cached ones are still valid. Returns whether it traced.
+	 **/
+	bool update(const tracer::List<O>& scene, const tracer::Pinhole& camera, int w, int h) {
+		scene_ = &scene;
+		std::size_t k = key(camera, w, h, scene.geometry_hash());
+		if (valid_ && (k == key_)) return false;
+		camera_ = camera; w_ = w; h_ = h; key_ = k;
+		tiles_ = tracer::tiles(w,h,tile_size_);
+		int tiles_per_row = (w + tile_size_ - 1)/tile_size_;
+		tile_index_.assign(tiles_.size(), -1);
+		for (std::size_t t = 0; t<tiles_.size(); ++t) tile_index_[std::size_t(tiles_[t].y0/tile_size_)*tiles_per_row + tiles_[t].x0/tile_size_] = std::int32_t(t);
+		blocks_.clear(); blocks_.resize(tiles_.size());
+		for_each_tile([&] (int t) {
+			TRACER_PROFILE_SCOPE("trace tile", t);
+			const tracer::Tile& tile = tiles_[t];
+			Block& block = blocks_[t];
+			block.objects.assign(std::size_t(tile.size()), -1);
+			block.hits.resize(std::size_t(tile.size()));
+			for (const std::array<int,2>& p : tracer::pixels(tile)) {
+				std::size_t index = std::size_t(p[1] - tile.y0)*tile.width() + (p[0] - tile.x0);
+				if constexpr (compact) {
+					auto r = tracer::List<O>::extend_ray(ray(p[0],p[1]));
+					auto h = scene.trace_general(r);
+					if (!h) continue;
+					block.objects[index] = std::int32_t(std::get<1>(*h) - scene.objects().data());
+					block.hits[index] = std::get<0>(*h);
+				} else { //As List::trace_general, keeping the compact hits of the objects
+					TRACER_COUNT(nodes,1);
+					tracer::PreparedRay r(ray(p[0],p[1]));
+					for (const O& object : scene.objects()) {
+						if (auto h = object.trace_compact(r)) {
+							r.set_range_max(h->distance);
+							block.objects[index] = std::int32_t(&object - scene.objects().data());
+							block.hits[index] = *h;
+						}
+					}
+				}
+			}
+		});
+		valid_ = true;
+		return true;
+	}
+
+	/**
+	 * Shades every pixel from its cached hit: f(i, j, ray, hit) with hit a std::optional<Hit>,
+	 * in parallel over tiles.
+	 **/
+	template<typename F>
+	void shade(F&& f) const {
+		for_each_tile([&] (int t) {
+			TRACER_PROFILE_SCOPE("shade tile", t);
+			for (const std::array<int,2>& p : tracer::pixels(tiles_[t])) f(p[0], p[1], ray(p[0],p[1]), hit(p[0],p[1]));
+		});
+	}
+};
+
+}
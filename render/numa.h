@@ -0,0 +1,222 @@
+#pragma once
+
+#include <tracer/profiler.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <exception>
+#include <algorithm>
+#include <cstdint>
+#include <sched.h>
+
+namespace render {
+
+/**
+ * NUMA awareness: worker threads are pinned to the CPUs of one node, read-only data (the scene and
+ * its accelerators) can be replicated so every node reads its own copy, and tiles are split between
+ * nodes so each tile is rendered (and its buffer allocated and first touched) on one node.
+ *
+ * Replicas rely on the first-touch policy of the kernel: a copy built by a thread pinned to a node
+ * is allocated in the memory of that node. On machines with a single node (or without the sysfs
+ * topology) everything degenerates to the usual shared placement.
+ **/
+namespace numa {
+
+struct Node {
+	int id;
+	std::vector<int> cpus;
+};
+
+//Parses the kernel's list format, e.g. "0-3,8-11"
+inline std::vector<int> parse_list(const std::string& list) {
+	std::vector<int> sol;
+	std::stringstream ss(list);
+	std::string range;
+	while (std::getline(ss, range, ',')) {
+		if (range.empty() || range == "\n") continue;
+		std::size_t dash = range.find('-');
+		int first = std::stoi(range.substr(0, dash));
+		int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+		for (int i = first; i<=last; ++i) sol.push_back(i);
+	}
+	return sol;
+}
+
+//CPUs the calling thread is allowed to run on (e.g. restricted by a container)
+inline std::vector<int> allowed_cpus() {
+	std::vector<int> sol;
+	cpu_set_t set; CPU_ZERO(&set);
+	if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+		for (int c = 0; c<CPU_SETSIZE; ++c) if (CPU_ISSET(c, &set)) sol.push_back(c);
+	}
+	return sol;
+}
+
+//Pins the calling thread to some CPUs. Returns false if it is not allowed.
+inline bool pin(const std::vector<int>& cpus) noexcept {
+	if (cpus.empty()) return false;
+	cpu_set_t set; CPU_ZERO(&set);
+	for (int c : cpus) if ((c >= 0) && (c < CPU_SETSIZE)) CPU_SET(c, &set);
+	return ::sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+class Topology {
+	std::vector<Node> nodes_;
+public:
+	explicit Topology(std::vector<Node> nodes) : nodes_(std::move(nodes)) {}
+
+	//A single node with every allowed CPU (pinning to it does nothing useful)
+	static Topology single() {
+		std::vector<int> cpus = allowed_cpus();
+		if (cpus.empty()) for (unsigned c = 0; c<std::max(1u,std::thread::hardware_concurrency()); ++c) cpus.push_back(int(c));
+		return Topology(std::vector<Node>{Node{0, cpus}});
+	}
+
+	//Nodes with CPUs the process can use, from /sys/devices/system/node
+	static Topology detect() {
+		std::ifstream online("/sys/devices/system/node/online");
+		std::string line;
+		if (!online || !std::getline(online, line)) return single();
+		std::vector<int> allowed = allowed_cpus();
+		std::vector<Node> nodes;
+		for (int id : parse_list(line)) {
+			std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(id) + "/cpulist");
+			std::string list;
+			if (!cpulist || !std::getline(cpulist, list)) continue;
+			Node node{id, {}};
+			for (int c : parse_list(list))
+				if (allowed.empty() || std::binary_search(allowed.begin(), allowed.end(), c)) node.cpus.push_back(c);
+			if (!node.cpus.empty()) nodes.push_back(std::move(node)); //Memory-only nodes run no threads
+		}
+		return nodes.empty() ? single() : Topology(std::move(nodes));
+	}
+
+	const std::vector<Node>& nodes() const noexcept { return nodes_; }
+	int size() const noexcept { return int(nodes_.size()); }
+	const Node& operator[](int n) const noexcept { return nodes_[n]; }
+	int cpus() const noexcept {
+		int sol = 0;
+		for (const Node& n : nodes_) sol += int(n.cpus.size());
+		return sol;
+	}
+};
+
+//Runs f() in a thread pinned to a node and waits for it (e.g. to allocate in its memory)
+template<typename F>
+void run_on(const Node& node, F&& f) {
+	std::thread thread([&] () { pin(node.cpus); f(); });
+	thread.join();
+}
+
+enum class Placement { shared, replicated };
+
+/**
+ * Read-only data for every node. With replicated placement, build() is called once per node from
+ * a thread pinned to it, so each copy lives in local memory (as long as build() allocates everything
+ * it returns: copying a Scene would only copy pointers to the same objects). With shared placement,
+ * there is a single copy, built by the calling thread, that every node reads.
+ **/
+template<typename T>
+class Replicated {
+	std::vector<std::shared_ptr<const T>> copies_;
+public:
+	template<typename F>
+	Replicated(const Topology& topology, F&& build, Placement placement = Placement::replicated) {
+		if ((placement == Placement::shared) || (topology.size() == 1)) {
+			std::shared_ptr<const T> copy = std::make_shared<const T>(build());
+			copies_.assign(topology.size(), copy);
+		} else {
+			copies_.resize(topology.size());
+			for (int n = 0; n<topology.size(); ++n) {
+				TRACER_PROFILE_SCOPE("replicate", topology[n].id);
+				run_on(topology[n], [&] () { copies_[n] = std::make_shared<const T>(build()); });
+			}
+		}
+	}
+
+	const T& operator[](int node) const noexcept { return *copies_[node]; }
+	//Number of distinct copies
+	int copies() const noexcept {
+		int sol = 0;
+		for (std::size_t n = 0; n<copies_.size(); ++n) if ((n == 0) || (copies_[n] != copies_[n-1])) ++sol;
+		return sol;
+	}
+};
+
+struct Options {
+	bool pin = true;          //Pin each worker thread to the CPUs of its node
+	int threads_per_node = 0; //0 uses one thread per CPU of the node
+};
+
+/**
+ * Calls f(i, node) for every i in [0,n), where node is the index (in the topology) of the node of
+ * the calling thread. Indices are split in contiguous ranges, one per node in proportion to its
+ * threads, so that neighbouring tiles are rendered by the same node. Each node hands out its own
+ * range dynamically, and once it is done it helps the others from the end of their ranges.
+ * If f throws, no more indices are taken and the first exception is rethrown once every thread
+ * has finished.
+ **/
+template<typename F>
+void parallel_for(const Topology& topology, int n, F&& f, const Options& options = Options()) {
+	//[next,end) in a single word, so the owner (from the front) and thieves (from the back) never take the same index
+	struct alignas(64) Range {
+		std::atomic<std::uint64_t> range{0};
+		void set(int next, int end) noexcept { range = (std::uint64_t(std::uint32_t(next))<<32) | std::uint32_t(end); }
+		int take(bool front) noexcept {
+			std::uint64_t r = range.load();
+			for (;;) {
+				int next = int(r>>32), end = int(r & 0xffffffffu);
+				if (next >= end) return -1;
+				std::uint64_t taken = front ? (std::uint64_t(std::uint32_t(next+1))<<32) | std::uint32_t(end) : (r - 1);
+				if (range.compare_exchange_weak(r, taken)) return front ? next : end - 1;
+			}
+		}
+	};
+	std::vector<Range> ranges(topology.size());
+	std::vector<int> threads(topology.size());
+	int total = 0;
+	for (int k = 0; k<topology.size(); ++k) {
+		threads[k] = (options.threads_per_node > 0) ? options.threads_per_node : int(topology[k].cpus.size());
+		total += threads[k];
+	}
+	for (int k = 0, first = 0, accumulated = 0; k<topology.size(); ++k) {
+		accumulated += threads[k];
+		int last = int((long long)(n)*accumulated/total);
+		ranges[k].set(first, last);
+		first = last;
+	}
+
+	std::atomic<bool> failed{false};
+	std::mutex mutex;
+	std::exception_ptr error; //The first exception thrown by f
+	auto worker = [&] (int node) {
+		if (options.pin && (topology.size() > 1)) pin(topology[node].cpus);
+		try {
+			for (int i = ranges[node].take(true); (i >= 0) && !failed; i = ranges[node].take(true)) f(i, node);
+			//Help the other nodes, from the end of their ranges
+			for (int o = 1; (o<topology.size()) && !failed; ++o) {
+				Range& r = ranges[(node + o) % topology.size()];
+				for (int i = r.take(false); (i >= 0) && !failed; i = r.take(false)) f(i, node);
+			}
+		} catch (...) {
+			failed = true;
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) error = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> pool;
+	for (int k = 0; k<topology.size(); ++k)
+		for (int t = 0; t<threads[k]; ++t) pool.emplace_back(worker, k);
+	for (std::thread& t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+}
+
+}
+
+}
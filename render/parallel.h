@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <exception>
+
+namespace render {
+
+/**
+ * Calls f(i) for every i in [0,n) from a number of threads. Indices are handed out one at a time
+ * (dynamic scheduling), so f(i) should represent a meaningful amount of work (a row, a tile...).
+ * If f throws, no more indices are handed out and the first exception is rethrown once every
+ * thread has finished.
+ **/
+template<typename F>
+void parallel_for(int n, F&& f, unsigned int threads = std::thread::hardware_concurrency()) {
+	threads = std::max(1u, std::min(threads, unsigned(std::max(n,1))));
+	std::atomic<int> next(0);
+	std::mutex mutex;
+	std::exception_ptr error;
+	auto worker = [&] () {
+		try { for (int i = next++; i < n; i = next++) f(i); }
+		catch (...) {
+			next = n;
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!error) error = std::current_exception();
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned int t = 1; t<threads; ++t) pool.emplace_back(worker);
+	worker();
+	for (std::thread& t : pool) t.join();
+	if (error) std::rethrow_exception(error);
+}
+
+/**
+ * A fixed set of threads shared by every parallel loop submitted to it, possibly from several
+ * threads at once (e.g. concurrent requests of a render server). Loops take turns: after running
+ * one index of a loop, a thread moves it to the back of the queue, so concurrent loops share the
+ * threads index by index (tile by tile) instead of one waiting for the other to finish.
+ *
+ * If f throws in a thread of the pool, the loop stops handing out indices and its parallel_for
+ * rethrows the first exception once the indices already running have finished. The pool and the
+ * other loops go on.
+ **/
+class ThreadPool {
+	struct Job {
+		std::function<void(int)> f;
+		int n;
+		std::atomic<int> next{0};
+		int done = 0; //Guarded by the mutex of the pool
+		std::exception_ptr error; //The first exception thrown by f, guarded by the mutex of the pool
+		std::condition_variable finished;
+	};
+	std::mutex mutex_;
+	std::condition_variable work_;
+	std::deque<std::shared_ptr<Job>> jobs_;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+
+	//Runs one index of the job at the front of the queue. Returns false if there was nothing to do.
+	bool run_one(std::unique_lock<std::mutex>& lock) {
+		while (!jobs_.empty()) {
+			std::shared_ptr<Job> job = jobs_.front();
+			jobs_.pop_front();
+			int i = job->next++;
+			if (i >= job->n) continue; //Every index handed out, the job leaves the queue
+			jobs_.push_back(job);
+			lock.unlock();
+			std::exception_ptr error;
+			try { job->f(i); } catch (...) { error = std::current_exception(); }
+			lock.lock();
+			int finished = 1;
+			if (error) { //The indices not handed out yet are skipped, and count as done
+				if (!job->error) job->error = error;
+				finished += std::max(0, job->n - job->next.exchange(job->n));
+			}
+			if ((job->done += finished) == job->n) job->finished.notify_all();
+			return true;
+		}
+		return false;
+	}
+
+public:
+	explicit ThreadPool(unsigned int threads = std::thread::hardware_concurrency()) {
+		for (unsigned int t = 0; t<std::max(threads,1u); ++t) threads_.emplace_back([this] () {
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (!stop_) if (!run_one(lock)) work_.wait(lock);
+		});
+	}
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool() {
+		{ std::lock_guard<std::mutex> lock(mutex_); stop_ = true; }
+		work_.notify_all();
+		for (std::thread& t : threads_) t.join();
+	}
+
+	unsigned int size() const noexcept { return unsigned(threads_.size()); }
+
+	//Calls f(i) for every i in [0,n) from the threads of the pool and waits for them to finish
+	template<typename F>
+	void parallel_for(int n, F&& f) {
+		if (n <= 0) return;
+		auto job = std::make_shared<Job>();
+		job->f = std::ref(f);
+		job->n = n;
+		std::unique_lock<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+		work_.notify_all();
+		job->finished.wait(lock, [&] () { return job->done == job->n; });
+		if (job->error) std::rethrow_exception(job->error);
+	}
+};
+
+}
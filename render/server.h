@@ -0,0 +1,443 @@
+#pragma once
+
+#include "socket.h"
+#include "parallel.h"
+#include "aov.h"
+#include <tracer/tracer.h>
+#include <tracer/profiler.h>
+#include <string>
+#include <sstream>
+#include <map>
+#include <set>
+#include <list>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <poll.h>
+#include <sys/socket.h>
+
+namespace render {
+
+/**
+ * Render server: a long-running process that builds each scene (and its acceleration data) once,
+ * the first time it is requested, and keeps it in memory, so repeated requests only pay for
+ * tracing. Requests from every connection are rendered tile by tile on a single shared
+ * ThreadPool, taking turns, and tiles are streamed back to the client as soon as they are done:
+ * the pool queues them for the connection and its own thread sends them, so a slow client never
+ * holds the threads of the pool.
+ *
+ * Protocol, over a Unix-domain socket (or TCP):
+ *   request: a line of text "render key=value ...\n" with the keys of Request (see parse):
+ *              scene=name width=256 height=256 camera=ox,oy,oz,fx,fy,fz,ux,uy,uz
+ *              aovs=color,normal,depth samples=1 seed=0 tile=32 budget=0 (milliseconds, 0 is none)
+ *            or "load name\n" to build a scene ahead of time.
+ *   reply:   Header (int32 status, width, height, aovs, tiles), followed by:
+ *              if status != 0, int32 length and the error message.
+ *              otherwise, for each tile that was rendered (in the order they finish) a farm-like
+ *              TileHeader (int32 tile, x0, y0, x1, y1) and the floats of each selected AOV
+ *              (in the order of their bits) for the pixels of the tile, row by row. Then a
+ *              TileHeader with tile = -1 and x0 the number of tiles that were rendered: tiles
+ *              that could not be started within the time budget are not sent.
+ *   Native endianness, like the farm.
+ **/
+namespace server {
+
+struct Request {
+	std::string scene;
+	int width = 256, height = 256;
+	Eigen::Vector3f origin = Eigen::Vector3f(0, 0, -2), front = Eigen::Vector3f(0, 0, 1), up = Eigen::Vector3f(0, 1, 0);
+	unsigned aovs = aov::color;
+	int samples = 1;
+	unsigned int seed = 0;
+	int tile_size = 32;
+	double budget = 0.0; //Milliseconds, 0 means no limit
+
+	tracer::Pinhole camera() const { return tracer::Pinhole(origin, front, up); }
+};
+
+class Exception : public std::exception {
+	std::string w;
+public:
+	Exception(const std::string& w) : w(w) {}
+	const char* what() const noexcept override { return w.c_str(); }
+};
+
+inline std::string format(const Request& r) {
+	std::stringstream ss;
+	ss<<"render scene="<<r.scene<<" width="<<r.width<<" height="<<r.height<<" camera=";
+	for (const Eigen::Vector3f* v : { &r.origin, &r.front, &r.up }) for (int k = 0; k<3; ++k) ss<<(*v)[k]<<(((v == &r.up) && (k == 2)) ? "" : ",");
+	ss<<" aovs=";
+	bool first = true;
+	for (int i = 0; i<aov::count; ++i) if (r.aovs & (1u<<i)) { ss<<(first ? "" : ",")<<aov::name(1u<<i); first = false; }
+	ss<<" samples="<<r.samples<<" seed="<<r.seed<<" tile="<<r.tile_size<<" budget="<<r.budget;
+	return ss.str();
+}
+
+//Parses the keys of a "render ..." line (the command itself is skipped). Throws on unknown keys or values.
+inline Request parse(const std::string& line) {
+	Request sol;
+	std::stringstream ss(line);
+	std::string token;
+	ss>>token;
+	auto values = [] (const std::string& list) {
+		std::vector<std::string> sol;
+		std::stringstream ls(list);
+		std::string v;
+		while (std::getline(ls, v, ',')) sol.push_back(v);
+		return sol;
+	};
+	try {
+		while (ss>>token) {
+			std::size_t equal = token.find('=');
+			if (equal == std::string::npos) throw Exception("Expected key=value instead of " + token);
+			std::string key = token.substr(0, equal), value = token.substr(equal + 1);
+			if      (key == "scene")   sol.scene = value;
+			else if (key == "width")   sol.width = std::stoi(value);
+			else if (key == "height")  sol.height = std::stoi(value);
+			else if (key == "samples") sol.samples = std::stoi(value);
+			else if (key == "seed")    sol.seed = unsigned(std::stoul(value));
+			else if (key == "tile")    sol.tile_size = std::stoi(value);
+			else if (key == "budget")  sol.budget = std::stod(value);
+			else if (key == "camera") {
+				std::vector<std::string> v = values(value);
+				if (v.size() != 9) throw Exception("The camera needs 9 values (origin, front, up)");
+				for (int k = 0; k<3; ++k) {
+					sol.origin[k] = std::stof(v[k]); sol.front[k] = std::stof(v[3+k]); sol.up[k] = std::stof(v[6+k]);
+				}
+			} else if (key == "aovs") {
+				sol.aovs = 0;
+				for (const std::string& name : values(value)) {
+					unsigned a = 0;
+					for (int i = 0; i<aov::count; ++i) if (name == aov::name(1u<<i)) a = 1u<<i;
+					if ((a == 0) && (name != "all")) throw Exception("Unknown AOV " + name);
+					sol.aovs |= (name == "all") ? unsigned(aov::all) : a;
+				}
+			} else throw Exception("Unknown key " + key);
+		}
+	} catch (const std::logic_error&) { throw Exception("Wrong value in " + token); }
+	if ((sol.width <= 0) || (sol.height <= 0) || (sol.tile_size <= 0) || (sol.aovs == 0)) throw Exception("Empty image");
+	return sol;
+}
+
+struct Header { std::int32_t status, width, height, aovs, tiles; };
+struct TileHeader { std::int32_t tile, x0, y0, x1, y1; };
+
+//Reads up to a newline (not included). Returns false if the peer went away first.
+inline bool receive_line(Socket& socket, std::string& line, std::size_t max_length = 4096) {
+	line.clear();
+	char c;
+	while (socket.receive(&c, 1)) {
+		if (c == '\n') return true;
+		if (line.size() >= max_length) return false;
+		line.push_back(c);
+	}
+	return false;
+}
+
+//The floats of every selected AOV for the pixels of a tile, in wire order
+inline std::vector<float> tile_data(const AovBuffers& buffers, const tracer::Tile& t) {
+	std::vector<float> sol;
+	for (int a = 0; a<aov::count; ++a) {
+		unsigned bit = 1u<<a;
+		if (!buffers.has(bit)) continue;
+		for (int j = t.y0; j<t.y1; ++j) sol.insert(sol.end(), buffers(bit, t.x0, j), buffers(bit, t.x1, j));
+	}
+	return sol;
+}
+
+struct Result {
+	AovBuffers buffers{0, 0, 0};
+	int tiles = 0, rendered = 0;
+	double build_seconds = 0.0; //Time spent building the scene for this request (0 if it was already loaded)
+	double seconds = 0.0;
+	bool complete() const noexcept { return rendered == tiles; }
+};
+
+class Server {
+	struct Entry {
+		std::function<tracer::Scene()> build;
+		std::shared_ptr<const tracer::Scene> scene;
+		std::mutex mutex; //Held while building, so concurrent requests build it only once
+	};
+	ThreadPool pool_;
+	std::mutex mutex_;
+	std::map<std::string,std::unique_ptr<Entry>> scenes_;
+	std::atomic<int> builds_{0}, requests_{0};
+	std::atomic<bool> stop_{false};
+	std::atomic<int> client_threads_{0};
+	std::set<int> connections_; //Guarded by mutex_
+
+	Entry& entry(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto e = scenes_.find(name);
+		if (e == scenes_.end()) throw Exception("Unknown scene " + name);
+		return *e->second;
+	}
+
+public:
+	explicit Server(unsigned int threads = std::thread::hardware_concurrency()) : pool_(threads) {}
+
+	//Registers a scene, which is built the first time it is needed
+	void add(const std::string& name, std::function<tracer::Scene()> build) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto e = std::make_unique<Entry>();
+		e->build = std::move(build);
+		scenes_[name] = std::move(e);
+	}
+
+	//The scene, built if it was not. The time spent building it is added to seconds.
+	std::shared_ptr<const tracer::Scene> scene(const std::string& name, double* seconds = nullptr) {
+		Entry& e = entry(name);
+		std::lock_guard<std::mutex> lock(e.mutex);
+		if (!e.scene) {
+			TRACER_PROFILE_SCOPE("build scene");
+			auto start = std::chrono::steady_clock::now();
+			e.scene = std::make_shared<const tracer::Scene>(e.build());
+			++builds_;
+			if (seconds) *seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		return e.scene;
+	}
+
+	int builds() const noexcept { return builds_; }
+	int requests() const noexcept { return requests_; }
+	ThreadPool& pool() noexcept { return pool_; }
+
+	/**
+	 * Renders a request on the shared pool. on_tile(const AovBuffers&, const tracer::Tile&, int index)
+	 * is called, from the threads of the pool, as soon as each tile is done, so it should return
+	 * quickly. Tiles that have not started once the time budget is over are skipped. With MATERIAL,
+	 * materials are numbered in the order their tiles finish (scanline order within a tile).
+	 **/
+	template<typename OnTile>
+	Result render(const Request& request, OnTile&& on_tile) {
+		++requests_;
+		auto start = std::chrono::steady_clock::now();
+		Result sol;
+		std::shared_ptr<const tracer::Scene> scene = this->scene(request.scene, &sol.build_seconds);
+		auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double,std::milli>(request.budget));
+		sol.buffers = AovBuffers(request.width, request.height, request.aovs);
+		tracer::Pinhole camera = request.camera();
+		AovOptions options;
+		options.samples = request.samples; options.seed = request.seed;
+		std::vector<tracer::Tile> tiles = tracer::tiles(request.width, request.height, request.tile_size);
+		std::atomic<int> rendered{0};
+#ifdef MATERIAL
+		std::vector<const MATERIAL*> materials(sol.buffers.has(aov::material_id) ? std::size_t(request.width)*std::size_t(request.height) : 0, nullptr);
+		std::mutex numbering;
+		std::unordered_map<const MATERIAL*,int> ids;
+#endif
+		pool_.parallel_for(int(tiles.size()), [&] (int t) {
+			if ((request.budget > 0.0) && (std::chrono::steady_clock::now() > deadline)) return;
+			{
+				TRACER_PROFILE_SCOPE("render tile", t);
+#ifdef MATERIAL
+				render_aovs_tile(*scene, camera, request.width, request.height, tiles[t], sol.buffers, options, FacingRatio(), &materials);
+				if (sol.buffers.has(aov::material_id)) {
+					std::lock_guard<std::mutex> lock(numbering);
+					for (const std::array<int,2>& p : tracer::pixels(tiles[t], tracer::PixelOrder::Scanline)) {
+						const MATERIAL* m = materials[std::size_t(p[1])*request.width + p[0]];
+						if (m) *sol.buffers(aov::material_id, p[0], p[1]) = float(ids.emplace(m, int(ids.size())).first->second);
+					}
+				}
+#else
+				render_aovs_tile(*scene, camera, request.width, request.height, tiles[t], sol.buffers, options);
+#endif
+			}
+			++rendered;
+			on_tile(static_cast<const AovBuffers&>(sol.buffers), tiles[t], t);
+		});
+		sol.tiles = int(tiles.size());
+		sol.rendered = rendered;
+		sol.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		return sol;
+	}
+
+	Result render(const Request& request) { return render(request, [] (const AovBuffers&, const tracer::Tile&, int) { }); }
+
+	/**
+	 * Answers the requests of a client, one after the other, until it goes away. Errors in a
+	 * request are sent back to the client and do not stop the connection.
+	 **/
+	void serve(Socket& client) {
+		std::string line;
+		while (!stop_ && receive_line(client, line)) {
+			std::string command = line.substr(0, line.find(' '));
+			auto error = [&] (const std::string& message) {
+				Header header{1, 0, 0, 0, 0};
+				std::int32_t length = std::int32_t(message.size());
+				return client.send(&header, sizeof(header)) && client.send(&length, sizeof(length)) && client.send(message.data(), message.size());
+			};
+			try {
+				if (command == "load") {
+					scene(line.substr(line.find(' ') + 1));
+					Header header{0, 0, 0, 0, 0};
+					TileHeader end{-1, 0, 0, 0, 0};
+					if (!client.send(&header, sizeof(header)) || !client.send(&end, sizeof(end))) return;
+				} else if (command == "render") {
+					Request request = parse(line);
+					std::vector<tracer::Tile> tiles = tracer::tiles(request.width, request.height, request.tile_size);
+					scene(request.scene); //Unknown scenes fail before the header is sent
+					Header header{0, request.width, request.height, std::int32_t(request.aovs), std::int32_t(tiles.size())};
+					if (!client.send(&header, sizeof(header))) return;
+					//The pool copies each tile into the queue of the connection, this thread sends them
+					std::mutex mutex;
+					std::condition_variable ready;
+					std::deque<std::pair<TileHeader,std::vector<float>>> queue;
+					bool finished = false;
+					Result result;
+					std::exception_ptr failure;
+					std::thread rendering([&] () {
+						try {
+							result = render(request, [&] (const AovBuffers& buffers, const tracer::Tile& t, int index) {
+								std::vector<float> data = tile_data(buffers, t);
+								std::lock_guard<std::mutex> lock(mutex);
+								queue.emplace_back(TileHeader{index, t.x0, t.y0, t.x1, t.y1}, std::move(data));
+								ready.notify_one();
+							});
+						} catch (...) { failure = std::current_exception(); }
+						std::lock_guard<std::mutex> lock(mutex);
+						finished = true;
+						ready.notify_one();
+					});
+					bool alive = true;
+					{
+						std::unique_lock<std::mutex> lock(mutex);
+						for (;;) {
+							ready.wait(lock, [&] () { return finished || !queue.empty(); });
+							if (queue.empty()) break;
+							std::pair<TileHeader,std::vector<float>> tile = std::move(queue.front());
+							queue.pop_front();
+							lock.unlock();
+							//Once the client is gone the rest of the tiles are only drained
+							alive = alive && client.send(&tile.first, sizeof(tile.first)) && client.send(tile.second.data(), sizeof(float)*tile.second.size());
+							lock.lock();
+						}
+					}
+					rendering.join();
+					if (failure) std::rethrow_exception(failure);
+					TileHeader end{-1, result.rendered, 0, 0, 0};
+					if (!alive || !client.send(&end, sizeof(end))) return;
+				} else if (!error("Unknown command " + command)) return;
+			} catch (const std::exception& e) {
+				if (!error(e.what())) return;
+			}
+		}
+	}
+
+	/**
+	 * Accepts clients until stop() is called, each one served from its own thread (which only
+	 * parses and sends: rendering happens on the pool). Threads of clients that went away are
+	 * joined as new clients arrive (and at least every 50 ms), so they do not pile up.
+	 **/
+	void run(Listener& listener) {
+		struct Client {
+			std::thread thread;
+			std::shared_ptr<std::atomic<bool>> done = std::make_shared<std::atomic<bool>>(false);
+		};
+		std::list<Client> clients;
+		auto reap = [&clients] () {
+			for (auto c = clients.begin(); c != clients.end(); ) {
+				if (*c->done) { c->thread.join(); c = clients.erase(c); }
+				else ++c;
+			}
+		};
+		while (!stop_) {
+			reap();
+			client_threads_ = int(clients.size());
+			pollfd fd{listener.fd(), POLLIN, 0};
+			int ready = ::poll(&fd, 1, 50);
+			if ((ready <= 0) || stop_) continue;
+			Socket client = listener.accept();
+			std::lock_guard<std::mutex> lock(mutex_);
+			connections_.insert(client.fd());
+			clients.emplace_back();
+			clients.back().thread = std::thread([this, done = clients.back().done] (Socket client) {
+				serve(client);
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					connections_.erase(client.fd());
+				}
+				*done = true;
+			}, std::move(client));
+			client_threads_ = int(clients.size());
+		}
+		for (Client& c : clients) c.thread.join();
+		client_threads_ = 0;
+	}
+
+	//Threads of clients that run() has not joined yet
+	int client_threads() const noexcept { return client_threads_; }
+
+	//Makes run() return, after the requests in progress (clients waiting for another one are disconnected)
+	void stop() {
+		stop_ = true;
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (int fd : connections_) ::shutdown(fd, SHUT_RD);
+	}
+};
+
+/**
+ * Client side of a render request. on_tile(const AovBuffers&, const tracer::Tile&) is called as
+ * each tile arrives (e.g. to show progress), the Result holds the whole image. Throws if the
+ * server reports an error or goes away.
+ **/
+template<typename OnTile>
+Result request(Socket& server, const Request& request, OnTile&& on_tile) {
+	auto start = std::chrono::steady_clock::now();
+	std::string line = format(request) + "\n";
+	if (!server.send(line.data(), line.size())) throw Exception("The server went away");
+	Header header;
+	if (!server.receive(&header, sizeof(header))) throw Exception("The server went away");
+	if (header.status != 0) {
+		std::int32_t length = 0;
+		std::string message;
+		if (server.receive(&length, sizeof(length)) && (length >= 0) && (length < 65536)) {
+			message.resize(std::size_t(length));
+			server.receive(&message[0], message.size());
+		}
+		throw Exception(message);
+	}
+	Result sol;
+	sol.buffers = AovBuffers(header.width, header.height, unsigned(header.aovs));
+	sol.tiles = header.tiles;
+	TileHeader th;
+	std::vector<float> data;
+	for (;;) {
+		if (!server.receive(&th, sizeof(th))) throw Exception("The server went away");
+		if (th.tile < 0) break;
+		tracer::Tile t{th.x0, th.y0, th.x1, th.y1};
+		if ((t.x0 < 0) || (t.y0 < 0) || (t.x1 > header.width) || (t.y1 > header.height) || (t.size() <= 0)) throw Exception("Wrong tile");
+		std::size_t floats = 0;
+		for (int a = 0; a<aov::count; ++a) if (sol.buffers.has(1u<<a)) floats += std::size_t(aov::channels(1u<<a))*std::size_t(t.size());
+		data.resize(floats);
+		if (!server.receive(data.data(), sizeof(float)*floats)) throw Exception("The server went away");
+		const float* d = data.data();
+		for (int a = 0; a<aov::count; ++a) {
+			unsigned bit = 1u<<a;
+			if (!sol.buffers.has(bit)) continue;
+			std::size_t row = std::size_t(aov::channels(bit))*std::size_t(t.width());
+			for (int j = t.y0; j<t.y1; ++j, d += row) std::copy(d, d + row, sol.buffers(bit, t.x0, j));
+		}
+		++sol.rendered;
+		on_tile(static_cast<const AovBuffers&>(sol.buffers), t);
+	}
+	if (th.x0 != sol.rendered) throw Exception("Missing tiles");
+	sol.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return sol;
+}
+
+inline Result request(Socket& server, const Request& r) { return request(server, r, [] (const AovBuffers&, const tracer::Tile&) { }); }
+
+}
+
+}
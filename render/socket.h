@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <cstring>
+#include <cerrno>
+#include <stdexcept>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+namespace render {
+
+class SocketException : public std::exception {
+	std::string w;
+public:
+	SocketException(const std::string& w) : w(w + ": " + std::strerror(errno)) {}
+	const char* what() const noexcept override { return w.c_str(); }
+};
+
+/**
+ * A connected stream socket (Unix-domain or TCP), closed on destruction. send() and receive()
+ * transfer whole messages, and report a closed peer by returning false instead of throwing
+ * (or raising SIGPIPE): a peer that goes away is expected in a render farm.
+ **/
+class Socket {
+	int fd_;
+public:
+	explicit Socket(int fd = -1) noexcept : fd_(fd) {}
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	Socket(Socket&& s) noexcept : fd_(s.fd_) { s.fd_ = -1; }
+	Socket& operator=(Socket&& s) noexcept { if (this != &s) { close(); fd_ = s.fd_; s.fd_ = -1; } return *this; }
+	~Socket() { close(); }
+
+	int fd() const noexcept { return fd_; }
+	bool is_open() const noexcept { return fd_ >= 0; }
+	void close() noexcept { if (fd_ >= 0) ::close(fd_); fd_ = -1; }
+
+	bool send(const void* data, std::size_t bytes) noexcept {
+		const char* p = static_cast<const char*>(data);
+		while (bytes > 0) {
+			ssize_t n = ::send(fd_, p, bytes, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			p += n; bytes -= std::size_t(n);
+		}
+		return true;
+	}
+
+	bool receive(void* data, std::size_t bytes) noexcept {
+		char* p = static_cast<char*>(data);
+		while (bytes > 0) {
+			ssize_t n = ::recv(fd_, p, bytes, 0);
+			if (n < 0 && errno == EINTR) continue;
+			if (n <= 0) return false;
+			p += n; bytes -= std::size_t(n);
+		}
+		return true;
+	}
+};
+
+//Both ends of an anonymous Unix-domain connection (e.g. for a forked process)
+inline std::array<Socket,2> socket_pair() {
+	int fds[2];
+	if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) throw SocketException("socketpair");
+	return std::array<Socket,2>{Socket(fds[0]), Socket(fds[1])};
+}
+
+/**
+ * Address of a listening socket: a filesystem path for Unix-domain sockets or host:port for TCP.
+ **/
+class Address {
+	std::string host_, port_;
+	bool unix_;
+public:
+	Address(const std::string& address) : unix_(address.find(':') == std::string::npos) {
+		if (unix_) host_ = address;
+		else { host_ = address.substr(0, address.rfind(':')); port_ = address.substr(address.rfind(':') + 1); }
+	}
+
+	bool is_unix() const noexcept { return unix_; }
+	const std::string& path() const noexcept { return host_; }
+	const std::string& host() const noexcept { return host_; }
+	const std::string& port() const noexcept { return port_; }
+
+	template<typename F> //f(int family, const sockaddr*, socklen_t) -> int fd (or -1 to try the next one)
+	int for_each_sockaddr(F&& f, bool passive) const {
+		if (unix_) {
+			sockaddr_un a{}; a.sun_family = AF_UNIX;
+			if (host_.size() >= sizeof(a.sun_path)) { errno = ENAMETOOLONG; return -1; }
+			std::strncpy(a.sun_path, host_.c_str(), sizeof(a.sun_path) - 1);
+			return f(AF_UNIX, reinterpret_cast<const sockaddr*>(&a), socklen_t(sizeof(a)));
+		}
+		addrinfo hints{}; hints.ai_family = AF_UNSPEC; hints.ai_socktype = SOCK_STREAM; hints.ai_flags = passive ? AI_PASSIVE : 0;
+		addrinfo* list = nullptr;
+		if (::getaddrinfo(host_.empty() ? nullptr : host_.c_str(), port_.c_str(), &hints, &list) != 0) { errno = EINVAL; return -1; }
+		int fd = -1;
+		for (addrinfo* a = list; a && (fd < 0); a = a->ai_next) fd = f(a->ai_family, a->ai_addr, a->ai_addrlen);
+		::freeaddrinfo(list);
+		return fd;
+	}
+};
+
+inline Socket connect(const Address& address) {
+	int fd = address.for_each_sockaddr([] (int family, const sockaddr* a, socklen_t size) {
+		int fd = ::socket(family, SOCK_STREAM, 0);
+		if ((fd >= 0) && (::connect(fd, a, size) < 0)) { ::close(fd); fd = -1; }
+		return fd;
+	}, false);
+	if (fd < 0) throw SocketException("Cannot connect to " + address.host() + (address.is_unix() ? "" : ":" + address.port()));
+	if (!address.is_unix()) { int one = 1; ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); }
+	return Socket(fd);
+}
+
+/**
+ * A listening socket. Unix-domain sockets are unlinked before binding and on destruction.
+ **/
+class Listener {
+	Address address_;
+	Socket socket_;
+public:
+	Listener(const Address& address, int backlog = 64) : address_(address) {
+		if (address_.is_unix()) ::unlink(address_.path().c_str());
+		int fd = address_.for_each_sockaddr([backlog] (int family, const sockaddr* a, socklen_t size) {
+			int fd = ::socket(family, SOCK_STREAM, 0);
+			int one = 1;
+			if (fd >= 0) ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+			if ((fd >= 0) && ((::bind(fd, a, size) < 0) || (::listen(fd, backlog) < 0))) { ::close(fd); fd = -1; }
+			return fd;
+		}, true);
+		if (fd < 0) throw SocketException("Cannot listen on " + address_.host() + (address_.is_unix() ? "" : ":" + address_.port()));
+		socket_ = Socket(fd);
+	}
+	Listener(const Listener&) = delete;
+	~Listener() { socket_.close(); if (address_.is_unix()) ::unlink(address_.path().c_str()); }
+
+	const Address& address() const noexcept { return address_; }
+	int fd() const noexcept { return socket_.fd(); }
+
+	Socket accept() {
+		int fd;
+		do { fd = ::accept(socket_.fd(), nullptr, nullptr); } while ((fd < 0) && (errno == EINTR));
+		if (fd < 0) throw SocketException("accept");
+		if (!address_.is_unix()) { int one = 1; ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); }
+		return Socket(fd);
+	}
+};
+
+}
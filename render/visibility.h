@@ -0,0 +1,231 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include "parallel.h"
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace render {
+
+/**
+ * Primary visibility of a triangle mesh by rasterization instead of ray tracing: the triangles are
+ * projected with the same camera model as tracer::Pinhole::ray, binned to screen tiles and every
+ * tile is rasterized (8 pixels at a time, with edge functions) against a depth buffer, in parallel.
+ * The result is a visibility buffer, the index of the closest triangle and its barycentric
+ * coordinates at the center of each pixel, from which the same Hit as ray tracing is built.
+ *
+ * Triangles are not culled by orientation (rays hit both sides) and are clipped against a near
+ * plane, so they can go through the camera.
+ **/
+class VisibilityBuffer {
+	tracer::Pinhole camera_;
+	int w_, h_;
+	std::vector<std::int32_t> triangles_; //-1 if nothing is visible
+	std::vector<float> u_, v_;            //As in Triangle::hit: weights of point1 and point2
+	std::vector<float> inv_depth_;        //Reciprocal of the depth along the front axis of the camera, 0 if nothing
+
+public:
+	VisibilityBuffer(const tracer::Pinhole& camera, int w, int h) :
+		camera_(camera), w_(w), h_(h), triangles_(std::size_t(w)*std::size_t(h), -1),
+		u_(triangles_.size(), 0.0f), v_(triangles_.size(), 0.0f), inv_depth_(triangles_.size(), 0.0f) {}
+
+	int width() const noexcept { return w_; }
+	int height() const noexcept { return h_; }
+	const tracer::Pinhole& camera() const noexcept { return camera_; }
+
+	std::int32_t triangle(int i, int j) const noexcept { return triangles_[std::size_t(j)*w_ + i]; }
+	float u(int i, int j) const noexcept { return u_[std::size_t(j)*w_ + i]; }
+	float v(int i, int j) const noexcept { return v_[std::size_t(j)*w_ + i]; }
+
+	//Raw rows for the rasterizer
+	std::int32_t* triangles(int j) noexcept { return triangles_.data() + std::size_t(j)*w_; }
+	float* u(int j) noexcept { return u_.data() + std::size_t(j)*w_; }
+	float* v(int j) noexcept { return v_.data() + std::size_t(j)*w_; }
+	float* inv_depth(int j) noexcept { return inv_depth_.data() + std::size_t(j)*w_; }
+
+	//The primary ray through the center of a pixel, as traced by PrimaryHitCache
+	tracer::Ray ray(int i, int j) const {
+		return camera_.ray((float(i) + 0.5f)*2.0f/float(w_) - 1.0f, (float(j) + 0.5f)*2.0f/float(h_) - 1.0f);
+	}
+
+	/**
+	 * The hit of the primary ray of a pixel, built by the triangle itself (Triangle::hit) from the
+	 * barycentric coordinates, with the material of the triangle (as ObjectImpl::trace). triangles
+	 * should be the collection that was rasterized.
+	 **/
+	template<typename C>
+	std::optional<tracer::Hit> hit(const C& triangles, int i, int j) const {
+		std::int32_t id = triangle(i,j);
+		if (id < 0) return std::nullopt;
+		const tracer::Triangle& t = triangles[std::size_t(id)];
+		float a = u(i,j), b = v(i,j);
+		tracer::Ray r = ray(i,j);
+		Eigen::Vector3f p = (1.0f - a - b)*t.point0() + a*t.point1() + b*t.point2();
+		tracer::Hit sol = t.hit(r, std::make_tuple((p - r.origin()).dot(r.direction()), a, b));
+		sol.set_primitive(id); //As a List of the triangles numbers them
+#ifdef MATERIAL
+		sol.set_material(t.material());
+#endif
+		return sol;
+	}
+};
+
+struct RasterOptions {
+	int tile_size = 32;
+	float near = 1.e-4f; //Distance of the near plane along the front axis of the camera
+	unsigned int threads = std::thread::hardware_concurrency();
+};
+
+/**
+ * A triangle projected to the screen, ready for rasterization: edge functions (normalized so they
+ * are the screen space barycentric coordinates) and the attributes divided by depth, so they can
+ * be interpolated in screen space with perspective correction.
+ **/
+struct ScreenTriangle {
+	std::array<float,3> a, b, c;       //lambda_k(x,y) = a[k]*x + b[k]*y + c[k]
+	std::array<float,3> inv_depth;     //1/s of each vertex
+	std::array<float,3> u, v;          //Barycentric coordinates in the original triangle, divided by s
+	std::int32_t id;
+	int x0, y0, x1, y1;                //Pixels covered by the bounding box, [x0,x1) x [y0,y1)
+};
+
+/**
+ * Projects a triangle and appends the result (0, 1 or 2 screen triangles after near plane clipping).
+ * from_camera transforms from world space to the (left, up, front) coordinates of the camera.
+ **/
+inline void project(const tracer::Triangle& t, std::int32_t id, const Eigen::Matrix3f& from_camera, const Eigen::Vector3f& origin,
+                    int w, int h, float near, std::vector<ScreenTriangle>& out) {
+	struct Vertex { Eigen::Vector3f c; float u, v; };
+	std::array<Vertex,3> triangle{Vertex{from_camera*(t.point0() - origin), 0.0f, 0.0f},
+	                              Vertex{from_camera*(t.point1() - origin), 1.0f, 0.0f},
+	                              Vertex{from_camera*(t.point2() - origin), 0.0f, 1.0f}};
+	//Sutherland-Hodgman against s >= near (at most 4 vertices)
+	std::array<Vertex,4> polygon; int n = 0;
+	for (int k = 0; k<3; ++k) {
+		const Vertex& p = triangle[k]; const Vertex& q = triangle[(k+1)%3];
+		bool pin = p.c[2] >= near, qin = q.c[2] >= near;
+		if (pin) polygon[n++] = p;
+		if (pin != qin) {
+			float f = (near - p.c[2])/(q.c[2] - p.c[2]);
+			polygon[n++] = Vertex{p.c + f*(q.c - p.c), p.u + f*(q.u - p.u), p.v + f*(q.v - p.v)};
+		}
+	}
+
+	for (int k = 1; k+1<n; ++k) {
+		std::array<const Vertex*,3> v{&polygon[0], &polygon[k], &polygon[k+1]};
+		std::array<float,3> x, y;
+		for (int i = 0; i<3; ++i) {
+			//Inverse of Pinhole::ray: direction = -u*left - v*up + front
+			x[i] = 0.5f*float(w)*(1.0f - v[i]->c[0]/v[i]->c[2]);
+			y[i] = 0.5f*float(h)*(1.0f - v[i]->c[1]/v[i]->c[2]);
+		}
+		float area = (x[1] - x[0])*(y[2] - y[0]) - (x[2] - x[0])*(y[1] - y[0]);
+		if (!(std::abs(area) > 0.0f)) continue; //Degenerate (or seen edge-on)
+
+		ScreenTriangle s;
+		s.id = id;
+		//Vertices close to the near plane project very far (even to infinity), so the bounds are
+		//clamped to the screen while they are still floats (NaN goes to 0 too)
+		auto screen = [] (float f, int size) { return (f > 0.0f) ? std::min(f, float(size)) : 0.0f; };
+		s.x0 = int(std::ceil(screen(std::min({x[0],x[1],x[2]}), w) - 0.5f));
+		s.x1 = int(std::floor(screen(std::max({x[0],x[1],x[2]}), w) - 0.5f)) + 1;
+		s.y0 = int(std::ceil(screen(std::min({y[0],y[1],y[2]}), h) - 0.5f));
+		s.y1 = int(std::floor(screen(std::max({y[0],y[1],y[2]}), h) - 0.5f)) + 1;
+		if ((s.x0 >= s.x1) || (s.y0 >= s.y1)) continue;
+		for (int i = 0; i<3; ++i) {
+			//Edge opposite to vertex i
+			int p = (i+1)%3, q = (i+2)%3;
+			s.a[i] = -(y[q] - y[p])/area;
+			s.b[i] =  (x[q] - x[p])/area;
+			s.c[i] = ((y[q] - y[p])*x[p] - (x[q] - x[p])*y[p])/area;
+			s.inv_depth[i] = 1.0f/v[i]->c[2];
+			s.u[i] = v[i]->u*s.inv_depth[i];
+			s.v[i] = v[i]->v*s.inv_depth[i];
+		}
+		out.push_back(s);
+	}
+}
+
+/**
+ * Rasterizes the triangles of the tiles they were binned to, 8 pixels of a row at a time. Closer
+ * triangles win, and the lowest index on exact ties so the result does not depend on the order
+ * of the bins.
+ **/
+inline void rasterize(const ScreenTriangle& s, const tracer::Tile& tile, VisibilityBuffer& buffer) {
+	using Lanes = Eigen::Array<float,8,1>;
+	static const Lanes offsets = Lanes::LinSpaced(8, 0.5f, 7.5f);
+	int x0 = std::max(s.x0, tile.x0), x1 = std::min(s.x1, tile.x1);
+	int y0 = std::max(s.y0, tile.y0), y1 = std::min(s.y1, tile.y1);
+	for (int j = y0; j<y1; ++j) {
+		float y = float(j) + 0.5f;
+		std::int32_t* ids = buffer.triangles(j); float* us = buffer.u(j); float* vs = buffer.v(j); float* depths = buffer.inv_depth(j);
+		for (int i = x0; i<x1; i+=8) {
+			Lanes x = offsets + float(i);
+			Lanes l0 = s.a[0]*x + (s.b[0]*y + s.c[0]);
+			Lanes l1 = s.a[1]*x + (s.b[1]*y + s.c[1]);
+			Lanes l2 = s.a[2]*x + (s.b[2]*y + s.c[2]);
+			Lanes inv_depth = l0*s.inv_depth[0] + l1*s.inv_depth[1] + l2*s.inv_depth[2];
+			int lanes = std::min(8, x1 - i);
+			auto inside = (l0 >= 0.0f) && (l1 >= 0.0f) && (l2 >= 0.0f);
+			Lanes current = Lanes::Zero();
+			for (int k = 0; k<lanes; ++k) current[k] = depths[i+k];
+			auto closer = inside && (inv_depth >= current);
+			if (!closer.head(lanes).any()) continue;
+			Lanes u = (l0*s.u[0] + l1*s.u[1] + l2*s.u[2])/inv_depth;
+			Lanes v = (l0*s.v[0] + l1*s.v[1] + l2*s.v[2])/inv_depth;
+			for (int k = 0; k<lanes; ++k) {
+				if (!closer[k]) continue;
+				if ((inv_depth[k] == current[k]) && (ids[i+k] >= 0) && (ids[i+k] < s.id)) continue;
+				ids[i+k] = s.id; us[i+k] = u[k]; vs[i+k] = v[k]; depths[i+k] = inv_depth[k];
+			}
+		}
+	}
+}
+
+/**
+ * The visibility buffer of a collection of triangles (indexable, e.g. a std::vector<Triangle>)
+ * from a camera. Projection and binning are parallel over chunks of triangles, rasterization over
+ * tiles.
+ **/
+template<typename C>
+VisibilityBuffer visibility(const C& triangles, const tracer::Pinhole& camera, int w, int h, const RasterOptions& options = RasterOptions()) {
+	TRACER_PROFILE_SCOPE("rasterize");
+	VisibilityBuffer sol(camera, w, h);
+	Eigen::Matrix3f from_camera = camera.transform().block<3,3>(0,0).inverse();
+	Eigen::Vector3f origin = camera.transform().block<3,1>(0,3);
+	int ts = std::max(8, options.tile_size);
+	int tw = (w + ts - 1)/ts, th = (h + ts - 1)/ts;
+
+	//Every chunk projects and bins its own triangles, so no synchronization is needed
+	int chunks = int(std::max(1u, options.threads))*4;
+	std::size_t n = std::size(triangles);
+	std::vector<std::vector<ScreenTriangle>> projected(chunks);
+	std::vector<std::vector<std::vector<std::uint32_t>>> bins(chunks);
+	parallel_for(chunks, [&] (int chunk) {
+		TRACER_PROFILE_SCOPE("bin triangles", chunk);
+		std::size_t first = n*std::size_t(chunk)/std::size_t(chunks), last = n*std::size_t(chunk+1)/std::size_t(chunks);
+		std::vector<ScreenTriangle>& screen = projected[chunk];
+		bins[chunk].resize(std::size_t(tw)*th);
+		for (std::size_t t = first; t<last; ++t) {
+			std::size_t before = screen.size();
+			project(triangles[t], std::int32_t(t), from_camera, origin, w, h, options.near, screen);
+			for (std::size_t s = before; s<screen.size(); ++s)
+				for (int ty = screen[s].y0/ts; ty <= (screen[s].y1 - 1)/ts; ++ty)
+					for (int tx = screen[s].x0/ts; tx <= (screen[s].x1 - 1)/ts; ++tx) bins[chunk][std::size_t(ty)*tw + tx].push_back(std::uint32_t(s));
+		}
+	}, options.threads);
+
+	parallel_for(tw*th, [&] (int b) {
+		TRACER_PROFILE_SCOPE("rasterize tile", b);
+		int tx = b % tw, ty = b / tw;
+		tracer::Tile tile{tx*ts, ty*ts, std::min(w, (tx+1)*ts), std::min(h, (ty+1)*ts)};
+		for (int chunk = 0; chunk<chunks; ++chunk)
+			for (std::uint32_t s : bins[chunk][std::size_t(b)]) rasterize(projected[chunk][s], tile, sol);
+	}, options.threads);
+	return sol;
+}
+
+}
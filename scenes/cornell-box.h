@@ -4,6 +4,7 @@
 namespace scenes {
 
 tracer::Scene cornell_box() {
+	TRACER_PROFILE_SCOPE("build scene");
 	tracer::Scene sol;
 	std::list<tracer::Plane> planes;
 	planes.push_back(tracer::Plane(Eigen::Vector3f( 0, 0,-1), Eigen::Vector3f( 0, 0, 1)));
@@ -12,9 +13,11 @@ tracer::Scene cornell_box() {
 	planes.push_back(tracer::Plane(Eigen::Vector3f(-1, 0, 0), Eigen::Vector3f( 1, 0, 0)));
 	planes.push_back(tracer::Plane(Eigen::Vector3f( 1, 0, 0), Eigen::Vector3f(-1, 0, 0)));
 
-	sol.add(tracer::pack<5>(planes));
-	sol.add(tracer::pack(tracer::Sphere(Eigen::Vector3f( 0.5, -0.65,-0.2), 0.35),
-						 tracer::Sphere(Eigen::Vector3f(-0.5, -0.65, 0.5), 0.35)));
+	for (const auto& pack : tracer::packs(planes)) sol.add(pack);
+	std::list<tracer::Sphere> spheres;
+	spheres.push_back(tracer::Sphere(Eigen::Vector3f( 0.5, -0.65,-0.2), 0.35));
+	spheres.push_back(tracer::Sphere(Eigen::Vector3f(-0.5, -0.65, 0.5), 0.35));
+	for (const auto& pack : tracer::packs(spheres)) sol.add(pack);
 //	sol.add(tracer::Instance(Eigen::Vector3f(2,1,1).asDiagonal(),tracer::Sphere(Eigen::Vector3f(0,-0.65,0.6),0.35)));
 	/**
 	std::list<tracer::Triangle> triangles;
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <tracer/tracer.h>
+#include <vector>
+#include <cmath>
+
+namespace scenes {
+
+/**
+ * A ground plane with a regular n x n field of spheres of varying radius on top of it, 
+ * grouped in packs (of the tuned width, see tracer/pack/pack-widths.h).
+ **/
+tracer::Scene sphere_field(int n = 16) {
+	TRACER_PROFILE_SCOPE("build scene");
+	tracer::Scene sol;
+	sol.add(tracer::Plane(Eigen::Vector3f(0,1,0), Eigen::Vector3f(0,0,0)));
+	std::vector<tracer::Sphere> spheres;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<n; ++i) {
+		float r = 0.2f + 0.15f*std::sin(float(3*i+7*j));
+		spheres.push_back(tracer::Sphere(Eigen::Vector3f(float(i) - 0.5f*float(n), r, float(j)), r));
+	}
+	for (const auto& pack : tracer::packs(spheres)) sol.add(pack);
+	return sol;
+}
+
+/**
+ * A procedural heightfield of 2 x n x n triangles over [-1,1]x[-1,1] (in the XZ plane).
+ **/
+std::vector<tracer::Triangle> terrain_triangles(int n = 32) {
+	auto height = [] (float x, float z) { return 0.15f*std::sin(5.0f*x)*std::cos(4.0f*z) + 0.05f*std::sin(17.0f*x*z); };
+	auto vertex = [&height,n] (int i, int j) {
+		float x = 2.0f*float(i)/float(n) - 1.0f; float z = 2.0f*float(j)/float(n) - 1.0f;
+		return Eigen::Vector3f(x, height(x,z), z);
+	};
+	
+	std::vector<tracer::Triangle> sol;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<n; ++i) {
+		sol.push_back(tracer::Triangle(vertex(i,j), vertex(i,j+1), vertex(i+1,j)));
+		sol.push_back(tracer::Triangle(vertex(i+1,j), vertex(i,j+1), vertex(i+1,j+1)));
+	}
+	return sol;
+}
+
+/**
+ * A unit sphere as a smooth (vertex normals and tangents) mesh of 2 x n x 2n triangles. 
+ **/
+std::vector<tracer::Triangle> sphere_triangles(int n = 64) {
+	const float pi = 3.14159265358979f;
+	auto point = [&] (int i, int j) {
+		float theta = pi*float(j)/float(n), phi = pi*float(i)/float(n);
+		return Eigen::Vector3f(std::sin(theta)*std::cos(phi), std::cos(theta), std::sin(theta)*std::sin(phi));
+	};
+	auto tangent = [&] (int i) {
+		float phi = pi*float(i)/float(n);
+		return Eigen::Vector3f(-std::sin(phi), 0.0f, std::cos(phi));
+	};
+	std::vector<tracer::Triangle> sol;
+	for (int j = 0; j<n; ++j) for (int i = 0; i<2*n; ++i) {
+		Eigen::Vector3f p00 = point(i,j), p10 = point(i+1,j), p01 = point(i,j+1), p11 = point(i+1,j+1);
+		if (j > 0)   sol.push_back(tracer::Triangle(p00, p00, tangent(i), p01, p01, tangent(i), p10, p10, tangent(i+1)));
+		if (j < n-1) sol.push_back(tracer::Triangle(p10, p10, tangent(i+1), p01, p01, tangent(i), p11, p11, tangent(i+1)));
+	}
+	return sol;
+}
+
+/**
+ * The terrain in packs of triangles (of the tuned width).
+ **/
+tracer::Scene terrain(int n = 32) {
+	TRACER_PROFILE_SCOPE("build scene");
+	tracer::Scene sol;
+	for (const auto& pack : tracer::packs(terrain_triangles(n))) sol.add(pack);
+	return sol;
+}
+
+/**
+ * The terrain as a single compressed mesh.
+ **/
+tracer::Scene compressed_terrain(int n = 32) {
+	TRACER_PROFILE_SCOPE("build scene");
+	tracer::Scene sol;
+	sol.add(tracer::CompressedMesh(terrain_triangles(n)));
+	return sol;
+}
+
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "bvh.h"
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+namespace tracer {
+
+/**
+ * Quality of a Bvh, from its structure alone (no rays traced):
+ *   - SAH cost: expected cost of a ray crossing the root bounds, with the costs of its settings
+ *   - depths: leaves at each depth; leaf sizes and leaf packs: leaves with each number of objects
+ *     and of packs (see Bvh::packs). Leaves cost their packs in the SAH cost, as in the builder
+ *   - overlap: surface area of the intersection of the children of a node over the surface area
+ *     of the node, that is, how often a ray through the node has to visit both of them
+ *   - empty space: fraction of the volume of a node outside both of its children (nodes without
+ *     volume, e.g. around flat geometry, are left out)
+ * Overlap and empty space are given as plain averages over interior nodes and weighted by the
+ * probability that a ray through the root visits each node (its surface area over that of the root),
+ * which is what traversal actually pays for.
+ **/
+struct BvhQuality {
+	std::size_t nodes = 0, leaves = 0, objects = 0, packs = 0;
+	double sah_cost = 0.0;
+	std::vector<std::size_t> depths;
+	std::vector<std::size_t> leaf_sizes, leaf_packs;
+	double overlap = 0.0, weighted_overlap = 0.0;
+	double empty_space = 0.0, weighted_empty_space = 0.0;
+
+	int max_depth() const noexcept { return int(depths.size()) - 1; }
+	double average_depth() const noexcept {
+		double sol = 0.0;
+		for (std::size_t d = 0; d<depths.size(); ++d) sol += double(d)*double(depths[d]);
+		return (leaves > 0) ? sol/double(leaves) : 0.0;
+	}
+	double average_leaf_size() const noexcept { return (leaves > 0) ? double(objects)/double(leaves) : 0.0; }
+	double average_leaf_packs() const noexcept { return (leaves > 0) ? double(packs)/double(leaves) : 0.0; }
+};
+
+template<typename O>
+BvhQuality quality(const Bvh<O>& bvh) {
+	using Node = typename Bvh<O>::Node;
+	BvhQuality sol;
+	const std::vector<Node>& nodes = bvh.nodes();
+	if (nodes.empty()) return sol;
+	const double root = std::max(double(nodes[0].bounds.surface_area()), 1.e-30);
+	auto count = [] (std::vector<std::size_t>& histogram, std::size_t i) {
+		if (histogram.size() <= i) histogram.resize(i + 1, 0);
+		++histogram[i];
+	};
+
+	std::size_t interior = 0, with_volume = 0;
+	double weights = 0.0, volume_weights = 0.0;
+	std::vector<std::pair<std::uint32_t,int>> stack{{0u,0}};
+	while (!stack.empty()) {
+		auto [index, depth] = stack.back(); stack.pop_back();
+		const Node& node = nodes[index];
+		double probability = double(node.bounds.surface_area())/root;
+		++sol.nodes;
+		if (node.leaf()) {
+			std::size_t packs = Bvh<O>::packs(node.count);
+			++sol.leaves; sol.objects += node.count; sol.packs += packs;
+			count(sol.depths, std::size_t(depth)); count(sol.leaf_sizes, node.count); count(sol.leaf_packs, packs);
+			sol.sah_cost += probability*bvh.settings().intersection_cost*double(packs);
+			continue;
+		}
+		sol.sah_cost += probability*bvh.settings().traversal_cost;
+		const Bounds& left = nodes[index + 1].bounds;
+		const Bounds& right = nodes[node.first].bounds;
+		Bounds both = left.intersection(right);
+		double area = node.bounds.surface_area();
+		double overlap = (area > 0.0) ? double(both.surface_area())/area : 0.0;
+		++interior; weights += probability;
+		sol.overlap += overlap; sol.weighted_overlap += probability*overlap;
+		double volume = node.bounds.volume();
+		if (volume > 0.0) {
+			double empty = 1.0 - (double(left.volume()) + double(right.volume()) - double(both.volume()))/volume;
+			++with_volume; volume_weights += probability;
+			sol.empty_space += empty; sol.weighted_empty_space += probability*empty;
+		}
+		stack.emplace_back(node.first, depth + 1);
+		stack.emplace_back(index + 1, depth + 1);
+	}
+	if (interior > 0)    { sol.overlap /= double(interior); sol.weighted_overlap /= weights; }
+	if (with_volume > 0) { sol.empty_space /= double(with_volume); sol.weighted_empty_space /= volume_weights; }
+	return sol;
+}
+
+}
@@ -0,0 +1,334 @@
+#pragma once
+
+#include "../object.h"
+#include "../prepared-ray.h"
+#include "../profiler.h"
+#include "../pack/pack-widths.h"
+#include "../pack/pack-plane.h"
+#include "../pack/pack-sphere.h"
+#include "../pack/pack-triangle.h"
+#include "../pack/pack-axis-aligned-box.h"
+#include "../pack/candidates.h"
+#include <vector>
+#include <array>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+
+namespace tracer {
+
+/**
+ * How a Bvh is built. Costs are relative: the surface area heuristic only compares them.
+ **/
+struct BvhSettings {
+	int max_leaf_size = 0;           //0: the one tuned for the objects (pack_width<O>::leaf_size), 4 if they are not packed.
+	                                 //Leaves may be smaller, when splitting them costs more than it saves
+	int bins = 16;                   //Candidate split planes per axis and node
+	float traversal_cost = 1.0f;     //Visiting a node (two box tests)
+	float intersection_cost = 1.0f;  //Testing one object (one pack if they are packed)
+};
+
+/**
+ * Bounding volume hierarchy over a collection of objects (primitives, packs, instances...), built
+ * top down with the binned surface area heuristic (SAH): the centroids of the objects of a node
+ * are binned along each axis and the node is split at the bin boundary with the lowest expected
+ * cost, or becomes a leaf if that is cheaper (or small enough and no split pays off).
+ *
+ * Objects are reordered so that every leaf is a contiguous range. Nodes are stored depth first:
+ * the first child of an interior node comes right after it. Rays visit the nearest child first,
+ * so closest hits shrink the range early. Objects without bounds (planes) cannot be placed in the
+ * hierarchy: they are kept aside and tested by every ray.
+ *
+ * Primitives with a tuned pack width (pack-widths.h) are stored in packs of that width
+ * (Pack<O, pack_width_v<O>>): each leaf is split into as few packs as it needs, and the surface
+ * area heuristic counts packs instead of objects, since a pack is tested as fast as a single
+ * object. Hits are then those of the packs (the lane tells the object).
+ **/
+template<typename O>
+class Bvh : public ObjectImpl<Bvh<O>> {
+	static_assert(std::is_base_of_v<ObjectBase,O>, "The Bvh is not a Bvh of Objects");
+
+public:
+	static constexpr int width = pack_width_v<O>;
+	static constexpr bool packed = (width > 1);
+	//What the leaves hold: packs of objects or the objects themselves
+	using Leaf = std::conditional_t<packed, Pack<O,width>, O>;
+	static constexpr int max_depth = 64;
+	static constexpr int default_leaf_size = packed ? pack_width<O>::leaf_size : 4;
+
+private:
+	using HitType = typename object_traits<Leaf>::HitType;
+	using RayType = typename object_traits<Leaf>::RayType;
+	static_assert(std::is_base_of_v<PreparedRay,RayType>, "Objects in a Bvh should trace PreparedRays");
+
+public:
+	//Packs that hold n objects (the objects themselves if they are not packed), which is what leaves cost
+	static constexpr std::uint32_t packs(std::uint32_t n) noexcept { return packed ? (n + std::uint32_t(width) - 1)/std::uint32_t(width) : n; }
+
+	struct Node {
+		Bounds bounds;
+		std::uint32_t first = 0; //Leaves: first pack (object if not packed). Interior nodes: second child (the first one is the next node)
+		std::uint32_t count = 0; //Objects of a leaf, 0 for interior nodes
+		bool leaf() const noexcept { return count > 0; }
+	};
+
+private:
+	std::vector<Leaf> leaves_;  //Bounded ones first, in the order of the leaves
+	std::uint32_t bounded_ = 0; //Packs (objects) of the leaves
+	std::uint32_t unbounded_ = 0; //Objects
+	std::vector<Node> nodes_;
+	BvhSettings settings_;
+
+	struct Item {
+		Bounds bounds;
+		Eigen::Vector3f centroid;
+		std::uint32_t index;
+	};
+
+	std::uint32_t leaf(Node& node, std::uint32_t begin, std::uint32_t end) {
+		node.first = begin; node.count = end - begin;
+		nodes_.push_back(node);
+		return std::uint32_t(nodes_.size() - 1);
+	}
+
+	std::uint32_t build(std::vector<Item>& items, std::uint32_t begin, std::uint32_t end, int depth) {
+		Node node; Bounds centroids;
+		for (std::uint32_t i = begin; i<end; ++i) { node.bounds.extend(items[i].bounds); centroids.extend(items[i].centroid); }
+		const std::uint32_t n = end - begin;
+		//Traversal keeps a stack of at most one node per level
+		if ((n == 1) || (depth + 1 >= max_depth)) return leaf(node, begin, end);
+
+		//Best split over every axis: cost = traversal + intersection*(A_left N_left + A_right N_right)/A
+		const int bins = std::max(settings_.bins, 2);
+		float best_cost = std::numeric_limits<float>::infinity();
+		int best_axis = -1, best_bin = 0;
+		std::vector<Bounds> bounds(bins); std::vector<std::uint32_t> counts(bins);
+		std::vector<float> right_areas(bins); std::vector<std::uint32_t> right_counts(bins);
+		auto bin = [&] (const Item& item, int axis) {
+			float extent = centroids.max()[axis] - centroids.min()[axis];
+			return std::min(bins - 1, int(float(bins)*(item.centroid[axis] - centroids.min()[axis])/extent));
+		};
+		for (int axis = 0; axis<3; ++axis) {
+			if (!(centroids.max()[axis] > centroids.min()[axis])) continue;
+			std::fill(bounds.begin(), bounds.end(), Bounds()); std::fill(counts.begin(), counts.end(), 0);
+			for (std::uint32_t i = begin; i<end; ++i) { int b = bin(items[i], axis); bounds[b].extend(items[i].bounds); ++counts[b]; }
+			Bounds right; std::uint32_t count = 0;
+			for (int b = bins - 1; b>0; --b) { right.extend(bounds[b]); count += counts[b]; right_areas[b] = right.surface_area(); right_counts[b] = count; }
+			Bounds left; count = 0;
+			for (int b = 1; b<bins; ++b) {
+				left.extend(bounds[b-1]); count += counts[b-1];
+				if ((count == 0) || (right_counts[b] == 0)) continue;
+				float cost = left.surface_area()*float(packs(count)) + right_areas[b]*float(packs(right_counts[b]));
+				if (cost < best_cost) { best_cost = cost; best_axis = axis; best_bin = b; }
+			}
+		}
+		float area = node.bounds.surface_area();
+		best_cost = settings_.traversal_cost + settings_.intersection_cost*((area > 0.0f) ? best_cost/area : float(packs(n)));
+		float leaf_cost = settings_.intersection_cost*float(packs(n));
+
+		std::uint32_t middle;
+		if (best_axis < 0) {
+			//Every centroid in the same place: there is nothing to gain, only leaves too big are split
+			if (n <= std::uint32_t(settings_.max_leaf_size)) return leaf(node, begin, end);
+			middle = begin + n/2;
+		} else {
+			if ((n <= std::uint32_t(settings_.max_leaf_size)) && (leaf_cost <= best_cost)) return leaf(node, begin, end);
+			middle = std::uint32_t(std::partition(items.begin() + begin, items.begin() + end,
+				[&] (const Item& item) { return bin(item, best_axis) < best_bin; }) - items.begin());
+		}
+
+		std::uint32_t index = std::uint32_t(nodes_.size());
+		node.count = 0;
+		nodes_.push_back(node);
+		build(items, begin, middle, depth + 1);
+		nodes_[index].first = build(items, middle, end, depth + 1);
+		return index;
+	}
+
+	//Entry distance into the bounds (slab test), infinity if the ray misses them
+	static float entry(const Bounds& b, const PreparedRay& r) noexcept {
+		float tmin = r.range_min(), tmax = r.range_max();
+		for (int k = 0; k<3; ++k) {
+			float t1 = ((r.sign()[k] ? b.max() : b.min())[k] - r.origin()[k])*r.inv_direction()[k];
+			float t2 = ((r.sign()[k] ? b.min() : b.max())[k] - r.origin()[k])*r.inv_direction()[k];
+			if (t1 > tmin) tmin = t1;
+			if (t2 < tmax) tmax = t2;
+		}
+		return (tmin <= tmax) ? tmin : std::numeric_limits<float>::infinity();
+	}
+
+	/**
+	 * Visits the leaves that the ray reaches, nearest child first, calling f(leaf) for each of
+	 * their packs (objects). Traversal stops when f returns true. The ray is read again at every node,
+	 * so f may shrink its range.
+	 **/
+	template<typename F>
+	void traverse(const RayType& r, F&& f) const noexcept {
+		if (nodes_.empty() || (entry(nodes_[0].bounds, r) == std::numeric_limits<float>::infinity())) return;
+		std::array<std::uint32_t,max_depth> stack; int top = 0;
+		std::uint32_t current = 0;
+		for (;;) {
+			TRACER_COUNT(nodes,1);
+			const Node& node = nodes_[current];
+			if (node.leaf()) {
+				for (std::uint32_t i = node.first; i<node.first + packs(node.count); ++i) if (f(leaves_[i])) return;
+			} else {
+				std::uint32_t near = current + 1, far = node.first;
+				float tnear = entry(nodes_[near].bounds, r), tfar = entry(nodes_[far].bounds, r);
+				if (tfar < tnear) { std::swap(near, far); std::swap(tnear, tfar); }
+				if (tnear != std::numeric_limits<float>::infinity()) {
+					if (tfar != std::numeric_limits<float>::infinity()) stack[top++] = far;
+					current = near;
+					continue;
+				}
+			}
+			//Far children pushed before the range shrank may be out of it by now
+			do {
+				if (top == 0) return;
+				current = stack[--top];
+			} while (entry(nodes_[current].bounds, r) == std::numeric_limits<float>::infinity());
+		}
+	}
+
+public:
+	template<typename Collection>
+	explicit Bvh(const Collection& objects, const BvhSettings& settings = BvhSettings()) : settings_(settings) {
+		TRACER_PROFILE_SCOPE("build bvh");
+		if (settings_.max_leaf_size <= 0) settings_.max_leaf_size = default_leaf_size;
+		std::vector<O> all(objects.begin(), objects.end());
+		std::vector<Item> items; std::vector<std::uint32_t> unbounded;
+		items.reserve(all.size());
+		for (std::uint32_t i = 0; i<std::uint32_t(all.size()); ++i) {
+			Bounds b = all[i].bounds();
+			if (b.bounded()) items.push_back(Item{b, b.center(), i});
+			else unbounded.push_back(i);
+		}
+		nodes_.reserve(2*items.size());
+		if (!items.empty()) build(items, 0, std::uint32_t(items.size()), 0);
+		nodes_.shrink_to_fit();
+
+		unbounded_ = std::uint32_t(unbounded.size());
+		if constexpr (packed) {
+			//Each leaf (in depth first order, so in the order of the items) gets its own packs, whose
+			//lanes index the objects in that order
+			std::vector<O> chunk; std::uint32_t first = 0;
+			auto add = [&] () {
+				if (!chunk.empty()) leaves_.push_back(Leaf(chunk, first));
+				first += std::uint32_t(chunk.size()); chunk.clear();
+			};
+			leaves_.reserve(nodes_.size() + packs(unbounded_));
+			for (Node& node : nodes_) if (node.leaf()) {
+				std::uint32_t begin = node.first;
+				node.first = std::uint32_t(leaves_.size());
+				for (std::uint32_t i = begin; i<begin + node.count; ++i) {
+					chunk.push_back(std::move(all[items[i].index]));
+					if (int(chunk.size()) == width) add();
+				}
+				add();
+			}
+			bounded_ = std::uint32_t(leaves_.size());
+			for (std::uint32_t i : unbounded) {
+				chunk.push_back(std::move(all[i]));
+				if (int(chunk.size()) == width) add();
+			}
+			add();
+			leaves_.shrink_to_fit();
+		} else {
+			leaves_.reserve(all.size());
+			for (const Item& item : items) leaves_.push_back(std::move(all[item.index]));
+			bounded_ = std::uint32_t(leaves_.size());
+			for (std::uint32_t i : unbounded) leaves_.push_back(std::move(all[i]));
+		}
+	}
+
+	//Packs of objects if they are packed, the objects otherwise
+	const std::vector<Leaf>& leaves() const noexcept { return leaves_; }
+	const std::vector<Node>& nodes() const noexcept { return nodes_; }
+	const BvhSettings& settings() const noexcept { return settings_; }
+	std::size_t unbounded() const noexcept { return unbounded_; }
+	//Leaves (packs or objects) in the hierarchy, the ones after them are unbounded
+	std::size_t bounded_leaves() const noexcept { return bounded_; }
+
+	static RayType extend_ray(const Ray& r) {
+		if constexpr (object_traits<Leaf>::has_ray_type) return Leaf::extend_ray(r);
+		else return PreparedRay(r);
+	}
+
+	std::optional<std::tuple<HitType,const Leaf*>> trace_general(const RayType& ray) const noexcept {
+		RayType r = ray;
+		std::optional<HitType> hit, h;
+		const Leaf* closest = nullptr;
+		auto test = [&] (const Leaf& object) {
+			if ((h = object.trace_general(r))) { hit = h; r.set_range_max(hit_distance(*hit)); closest = &object; }
+			return false;
+		};
+		for (std::uint32_t i = bounded_; i<std::uint32_t(leaves_.size()); ++i) test(leaves_[i]);
+		traverse(r, test);
+		if (hit) return std::tuple<HitType,const Leaf*>(*hit, closest);
+		else return std::nullopt;
+	}
+
+	//Objects that are a single primitive are numbered by their place in the leaves, as packs number their lanes
+	Hit hit(const RayType& ray, const std::tuple<HitType,const Leaf*>& h) const {
+		Hit sol = [&] () {
+			if constexpr (object_traits<Leaf>::has_hit_type) return std::get<1>(h)->hit(ray, std::get<0>(h));
+			else return std::get<0>(h);
+		}();
+		if (sol.primitive() < 0) sol.set_primitive(std::int32_t(std::get<1>(h) - leaves_.data()));
+		return sol;
+	}
+
+	using ObjectImpl<Bvh<O>>::trace_shadow;
+	bool trace_shadow(const PreparedRay& ray) const noexcept override {
+		for (std::uint32_t i = bounded_; i<std::uint32_t(leaves_.size()); ++i) if (leaves_[i].trace_shadow(ray)) return true;
+		bool occluded = false;
+		traverse(extend_ray(ray), [&] (const Leaf& object) { return (occluded = object.trace_shadow(ray)); });
+		return occluded;
+	}
+
+	Bounds bounds() const noexcept override {
+		if (bounded_ < leaves_.size()) return Bounds::unbounded();
+		return nodes_.empty() ? Bounds() : nodes_[0].bounds;
+	}
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash_combine(13, leaves_.size());
+		for (const Leaf& object : leaves_) sol = hash_combine(sol, object.geometry_hash());
+		return sol;
+	}
+
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(Bvh<O>));
+		usage.data(nodes_, MemoryUsage::nodes);
+		for (const Leaf& object : leaves_) object.memory_usage(usage);
+		usage.storage(leaves_);
+	}
+};
+
+/**
+ * The packs (objects) of the leaves of the Bvh that may be hit by a ray inside the frustum (see
+ * cull for lists), plus the unbounded ones. Subtrees whose bounds are outside the frustum are
+ * skipped whole. The Bvh should outlive the result.
+ **/
+template<typename O>
+Candidates<typename Bvh<O>::Leaf> cull(const Bvh<O>& bvh, const Frustum& frustum) {
+	using Leaf = typename Bvh<O>::Leaf;
+	std::vector<const Leaf*> sol;
+	for (std::size_t i = bvh.bounded_leaves(); i<bvh.leaves().size(); ++i) sol.push_back(&bvh.leaves()[i]);
+	std::vector<std::uint32_t> stack;
+	if (!bvh.nodes().empty()) stack.push_back(0);
+	while (!stack.empty()) {
+		std::uint32_t index = stack.back(); stack.pop_back();
+		const typename Bvh<O>::Node& node = bvh.nodes()[index];
+		if (frustum.culls(node.bounds)) continue;
+		if (node.leaf()) {
+			for (std::uint32_t i = node.first; i<node.first + Bvh<O>::packs(node.count); ++i) sol.push_back(&bvh.leaves()[i]);
+		} else {
+			stack.push_back(node.first);
+			stack.push_back(index + 1);
+		}
+	}
+	return Candidates<Leaf>(std::move(sol), bvh.leaves().data());
+}
+
+}
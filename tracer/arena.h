@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+namespace tracer {
+
+/**
+ * Monotonic (bump) allocation for everything a scene owns: objects, packs, materials... 
+ * They end up contiguous in memory, in the order in which they were added, and deallocating
+ * them is free: the whole arena is released at once when it is destroyed.
+ *
+ * Objects allocated in the arena should not outlive it (Scene takes care of that for its own 
+ * objects). It is not thread safe: scenes are expected to be built from a single thread.
+ **/
+class Arena {
+	//Remembers the blocks the arena takes from the heap, so it can tell what lives in it
+	class Blocks : public std::pmr::memory_resource {
+		std::vector<std::pair<const char*,std::size_t>> blocks_;
+	public:
+		const std::vector<std::pair<const char*,std::size_t>>& blocks() const noexcept { return blocks_; }
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+			void* p = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+			blocks_.emplace_back(static_cast<const char*>(p), bytes);
+			return p;
+		}
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	//Counts the bytes handed out (the rest of the blocks is unused)
+	class Counted : public std::pmr::memory_resource {
+		std::pmr::memory_resource* resource_;
+		std::size_t used_ = 0;
+	public:
+		explicit Counted(std::pmr::memory_resource* resource) noexcept : resource_(resource) {}
+		std::size_t used() const noexcept { return used_; }
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override { used_ += bytes; return resource_->allocate(bytes, alignment); }
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override { resource_->deallocate(p, bytes, alignment); }
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	Blocks blocks_;
+	std::pmr::monotonic_buffer_resource monotonic_;
+	Counted resource_;
+public:
+	explicit Arena(std::size_t initial_bytes = std::size_t(1) << 20) : monotonic_(initial_bytes, &blocks_), resource_(&monotonic_) {}
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	std::pmr::memory_resource* resource() noexcept { return &resource_; }
+
+	//Both the object and the control block of the shared pointer live in the arena
+	template<typename T, typename... Args>
+	std::shared_ptr<T> make_shared(Args&&... args) {
+		return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>(&resource_), std::forward<Args>(args)...);
+	}
+
+	//Bytes taken from the heap and bytes handed out of them (see memory.h)
+	std::size_t reserved() const noexcept {
+		std::size_t sol = 0;
+		for (const auto& b : blocks_.blocks()) sol += b.second;
+		return sol;
+	}
+	std::size_t used() const noexcept { return resource_.used(); }
+
+	bool owns(const void* p) const noexcept {
+		std::uintptr_t c = reinterpret_cast<std::uintptr_t>(p);
+		for (const auto& b : blocks_.blocks()) {
+			std::uintptr_t first = reinterpret_cast<std::uintptr_t>(b.first);
+			if ((c >= first) && (c - first < b.second)) return true;
+		}
+		return false;
+	}
+};
+
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <limits>
+
+namespace tracer {
+
+/**
+ * Axis aligned bounds of an object (culling, acceleration structures). Objects that cannot be
+ * bounded (planes) or that do not know their bounds are unbounded, which is always conservative.
+ **/
+class Bounds {
+	Eigen::Vector3f min_, max_;
+public:
+	//Empty bounds, ready to be extended
+	Bounds() noexcept :
+		min_(Eigen::Vector3f::Constant(std::numeric_limits<float>::max())),
+		max_(Eigen::Vector3f::Constant(std::numeric_limits<float>::lowest())) { }
+	Bounds(const Eigen::Vector3f& min, const Eigen::Vector3f& max) noexcept :
+		min_(min), max_(max) { }
+
+	static Bounds unbounded() noexcept {
+		return Bounds(Eigen::Vector3f::Constant(-std::numeric_limits<float>::infinity()), 
+		              Eigen::Vector3f::Constant(std::numeric_limits<float>::infinity()));
+	}
+
+	const Eigen::Vector3f& min() const noexcept { return min_; }
+	const Eigen::Vector3f& max() const noexcept { return max_; }
+	bool empty() const noexcept { return (min_.array() > max_.array()).any(); }
+	bool bounded() const noexcept { return min_.allFinite() && max_.allFinite(); }
+
+	Bounds& extend(const Eigen::Vector3f& p) noexcept { min_ = min_.cwiseMin(p); max_ = max_.cwiseMax(p); return *this; }
+	Bounds& extend(const Bounds& b) noexcept { min_ = min_.cwiseMin(b.min()); max_ = max_.cwiseMax(b.max()); return *this; }
+
+	//What both bounds have in common (empty if they do not overlap)
+	Bounds intersection(const Bounds& b) const noexcept { return Bounds(min_.cwiseMax(b.min()), max_.cwiseMin(b.max())); }
+	Eigen::Vector3f center() const noexcept { return 0.5f*(min_ + max_); }
+
+	//Zero for empty bounds (acceleration structures, see the surface area heuristic in Bvh)
+	float surface_area() const noexcept {
+		if (empty()) return 0.0f;
+		Eigen::Vector3f d = max_ - min_;
+		return 2.0f*(d[0]*d[1] + d[1]*d[2] + d[2]*d[0]);
+	}
+	float volume() const noexcept { return empty() ? 0.0f : (max_ - min_).prod(); }
+
+	//Corner i has the maximum coordinate on the axes whose bit is set
+	Eigen::Vector3f corner(int i) const noexcept {
+		return Eigen::Vector3f((i&1)?max_[0]:min_[0], (i&2)?max_[1]:min_[1], (i&4)?max_[2]:min_[2]);
+	}
+};
+
+};
@@ -1,36 +1,136 @@
 #pragma once
 
 #include "../object.h"
+#include <type_traits>
+#include <cmath>
 
 namespace tracer {
 
-class Instance : public ObjectImpl<Instance> {
-	Eigen::Affine3f transform;
-	Eigen::Affine3f inverse;
-	Object object;
+/**
+ * An object O placed in the scene through an affine transform. O is held by value or, if O is a 
+ * reference type, as a non-owning reference (see instance_ref). Instance<> (Instance<Object>) 
+ * holds any polymorphic object.
+ *
+ * The ray is transformed into the local space of the child (and extended to its RayType) and 
+ * traversal stays in the child's HitType: the hit is only converted to world space once, at the
+ * end, with a precomputed normal matrix.
+ **/
+template<typename O = Object>
+class Instance : public ObjectImpl<Instance<O>> {
+	using Child = std::decay_t<O>;
+	using ChildRay = typename object_traits<Child>::RayType;
+	using ChildHit = typename object_traits<Child>::HitType;
+
+	Eigen::Affine3f transform_;
+	Eigen::Affine3f inverse_;
+	Eigen::Matrix3f normal_matrix_; //inverse.linear().transpose()
+	bool rigid_; //The normal matrix preserves lengths, so there is no need to renormalize
+	float scale_; //Average scale from world to local space, for ray cones
+	O object_;
+
+	Ray local(const Ray& r) const noexcept {
+		return Ray(inverse_*r.origin(),inverse_.linear()*r.direction(),r.range_min(),r.range_max())
+			.set_cone(scale_*r.cone_width(), scale_*r.cone_spread());
+	}
+
+	//From the local space of the child to world space
+	Hit world(const Hit& lh) const noexcept {
+		//Normals go through the normal matrix, tangents (surface vectors) through the transform itself
+		Eigen::Vector3f normal = normal_matrix_*lh.normal(), tangent = transform_.linear()*lh.tangent();
+		if (!rigid_) { normal.normalize(); tangent = (tangent - normal.dot(tangent)*normal).normalized(); }
+		Hit sol(lh.distance(), transform_*lh.point(), normal, tangent);
+		sol.set_primitive(lh.primitive()).set_footprint((scale_ > 0.0f) ? lh.footprint()/scale_ : lh.footprint());
+		#ifdef MATERIAL
+		sol.set_material(lh.material()).set_material(object_.material());
+		#endif
+		return sol;
+	}
+
+	//The ray changes with the transform, so it is prepared again for the child
+	static ChildRay extend_local(const Ray& r) noexcept {
+		if constexpr (object_traits<Child>::has_ray_type)
+			return Child::extend_ray(r);
+		else
+			return PreparedRay(r);
+	}
 	
 public:
-	std::optional<Hit> trace_general(const Ray& r) const noexcept {
-		auto h = object.trace(Ray(inverse*r.origin(),inverse.linear()*r.direction(),r.range_min(),r.range_max()));
-		if (h) {
-			return Hit(h->distance(),transform * h->point(), 
-				(inverse.linear().transpose()*h->normal()).normalized(), 
-				(inverse.linear().transpose()*h->tangent()).normalized())
-				#ifdef MATERIAL
-				.set_material(this->material())
-				#endif
-			;
-		}
-		return h;
+	//O should be convertible to the child type (if it is Object, anything is)
+	template<typename T, typename OO>
+	Instance(T&& t, OO&& o) :
+		transform_(std::forward<T>(t)), inverse_(transform_.inverse()), 
+		normal_matrix_(inverse_.linear().transpose()),
+		rigid_((normal_matrix_.transpose()*normal_matrix_ - Eigen::Matrix3f::Identity()).norm() < 1.e-5f),
+		scale_(std::cbrt(std::abs(inverse_.linear().determinant()))),
+		object_(std::forward<OO>(o)) {}
+
+	const Eigen::Affine3f& transform() const noexcept { return transform_; }
+	const Eigen::Affine3f& inverse() const noexcept { return inverse_; }
+	const Child& object() const noexcept { return object_; }
+
+	std::optional<ChildHit> trace_general(const Ray& r) const noexcept {
+		TRACER_COUNT(nodes,1);
+		return object_.trace_general(extend_local(local(r)));
 	}
-	bool trace_shadow(const Ray& r) const noexcept override { 
-		return object.trace_shadow(Ray(inverse*r.origin(),inverse.linear()*r.direction(),r.range_min(),r.range_max()));
+
+	Hit hit(const Ray& r, const ChildHit& h) const noexcept {
+		if constexpr (object_traits<Child>::has_hit_type) return world(object_.hit(extend_local(local(r)),h));
+		else return world(h);
+	}
+
+	//Children that only produce full hits (Object) keep their own compact hits, in local space
+	std::optional<CompactHit> trace_compact(const PreparedRay& r) const noexcept override {
+		if constexpr (std::is_same_v<ChildHit,Hit>) {
+			TRACER_COUNT(nodes,1);
+			return object_.trace_compact(PreparedRay(local(r)));
+		} else return ObjectImpl<Instance<O>>::trace_compact(r);
+	}
+	std::optional<Hit> rebuild(const PreparedRay& r, const CompactHit& c) const noexcept override {
+		if constexpr (std::is_same_v<ChildHit,Hit>) {
+			std::optional<Hit> lh = object_.rebuild(PreparedRay(local(r)),c);
+			if (!lh) return std::nullopt;
+			Hit sol = world(*lh);
+			#ifdef MATERIAL
+			sol.set_material(this->material());
+			#endif
+			return sol;
+		} else return ObjectImpl<Instance<O>>::rebuild(r,c);
+	}
+
+	using ObjectImpl<Instance<O>>::trace_shadow;
+	bool trace_shadow(const PreparedRay& r) const noexcept override { 
+		return object_.Child::trace_shadow(PreparedRay(local(r)));
+	}
+
+	Bounds bounds() const noexcept override {
+		Bounds local = object_.bounds(), sol;
+		if (!local.bounded() || local.empty()) return local;
+		for (int i = 0; i<8; ++i) sol.extend(transform_*local.corner(i));
+		return sol;
+	}
+
+	std::size_t geometry_hash() const noexcept override { return hash_combine(hash(10, transform_.matrix()), object_.geometry_hash()); }
+
+	//A child held by value is a duplicate if the same geometry was counted before: it could be referenced instead
+	void add_memory_usage(MemoryUsage& usage) const override {
+		if constexpr (std::is_reference_v<O>) {
+			usage.add(MemoryUsage::nodes, sizeof(*this));
+			if (usage.first(&object_)) object_.memory_usage(usage);
+		} else {
+			usage.add(MemoryUsage::nodes, sizeof(*this) - sizeof(O));
+			if constexpr (std::is_same_v<Child,Object>) object_.memory_usage(usage); //Shared, not copied
+			else usage.copy(object_);
+		}
 	}
-	
-	//O should be convertible to Object
-	template<typename T, typename O>
-	Instance(T&& t, O&& o) :
-		transform(std::forward<T>(t)), inverse(t.inverse()), object(std::forward<O>(o)) {}
 };
 
+template<typename T, typename O>
+Instance(T&& t, O&& o) -> Instance<std::decay_t<O>>;
+
+//The instance does not own the object, which should outlive it
+template<typename T, typename O>
+Instance<const O&> instance_ref(T&& t, const O& o) {
+	return Instance<const O&>(std::forward<T>(t), o);
+}
+
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "../object.h"
+#include "../prepared-ray.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+
+namespace tracer {
+
+/**
+ * Level of detail: the same geometry at several resolutions, from the exact one (level 0) to the
+ * coarsest, each with a bound of its geometric error (the distance it may be off the exact one).
+ * Each ray takes the coarsest level whose error is below its footprint (Ray::footprint, scaled by
+ * tolerance) where it enters the bounds of the object, so distant objects are traced at a
+ * resolution that matches the pixels they cover. Rays without a cone always take the exact one.
+ *
+ * Coarser levels are not on the exact surface, so a ray that leaves a coarse hit without a cone
+ * would take the exact level and hit it right away (self-intersection, shadow acne). Hits keep the
+ * footprint their level was picked with (Hit::footprint) and rays spawned with Hit::spawn carry it
+ * as their cone, so they pick the same level.
+ *
+ * Levels are shared between copies (e.g. instances of the same mesh). Which ones are actually used
+ * is recorded, so trim() can release the finer levels that no ray needed, for every copy at once.
+ * The exact level is always kept, for rays without a cone.
+ **/
+template<typename O>
+class Lod : public ObjectImpl<Lod<O>> {
+	using ChildRay = typename object_traits<O>::RayType;
+	using ChildHit = typename object_traits<O>::HitType;
+
+	struct Level {
+		std::shared_ptr<const O> object; //Null once released by trim()
+		float error;
+	};
+	struct Shared {
+		std::vector<Level> levels;
+		std::atomic<int> finest_used;
+	};
+	std::shared_ptr<Shared> shared_;
+	Bounds bounds_;
+	float tolerance_;
+
+	static ChildRay extend_child(const Ray& r) noexcept {
+		if constexpr (object_traits<O>::has_ray_type) return O::extend_ray(r);
+		else return PreparedRay(r);
+	}
+
+	//Entry distance into the bounds (slab test), negative if the ray misses them
+	float entry(const PreparedRay& r) const noexcept {
+		float tmin = r.range_min(), tmax = r.range_max();
+		for (int k = 0; k<3; ++k) {
+			float t1 = ((r.sign()[k] ? bounds_.max() : bounds_.min())[k] - r.origin()[k])*r.inv_direction()[k];
+			float t2 = ((r.sign()[k] ? bounds_.min() : bounds_.max())[k] - r.origin()[k])*r.inv_direction()[k];
+			if (t1 > tmin) tmin = t1;
+			if (t2 < tmax) tmax = t2;
+		}
+		return (tmin <= tmax) ? tmin : -1.0f;
+	}
+
+public:
+	/**
+	 * levels: (object, error) from the exact one (error 0) to the coarsest, with increasing errors.
+	 * tolerance: the error allowed, as a fraction of the footprint of the ray.
+	 **/
+	Lod(std::vector<std::pair<O,float>>&& levels, float tolerance = 1.0f) :
+		shared_(std::make_shared<Shared>()), tolerance_(tolerance) {
+		assert(!levels.empty());
+		for (auto& l : levels) shared_->levels.push_back(Level{std::make_shared<const O>(std::move(l.first)), l.second});
+		shared_->finest_used = int(levels.size());
+		//Coarser levels may stick out of the exact one
+		for (const Level& l : shared_->levels) bounds_.extend(l.object->bounds());
+	}
+
+	int levels() const noexcept { return int(shared_->levels.size()); }
+	float error(int level) const noexcept { return shared_->levels[level].error; }
+	bool resident(int level) const noexcept { return bool(shared_->levels[level].object); }
+	const O& level(int l) const noexcept { return *shared_->levels[l].object; }
+	//The finest level picked by any ray so far (levels() if none)
+	int finest_used() const noexcept { return shared_->finest_used.load(std::memory_order_relaxed); }
+
+	//The level a ray takes where it enters the object at a distance: the coarsest one within its footprint
+	int select(const Ray& r, float distance) const noexcept {
+		float allowed = tolerance_*r.footprint(std::max(distance, 0.0f));
+		int sol = 0;
+		for (int l = 1; l<levels(); ++l) if (error(l) <= allowed) sol = l;
+		//If that one was released, the closest one that was not
+		while ((sol < levels() - 1) && !resident(sol)) ++sol;
+		while ((sol > 0) && !resident(sol)) --sol;
+		return sol;
+	}
+
+	//Releases every level finer than the finest one used so far but the exact one (not while tracing).
+	//Returns the number of levels released.
+	int trim() const noexcept {
+		int sol = 0;
+		for (int l = 1; (l < finest_used()) && (l < levels() - 1); ++l)
+			if (resident(l)) { shared_->levels[l].object.reset(); ++sol; }
+		return sol;
+	}
+
+	std::optional<std::tuple<ChildHit,const O*>> trace_general(const PreparedRay& r) const noexcept {
+		TRACER_COUNT(nodes,1);
+		float t = entry(r);
+		if (t < 0.0f) return std::nullopt;
+		int l = select(r, t);
+		//Relaxed atomic min: only written when a finer level than before is picked, which is rare
+		int finest = finest_used();
+		while ((l < finest) && !shared_->finest_used.compare_exchange_weak(finest, l, std::memory_order_relaxed)) { }
+		const O* object = shared_->levels[l].object.get();
+		auto h = object->trace_general(extend_child(r));
+		if (h) return std::tuple<ChildHit,const O*>(*h, object);
+		else return std::nullopt;
+	}
+
+	//With the footprint its level was picked with (the ray enters the bounds at the same distance)
+	Hit hit(const PreparedRay& r, const std::tuple<ChildHit,const O*>& h) const {
+		Hit sol = [&] () {
+			if constexpr (object_traits<O>::has_hit_type) return std::get<1>(h)->hit(extend_child(r), std::get<0>(h));
+			else return std::get<0>(h);
+		}();
+		return sol.set_footprint(r.footprint(std::max(entry(r), 0.0f)));
+	}
+
+	Bounds bounds() const noexcept override { return bounds_; }
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash(hash_combine(12, shared_->levels.size()), tolerance_);
+		for (const Level& l : shared_->levels) sol = hash(hash_combine(sol, l.object ? l.object->geometry_hash() : 0), l.error);
+		return sol;
+	}
+
+	//The levels are counted once for every copy, and only while they are resident
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(Lod<O>));
+		if (!usage.first(shared_.get())) return;
+		usage.shared(shared_.get());
+		usage.add(MemoryUsage::nodes, sizeof(Shared));
+		usage.data(shared_->levels, MemoryUsage::nodes);
+		for (const Level& l : shared_->levels) if (l.object) { usage.shared(l.object.get()); l.object->memory_usage(usage); }
+	}
+};
+
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "bounds.h"
+#include "primitives/plane.h"
+#include <array>
+
+namespace tracer {
+
+/**
+ * A convex region bounded by planes whose normals point inwards (typically the 4 side planes of
+ * the rays of a tile, see Pinhole::frustum).
+ **/
+class Frustum {
+	std::array<Plane,4> planes_;
+public:
+	Frustum(const std::array<Plane,4>& planes) noexcept : planes_(planes) { }
+
+	const std::array<Plane,4>& planes() const noexcept { return planes_; }
+
+	bool contains(const Eigen::Vector3f& p) const noexcept {
+		for (const Plane& plane : planes()) if (plane.implicit_function(p) < 0.0f) return false;
+		return true;
+	}
+
+	/**
+	 * Conservative: true only if the bounds are completely behind one of the planes (the corner 
+	 * that is furthest along its normal is behind it). Unbounded objects are never culled.
+	 **/
+	bool culls(const Bounds& b) const noexcept {
+		if (!b.bounded()) return false;
+		for (const Plane& plane : planes()) {
+			Eigen::Vector3f p = (plane.normal().array() >= 0.0f).select(b.max(), b.min());
+			if (plane.implicit_function(p) < 0.0f) return true;
+		}
+		return false;
+	}
+};
+
+};
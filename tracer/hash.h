@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <cstddef>
+#include <cstdint>
+
+namespace tracer {
+
+/**
+ * Hashing of geometry (see ObjectBase::geometry_hash). It is meant to tell whether a scene has
+ * changed between two renders, not to be cryptographically strong.
+ **/
+inline std::size_t hash_combine(std::size_t seed, std::size_t value) noexcept {
+	return seed ^ (value + std::size_t(0x9e3779b97f4a7c15ull) + (seed<<6) + (seed>>2));
+}
+
+//FNV-1a
+inline std::size_t hash_bytes(std::size_t seed, const void* data, std::size_t bytes) noexcept {
+	std::uint64_t h = 0xcbf29ce484222325ull ^ std::uint64_t(seed);
+	const unsigned char* p = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i<bytes; ++i) { h ^= p[i]; h *= 0x100000001b3ull; }
+	return std::size_t(h);
+}
+
+template<typename Derived>
+std::size_t hash(std::size_t seed, const Eigen::DenseBase<Derived>& m) noexcept {
+	typename Derived::PlainObject p = m;
+	return hash_bytes(seed, p.data(), sizeof(typename Derived::Scalar)*std::size_t(p.size()));
+}
+
+inline std::size_t hash(std::size_t seed, float f) noexcept { return hash_bytes(seed, &f, sizeof(f)); }
+
+};
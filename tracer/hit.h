@@ -2,12 +2,17 @@
 
 #include <Eigen/Dense>
 #include <memory>
+#include <cstdint>
+#include <limits>
+#include "ray.h"
 
 namespace tracer {
 class Hit {
 	float distance_;
 	Eigen::Vector3f point_;
 	Eigen::Matrix3f local_to_global_;
+	std::int32_t primitive_ = -1;
+	float footprint_ = 0.0f;
 //	const Plane& object_;
 public:
 	Hit(float distance, const Eigen::Vector3f& point, const Eigen::Vector3f& normal, const Eigen::Vector3f& tangent) noexcept :
@@ -32,6 +37,22 @@ public:
 	auto tangent() const noexcept { return local_to_global().col(0); }
 	auto bitangent() const noexcept { return local_to_global().col(1); }	
 	auto normal() const noexcept { return local_to_global().col(2); }
+
+	//Index of the primitive that was hit in the object that holds it (lane of a pack, triangle of a
+	//mesh, object of a list...), -1 while none of them has set it
+	std::int32_t primitive() const noexcept { return primitive_; }
+	Hit& set_primitive(std::int32_t p) noexcept { primitive_ = p; return (*this); }
+
+	//Footprint of the ray that picked the level of detail of the surface that was hit (see Lod), 0 for
+	//exact geometry. Rays spawned from the hit keep it, so they see that surface and not a finer one
+	//of the same object behind it
+	float footprint() const noexcept { return footprint_; }
+	Hit& set_footprint(float f) noexcept { footprint_ = f; return (*this); }
+
+	//A ray leaving the hit (shadow, reflection...), with the footprint of the hit as its cone
+	Ray spawn(const Eigen::Vector3f& direction, float range_min, float range_max = std::numeric_limits<float>::infinity()) const noexcept {
+		return Ray(point(), direction, range_min, range_max).set_cone(footprint_, 0.0f);
+	}
 //	constexpr const Plane& object() const noexcept { return object_; }
 
 
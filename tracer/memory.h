@@ -0,0 +1,125 @@
+#pragma once
+
+#include "arena.h"
+#include <array>
+#include <vector>
+#include <unordered_set>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <iomanip>
+#include <cstddef>
+
+namespace tracer {
+
+/**
+ * Bytes held by a scene (or by any object), by category:
+ *   - geometry:   primitives stored as objects (a Sphere, a Triangle...) and compressed meshes
+ *   - packs:      SoA data of packs, padding lanes included, and the terms of FixedOrigin
+ *   - duplicated: copies of something whose geometry was already counted (same geometry_hash,
+ *                 different storage), that could be shared or instanced by reference instead
+ *   - materials
+ *   - nodes:      everything above the geometry: lists, polymorphic objects, instances, levels...
+ *   - overhead:   unused capacity of vectors, control blocks of shared pointers, headers of heap
+ *                 allocations (estimated) and space reserved by arenas but not used
+ *
+ * Objects add what they hold, themselves included (see ObjectBase::memory_usage), so that a
+ * container of values only adds its own storage. Data shared between objects (through shared
+ * pointers, references or arenas) is counted once, the first time it is reached.
+ **/
+class MemoryUsage {
+public:
+	enum Category { geometry, packs, duplicated, materials, nodes, overhead, categories };
+	static constexpr const char* names[categories] = { "geometry", "packs", "duplicated", "materials", "nodes", "overhead" };
+
+	//Estimates for the C++ runtime: a header per heap allocation and a make_shared control block
+	static constexpr std::size_t heap_header = 16;
+	static constexpr std::size_t control_block = 16;
+
+private:
+	std::array<std::size_t,categories> bytes_{};
+	std::unordered_set<const void*> seen_;
+	std::unordered_set<std::size_t> geometries_;
+	std::vector<const Arena*> arenas_;
+	int duplicating_ = 0;
+
+	bool in_arena(const void* p) const noexcept {
+		for (const Arena* a : arenas_) if (a->owns(p)) return true;
+		return false;
+	}
+
+public:
+	std::size_t operator[](Category c) const noexcept { return bytes_[c]; }
+	std::size_t total() const noexcept {
+		std::size_t sol = 0;
+		for (std::size_t b : bytes_) sol += b;
+		return sol;
+	}
+
+	//Below a duplicate everything but materials counts as duplicated
+	void add(Category c, std::size_t bytes) noexcept { bytes_[((duplicating_ > 0) && (c != materials)) ? duplicated : c] += bytes; }
+
+	//True the first time shared data is reached: it should be counted then, and only then
+	bool first(const void* p) { return seen_.insert(p).second; }
+
+	//A heap allocation (that may come from an arena seen before, which has no header)
+	void allocation(const void* p) { if (!in_arena(p)) add(overhead, heap_header); }
+
+	//A block made by make_shared, without the object it holds. Arena::make_shared keeps its allocator in it
+	void shared(const void* p) {
+		if (in_arena(p)) add(overhead, control_block + sizeof(std::pmr::polymorphic_allocator<std::byte>));
+		else add(overhead, control_block + heap_header);
+	}
+
+	//The storage of a vector whose elements are counted by the caller: its unused capacity and its header
+	template<typename T>
+	void storage(const std::vector<T>& v) {
+		if (v.capacity() == 0) return;
+		add(overhead, (v.capacity() - v.size())*sizeof(T));
+		allocation(v.data());
+	}
+
+	//A vector of plain data: its elements in a category and its storage
+	template<typename T>
+	void data(const std::vector<T>& v, Category c) { add(c, v.size()*sizeof(T)); storage(v); }
+
+	//An arena: what it reserved but did not use. Allocations found in it have no heap header. False if already counted
+	bool arena(const Arena& a) {
+		if (!first(&a)) return false;
+		arenas_.push_back(&a);
+		add(nodes, sizeof(Arena));
+		add(overhead, a.reserved() - a.used());
+		return true;
+	}
+
+	//An object held by value, as a duplicate if the same geometry was already counted elsewhere
+	template<typename O>
+	void copy(const O& object) {
+		bool duplicate = !geometries_.insert(object.geometry_hash()).second;
+		if (duplicate) ++duplicating_;
+		object.memory_usage(*this);
+		if (duplicate) --duplicating_;
+	}
+};
+
+//E.g. "1.5 MiB"
+inline std::string human_bytes(std::size_t bytes) {
+	const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+	double b = double(bytes); int u = 0;
+	while ((b >= 1024.0) && (u < 4)) { b /= 1024.0; ++u; }
+	std::ostringstream s; s<<std::fixed<<std::setprecision((u == 0) ? 0 : 1)<<b<<" "<<units[u];
+	return s.str();
+}
+
+//A table with the bytes of every category and their share of the total
+inline std::ostream& operator<<(std::ostream& os, const MemoryUsage& usage) {
+	std::size_t total = usage.total();
+	for (int c = 0; c<MemoryUsage::categories; ++c) {
+		std::size_t b = usage[MemoryUsage::Category(c)];
+		os<<std::setw(12)<<MemoryUsage::names[c]<<std::setw(12)<<human_bytes(b)<<std::fixed<<std::setprecision(1)
+		  <<std::setw(8)<<((total > 0) ? 100.0*double(b)/double(total) : 0.0)<<"%"<<std::defaultfloat<<"\n";
+	}
+	return os<<std::setw(12)<<"total"<<std::setw(12)<<human_bytes(total)<<"\n";
+}
+
+}
@@ -2,11 +2,33 @@
 
 #include <optional>
 #include "ray.h"
+#include "prepared-ray.h"
 #include "hit.h"
+#include "bounds.h"
+#include "hash.h"
+#include "stats.h"
+#include "memory.h"
 #include <memory>
+#include <tuple>
+#include <new>
+#include <type_traits>
 
 namespace tracer {
 
+/**
+ * A hit of an object kept in a few bytes, to be turned into a full Hit later with the same ray
+ * (see ObjectBase::trace_compact and rebuild): the HitType of the object itself when it fits in
+ * data (distance, barycentrics and lane of a pack...), only the distance otherwise.
+ **/
+struct CompactHit {
+	float distance;
+	alignas(8) unsigned char data[32];
+};
+
+template<typename H>
+constexpr bool fits_compact_hit = (sizeof(H) <= sizeof(CompactHit::data)) && (alignof(H) <= 8) &&
+	std::is_trivially_copy_constructible_v<H> && std::is_trivially_destructible_v<H>;
+
 class ObjectBase {
 #ifdef MATERIAL
 protected:
@@ -16,37 +38,92 @@ public:
 #endif
 
 public:
-	virtual std::optional<Hit> trace(const Ray& r) const noexcept = 0;
-	virtual bool trace_shadow(const Ray& r) const { return bool(trace(r)); }
+	//Entry points: the ray is prepared once here and shared by the whole traversal below
+	std::optional<Hit> trace(const Ray& r) const noexcept { return trace(PreparedRay(r)); }
+	bool trace_shadow(const Ray& r) const noexcept { return trace_shadow(PreparedRay(r)); }
+
+	virtual std::optional<Hit> trace(const PreparedRay& r) const noexcept = 0;
+	virtual bool trace_shadow(const PreparedRay& r) const noexcept { return bool(trace(r)); }
+
+	//By default, the compact hit is only the distance and rebuilding it traces the object again up to it
+	virtual std::optional<CompactHit> trace_compact(const PreparedRay& r) const noexcept {
+		std::optional<Hit> h = trace(r);
+		if (!h) return std::nullopt;
+		CompactHit sol; sol.distance = h->distance();
+		return sol;
+	}
+	virtual std::optional<Hit> rebuild(const PreparedRay& r, const CompactHit& h) const noexcept {
+		PreparedRay s = r;
+		s.set_range_max(h.distance); //The same ray finds the same hit, nothing beyond it
+		return trace(s);
+	}
+
+	//Conservative: unbounded unless the object knows better
+	virtual Bounds bounds() const noexcept { return Bounds::unbounded(); }
+
+	//Changes whenever the geometry (not the materials) changes. By default, the identity of the object
+	virtual std::size_t geometry_hash() const noexcept { return std::size_t(reinterpret_cast<std::uintptr_t>(this)); }
+
+	//Adds the memory held by the object, itself included, to usage (see memory.h)
+	void memory_usage(MemoryUsage& usage) const {
+#ifdef MATERIAL
+		if (mat && usage.first(mat.get())) { usage.add(MemoryUsage::materials, sizeof(MATERIAL)); usage.shared(mat.get()); }
+#endif
+		add_memory_usage(usage);
+	}
+	//Everything but the material. By default, only the object itself (see ObjectImpl)
+	virtual void add_memory_usage(MemoryUsage& usage) const { usage.add(MemoryUsage::nodes, sizeof(ObjectBase)); }
 };
 
+//The memory held by an object and everything below it
+inline MemoryUsage memory_usage(const ObjectBase& object) {
+	MemoryUsage sol;
+	object.memory_usage(sol);
+	return sol;
+}
+
 template<typename O>
 struct object_traits {
     template<typename U>
     static constexpr auto test_extend_ray(U*)
       -> decltype(U::extend_ray(std::declval<Ray>()));
     template<typename>
-    static constexpr auto test_extend_ray(...) -> Ray;
+    static constexpr auto test_extend_ray(...) -> PreparedRay;
 
+    //Objects only need extend_ray for their own ray types, by default they get a PreparedRay
     using RayType = std::decay_t<decltype(test_extend_ray<O>(nullptr))>;
-    static constexpr bool has_ray_type = !std::is_same_v<RayType,Ray>;
+    static constexpr bool has_ray_type = !std::is_same_v<RayType,PreparedRay>;
     using HitType = std::decay_t<decltype(std::declval<O>().trace_general(std::declval<RayType>()).value())>;
-    static constexpr bool has_hit_type = !std::is_same_v<HitType,Hit>;
+
+    //Objects that do not directly return a Hit need a hit(RayType,HitType) method to build it
+    template<typename U>
+    static constexpr auto test_hit(U*)
+      -> decltype(std::declval<const U&>().hit(std::declval<RayType>(),std::declval<HitType>()), std::true_type());
+    template<typename>
+    static constexpr auto test_hit(...) -> std::false_type;
+
+    static constexpr bool has_hit_type = decltype(test_hit<O>(nullptr))::value;
 };
 
 constexpr float hit_distance(const Hit& h) noexcept { return h.distance(); }
 constexpr float hit_distance(float h) noexcept { return h; }
+//Compact hits are tuples that start with the distance, or with the hit of a child (lists, packs...)
+template<typename H, typename... Rest>
+constexpr float hit_distance(const std::tuple<H,Rest...>& h) noexcept { return hit_distance(std::get<0>(h)); }
 
 template<typename O>
 class ObjectImpl : public ObjectBase {
 public:
+    using ObjectBase::trace;
+    using ObjectBase::trace_shadow;
+
 #ifdef MATERIAL
     O& set_material(const std::shared_ptr<MATERIAL>& m) { mat = m; return static_cast<O&>(*this); }
     O& set_material(const MATERIAL& m) { return set_material(std::make_shared<MATERIAL>(m)); }
     O& set_material(MATERIAL&& m) { return set_material(std::make_shared<MATERIAL>(std::forward<MATERIAL>(m))); }
 #endif
 
-    std::optional<Hit> trace(const Ray& r) const noexcept override {
+    std::optional<Hit> trace(const PreparedRay& r) const noexcept override {
         if constexpr (object_traits<O>::has_ray_type) {
             auto er = O::extend_ray(r);
             auto h = static_cast<const O*>(this)->trace_general(er);
@@ -83,13 +160,45 @@ public:
         }
    }
    
-   virtual bool trace_shadow(const Ray& r) const noexcept override {
+   bool trace_shadow(const PreparedRay& r) const noexcept override {
        if constexpr (object_traits<O>::has_ray_type) {
            auto er = O::extend_ray(r);
            return bool(static_cast<const O*>(this)->trace_general(er));
         } else 
             return bool(static_cast<const O*>(this)->trace_general(r));
    }
+
+   //Hits that fit are kept as they are, so rebuilding them traces nothing
+   std::optional<CompactHit> trace_compact(const PreparedRay& r) const noexcept override {
+       using HitType = typename object_traits<O>::HitType;
+       if constexpr (object_traits<O>::has_hit_type && fits_compact_hit<HitType>) {
+           std::optional<HitType> h;
+           if constexpr (object_traits<O>::has_ray_type) h = static_cast<const O*>(this)->trace_general(O::extend_ray(r));
+           else h = static_cast<const O*>(this)->trace_general(r);
+           if (!h) return std::nullopt;
+           CompactHit sol; sol.distance = hit_distance(*h);
+           new (sol.data) HitType(*h);
+           return sol;
+       } else return ObjectBase::trace_compact(r);
+   }
+
+   std::optional<Hit> rebuild(const PreparedRay& r, const CompactHit& c) const noexcept override {
+       using HitType = typename object_traits<O>::HitType;
+       if constexpr (object_traits<O>::has_hit_type && fits_compact_hit<HitType>) {
+           const HitType& h = *std::launder(reinterpret_cast<const HitType*>(c.data));
+           Hit sol = [&] () {
+               if constexpr (object_traits<O>::has_ray_type) return static_cast<const O*>(this)->hit(O::extend_ray(r),h);
+               else return static_cast<const O*>(this)->hit(r,h);
+           }();
+           #ifdef MATERIAL
+           sol.set_material(this->material());
+           #endif
+           return sol;
+       } else return ObjectBase::rebuild(r,c);
+   }
+
+   //Objects that hold more than themselves, or that are geometry, say so
+   void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::nodes, sizeof(O)); }
 };
 
 /**
@@ -104,13 +213,15 @@ public:
 	
 	Object(const Object& object) : o(object.o) {}
 	Object(Object&& object) : o(std::move(object.o)) {}
+	Object& operator=(const Object&) = default;
+	Object& operator=(Object&&) = default;
 	
 	Object(std::shared_ptr<ObjectBase>&& object) :
 		o(std::forward<std::shared_ptr<ObjectBase>>(object)) {}
 	Object(const std::shared_ptr<ObjectBase>& object) :
 		o(object){}
 	
-	std::optional<Hit> trace_general(const Ray& r) const noexcept {
+	std::optional<Hit> trace_general(const PreparedRay& r) const noexcept {
 		assert(bool(o)); //o should always point to an object
 		auto h = o->trace(r);
 		#ifdef MATERIAL
@@ -118,11 +229,32 @@ public:
 		#endif
 		return h;
 	}
-	bool trace_shadow(const Ray& r) const noexcept override { 
+	using ObjectImpl<Object>::trace_shadow;
+	bool trace_shadow(const PreparedRay& r) const noexcept override { 
 		bool h = false;
 		if (o) h = o->trace_shadow(r);
 		return h;
 	}
+	//The pointed object keeps its own compact hits
+	std::optional<CompactHit> trace_compact(const PreparedRay& r) const noexcept override {
+		assert(bool(o));
+		return o->trace_compact(r);
+	}
+	std::optional<Hit> rebuild(const PreparedRay& r, const CompactHit& c) const noexcept override {
+		assert(bool(o));
+		auto h = o->rebuild(r,c);
+		#ifdef MATERIAL
+		if (h) h->set_material(this->material());
+		#endif
+		return h;
+	}
+	Bounds bounds() const noexcept override { return o ? o->bounds() : Bounds(); }
+	std::size_t geometry_hash() const noexcept override { return o ? o->geometry_hash() : 0; }
+	//The pointed object is shared between copies: it is counted once
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(Object));
+		if (o && usage.first(o.get())) { usage.shared(o.get()); usage.copy(*o); }
+	}
 };
 
 };
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "list.h"
+#include "../frustum.h"
+#include <vector>
+
+namespace tracer {
+
+/**
+ * A subset of the objects of a List (the ones that survive culling) traced as if it were the
+ * List itself, primitives numbered as in the List. It only points to the objects, so the List
+ * should outlive it.
+ **/
+template<typename O>
+class Candidates : public ObjectImpl<Candidates<O>> {
+	std::vector<const O*> objects_;
+	const O* first_ = nullptr; //Of the List, to number the objects that are a single primitive
+
+	using HitType = typename object_traits<O>::HitType;
+	using RayType = typename object_traits<O>::RayType;
+public:
+	Candidates() noexcept {}
+	Candidates(std::vector<const O*>&& objects, const O* first = nullptr) noexcept : objects_(std::move(objects)), first_(first) { }
+
+	const std::vector<const O*>& objects() const noexcept { return objects_; }
+	std::size_t size() const noexcept { return objects_.size(); }
+
+	static RayType extend_ray(const Ray& r) { return List<O>::extend_ray(r); }
+
+	std::optional<std::tuple<HitType,const O*>> trace_general(const RayType& ray) const noexcept {
+		TRACER_COUNT(nodes,1);
+		RayType r = ray;
+		std::optional<HitType> hit, hitsingle;
+		const O* closest_object = nullptr;
+		for (const O* object : objects()) {
+			if ((hitsingle = object->trace_general(r))) {
+				hit = hitsingle;
+				r.set_range_max(hit_distance(*hit));
+				closest_object = object;
+			}
+		}
+		if (hit) return std::tuple<HitType,const O*>(*hit, closest_object);
+		else return std::optional<std::tuple<HitType,const O*>>();
+	}
+
+	Hit hit(const RayType& ray, const std::tuple<HitType,const O*>& h) const {
+		Hit sol = [&] () {
+			if constexpr (object_traits<O>::has_hit_type)
+				return std::get<1>(h)->hit(ray,std::get<0>(h));
+			else
+				return std::get<0>(h);
+		}();
+		if (first_ && (sol.primitive() < 0)) sol.set_primitive(std::int32_t(std::get<1>(h) - first_));
+		return sol;
+	}
+
+	using ObjectImpl<Candidates<O>>::trace_shadow;
+	bool trace_shadow(const PreparedRay& ray) const noexcept override {
+		for (const O* object : objects()) if (object->trace_shadow(ray)) return true;
+		return false;
+	}
+
+	Bounds bounds() const noexcept override {
+		Bounds sol;
+		for (const O* object : objects()) sol.extend(object->bounds());
+		return sol;
+	}
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash_combine(5, objects().size());
+		for (const O* object : objects()) sol = hash_combine(sol, object->geometry_hash());
+		return sol;
+	}
+
+	//Only the pointers: the objects belong to the list
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(*this));
+		usage.data(objects_, MemoryUsage::nodes);
+	}
+};
+
+/**
+ * The objects of the list that may be hit by a ray inside the frustum (typically, the primary
+ * rays of a tile). Culling is per object of the list, it does not go inside them: a Bvh or a
+ * CompressedMesh has its own cull, through its nodes.
+ **/
+template<typename O>
+Candidates<O> cull(const List<O>& list, const Frustum& frustum) {
+	std::vector<const O*> sol;
+	for (const O& object : list.objects()) if (!frustum.culls(object.bounds())) sol.push_back(&object);
+	return Candidates<O>(std::move(sol), list.objects().data());
+}
+
+};
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "../object.h"
+#include "../primitives/triangle.h"
+#include "../frustum.h"
+#include <vector>
+#include <array>
+#include <map>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace tracer {
+
+class ClusterCandidates;
+
+/**
+ * Octahedral encoding of unit vectors in two 16 bit signed integers.
+ **/
+inline std::array<std::int16_t,2> octahedral_encode(const Eigen::Vector3f& n) noexcept {
+	auto sign = [] (float f) { return (f >= 0.0f) ? 1.0f : -1.0f; };
+	float l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	float x = n[0]/l1, y = n[1]/l1;
+	if (n[2] < 0.0f) { float fx = (1.0f - std::abs(y))*sign(x); y = (1.0f - std::abs(x))*sign(y); x = fx; }
+	return std::array<std::int16_t,2>{std::int16_t(std::lround(x*32767.0f)), std::int16_t(std::lround(y*32767.0f))};
+}
+
+inline Eigen::Vector3f octahedral_decode(const std::array<std::int16_t,2>& e) noexcept {
+	auto sign = [] (float f) { return (f >= 0.0f) ? 1.0f : -1.0f; };
+	float x = float(e[0])/32767.0f, y = float(e[1])/32767.0f;
+	float z = 1.0f - std::abs(x) - std::abs(y);
+	if (z < 0.0f) { float fx = (1.0f - std::abs(y))*sign(x); y = (1.0f - std::abs(x))*sign(y); x = fx; }
+	return Eigen::Vector3f(x,y,z).normalized();
+}
+
+//Spreads the lower 10 bits of x so there are two zero bits between each of them
+constexpr std::uint32_t part1by2(std::uint32_t x) noexcept {
+	x &= 0x000003ff;
+	x = (x | (x << 16)) & 0xff0000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+constexpr std::uint32_t morton_encode(std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept { return part1by2(x) | (part1by2(y) << 1) | (part1by2(z) << 2); }
+
+/**
+ * Compressed storage for big triangle meshes. Triangles are sorted in the Morton order of their
+ * centroids (10 bits per axis over the cube that bounds the centroids), so triangles that are close in
+ * space are close in the sequence, and split in clusters (consecutive triangles in that order, up
+ * to 64 triangles and 256 vertices each). Each cluster stores:
+ *   - its vertices once, with octahedral normals and tangents and positions quantized to 16 bits
+ *     per coordinate (14 bytes per vertex)
+ *   - its triangles as three 8 bit indices, relative to the first vertex of the cluster
+ * plus the index of each triangle in the collection it was built from (4 bytes). Smooth meshes share
+ * most vertices (about 19 bytes per triangle instead of 144), flat shaded ones do not (about 49 bytes
+ * per triangle). Triangles are decoded on the fly while tracing. Indices are not delta coded:
+ * 8 bits relative to the cluster are already as small as a fixed size code gets, and a variable
+ * size one would have to be decoded sequentially in the inner loop of trace_cluster.
+ *
+ * Positions are quantized on a single grid for the whole mesh, fine enough for the largest
+ * cluster to span at most 65535 steps, and each cluster keeps the integer grid coordinates of its
+ * first corner. A vertex shared by several clusters lands on the same grid point in all of them, so
+ * it decodes to exactly the same position, and with the watertight triangle test (see
+ * watertight_triangle) no ray slips through the seams between clusters. Cluster bounds are those
+ * of the decoded vertices and are traversed through a small hierarchy (median splits).
+ *
+ * The HitType is (t,u,v,id) where id is the index of the cluster times 64 plus the index of the
+ * triangle within the cluster. Hits report the index of the triangle in the collection the mesh was
+ * built from (see original()) as their primitive.
+ **/
+class CompressedMesh : public ObjectImpl<CompressedMesh> {
+public:
+	static constexpr int max_cluster_triangles = 64;
+	static constexpr int max_cluster_vertices = 256;
+	static constexpr int max_depth = 64; //Of the hierarchy of clusters (median splits stay far below)
+
+	struct Cluster {
+		Eigen::Vector3f lower, upper;      //Bounds of the decoded vertices
+		std::array<std::int32_t,3> offset; //Grid coordinates of the lower corner of the cluster
+		std::uint32_t first_vertex, first_triangle, triangles;
+	};
+
+	//Hierarchy over the clusters, stored depth first as in Bvh
+	struct Node {
+		Bounds bounds;
+		std::uint32_t first = 0; //Leaves: the cluster. Interior nodes: second child (the first one is the next node)
+		bool leaf = false;
+	};
+
+private:
+	Eigen::Vector3f origin_, step_; //Decoded position = origin + step*(offset of the cluster + quantized)
+	std::vector<Cluster> clusters_;
+	std::vector<Node> nodes_;
+	std::vector<std::array<std::uint16_t,3>> positions_;
+	std::vector<std::array<std::int16_t,2>> normals_, tangents_;
+	std::vector<std::array<std::uint8_t,3>> indices_;
+	std::vector<std::uint32_t> original_; //Index of each triangle in the collection it was built from
+
+	struct Vertex {
+		Eigen::Vector3f point, normal, tangent;
+		std::array<float,9> key() const noexcept {
+			return std::array<float,9>{point[0],point[1],point[2],normal[0],normal[1],normal[2],tangent[0],tangent[1],tangent[2]};
+		}
+	};
+
+	struct ClusterVertices {
+		std::vector<Vertex> vertices;
+		std::vector<std::array<std::uint8_t,3>> triangles;
+	};
+
+	std::array<std::int64_t,3> grid(const Eigen::Vector3f& p) const noexcept {
+		std::array<std::int64_t,3> sol;
+		for (int k = 0; k<3; ++k) sol[k] = (step_[k] > 0.0f) ? std::llround(double(p[k] - origin_[k])/double(step_[k])) : 0;
+		return sol;
+	}
+
+	void add_cluster(const ClusterVertices& cluster) {
+		Cluster c;
+		std::vector<std::array<std::int64_t,3>> points;
+		std::array<std::int64_t,3> lower{std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::max(), std::numeric_limits<std::int64_t>::max()};
+		for (const Vertex& v : cluster.vertices) {
+			points.push_back(grid(v.point));
+			for (int k = 0; k<3; ++k) lower[k] = std::min(lower[k], points.back()[k]);
+		}
+		for (int k = 0; k<3; ++k) c.offset[k] = std::int32_t(lower[k]);
+		c.first_vertex = std::uint32_t(positions_.size());
+		c.first_triangle = std::uint32_t(indices_.size());
+		c.triangles = std::uint32_t(cluster.triangles.size());
+		Bounds bounds;
+		for (std::size_t i = 0; i<cluster.vertices.size(); ++i) {
+			std::array<std::uint16_t,3> q;
+			for (int k = 0; k<3; ++k) q[k] = std::uint16_t(std::min<std::int64_t>(65535, points[i][k] - lower[k]));
+			positions_.push_back(q);
+			normals_.push_back(octahedral_encode(cluster.vertices[i].normal));
+			tangents_.push_back(octahedral_encode(cluster.vertices[i].tangent));
+			bounds.extend(decode(c, q));
+		}
+		c.lower = bounds.min(); c.upper = bounds.max();
+		indices_.insert(indices_.end(), cluster.triangles.begin(), cluster.triangles.end());
+		clusters_.push_back(c);
+	}
+
+	//Median split on the longest axis of the centers, one cluster per leaf
+	std::uint32_t build(std::vector<std::uint32_t>& order, std::uint32_t begin, std::uint32_t end) {
+		Node node; Bounds centers;
+		for (std::uint32_t i = begin; i<end; ++i) {
+			Bounds b(clusters_[order[i]].lower, clusters_[order[i]].upper);
+			node.bounds.extend(b); centers.extend(b.center());
+		}
+		std::uint32_t index = std::uint32_t(nodes_.size());
+		if (end - begin == 1) {
+			node.first = order[begin]; node.leaf = true;
+			nodes_.push_back(node);
+			return index;
+		}
+		int axis; (centers.max() - centers.min()).maxCoeff(&axis);
+		std::uint32_t middle = begin + (end - begin)/2;
+		std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end, [&] (std::uint32_t a, std::uint32_t b) {
+			return clusters_[a].lower[axis] + clusters_[a].upper[axis] < clusters_[b].lower[axis] + clusters_[b].upper[axis];
+		});
+		nodes_.push_back(node);
+		build(order, begin, middle);
+		nodes_[index].first = build(order, middle, end);
+		return index;
+	}
+
+	static Eigen::Vector3f decode(const Eigen::Vector3f& origin, const Eigen::Vector3f& step, const Cluster& c, const std::array<std::uint16_t,3>& q) noexcept {
+		//The grid coordinates are added as integers, so shared vertices decode exactly the same
+		return origin + step.cwiseProduct(Eigen::Vector3f(float(c.offset[0] + std::int32_t(q[0])), float(c.offset[1] + std::int32_t(q[1])), float(c.offset[2] + std::int32_t(q[2]))));
+	}
+	Eigen::Vector3f decode(const Cluster& c, const std::array<std::uint16_t,3>& q) const noexcept { return decode(origin_, step_, c, q); }
+
+	std::array<std::uint32_t,3> vertices(const Cluster& c, std::uint32_t triangle) const noexcept {
+		const std::array<std::uint8_t,3>& t = indices_[triangle];
+		return std::array<std::uint32_t,3>{c.first_vertex + t[0], c.first_vertex + t[1], c.first_vertex + t[2]};
+	}
+
+	//Entry distance into the bounds (slab test), infinity if the ray misses them
+	static float entry(const Bounds& b, const PreparedRay& r) noexcept {
+		float tmin = r.range_min(), tmax = r.range_max();
+		for (int k = 0; k<3; ++k) {
+			float t1 = ((r.sign()[k] ? b.max() : b.min())[k] - r.origin()[k])*r.inv_direction()[k];
+			float t2 = ((r.sign()[k] ? b.min() : b.max())[k] - r.origin()[k])*r.inv_direction()[k];
+			if (t1 > tmin) tmin = t1;
+			if (t2 < tmax) tmax = t2;
+		}
+		return (tmin <= tmax) ? tmin : std::numeric_limits<float>::infinity();
+	}
+
+	//Tests every triangle of the cluster, shrinking the range of the ray with each hit
+	void trace_cluster(PreparedRay& r, std::uint32_t cluster, std::optional<std::tuple<float,float,float,int>>& sol) const noexcept {
+		const Cluster& c = clusters_[cluster];
+		TRACER_COUNT(triangles,c.triangles);
+		for (std::uint32_t k = c.first_triangle; k<c.first_triangle + c.triangles; ++k) {
+			std::array<std::uint32_t,3> v = vertices(c, k);
+			auto h = watertight_triangle(r, decode(c, positions_[v[0]]), decode(c, positions_[v[1]]), decode(c, positions_[v[2]]));
+			if (h) {
+				auto [d, u, w] = *h;
+				sol = std::make_tuple(d,u,w,int(cluster*max_cluster_triangles + (k - c.first_triangle)));
+				r.set_range_max(d);
+			}
+		}
+	}
+
+	friend class ClusterCandidates;
+
+public:
+	template<typename Collection>
+	CompressedMesh(const Collection& triangles) {
+		TRACER_PROFILE_SCOPE("build compressed mesh");
+		//Morton order of the centroids, so the triangles of each cluster are spatially close
+		std::vector<const Triangle*> sorted;
+		std::vector<Eigen::Vector3f> centroids;
+		Bounds centroid_bounds;
+		for (const Triangle& t : triangles) {
+			sorted.push_back(&t);
+			centroids.push_back((t.point0() + t.point1() + t.point2())/3.0f);
+			centroid_bounds.extend(centroids.back());
+		}
+		std::vector<std::pair<std::uint32_t,std::uint32_t>> codes(sorted.size()); //(code, index)
+		//The same scale on every axis, so thin meshes are not split along their thinnest side
+		float side = sorted.empty() ? 0.0f : (centroid_bounds.max() - centroid_bounds.min()).maxCoeff();
+		float scale = (side > 0.0f) ? 1023.0f/side : 0.0f;
+		for (std::uint32_t i = 0; i<std::uint32_t(sorted.size()); ++i) {
+			Eigen::Vector3f c = (centroids[i] - centroid_bounds.min())*scale;
+			codes[i] = {morton_encode(std::uint32_t(c[0]), std::uint32_t(c[1]), std::uint32_t(c[2])), i};
+		}
+		std::sort(codes.begin(), codes.end()); //Ties keep the order of the collection
+		original_.reserve(codes.size());
+		for (const auto& code : codes) original_.push_back(code.second);
+
+		std::vector<ClusterVertices> clusters(1);
+		std::map<std::array<float,9>,std::uint8_t> indices;
+		for (std::uint32_t i : original_) {
+			const Triangle& t = *sorted[i];
+			std::array<Vertex,3> v{Vertex{t.point0(), t.normal0(), t.tangent0()}, Vertex{t.point1(), t.normal1(), t.tangent1()}, Vertex{t.point2(), t.normal2(), t.tangent2()}};
+			int missing = 0;
+			for (const Vertex& vertex : v) if (indices.find(vertex.key()) == indices.end()) ++missing;
+			if ((int(clusters.back().triangles.size()) == max_cluster_triangles) || (int(clusters.back().vertices.size()) + missing > max_cluster_vertices)) {
+				clusters.emplace_back();
+				indices.clear();
+			}
+			ClusterVertices& cluster = clusters.back();
+			std::array<std::uint8_t,3> triangle;
+			for (int k = 0; k<3; ++k) {
+				auto found = indices.find(v[k].key());
+				if (found == indices.end()) {
+					found = indices.emplace(v[k].key(), std::uint8_t(cluster.vertices.size())).first;
+					cluster.vertices.push_back(v[k]);
+				}
+				triangle[k] = found->second;
+			}
+			cluster.triangles.push_back(triangle);
+		}
+		if (clusters.back().triangles.empty()) clusters.pop_back();
+
+		//The grid: as fine as the largest cluster allows (65534 steps, so rounding stays within 16 bits)
+		Bounds mesh; Eigen::Vector3f extent = Eigen::Vector3f::Zero();
+		for (const ClusterVertices& cluster : clusters) {
+			Bounds b;
+			for (const Vertex& v : cluster.vertices) b.extend(v.point);
+			mesh.extend(b);
+			extent = extent.cwiseMax(b.max() - b.min());
+		}
+		origin_ = clusters.empty() ? Eigen::Vector3f::Zero() : mesh.min();
+		step_ = extent/65534.0f;
+		for (const ClusterVertices& cluster : clusters) add_cluster(cluster);
+
+		std::vector<std::uint32_t> order(clusters_.size());
+		for (std::uint32_t i = 0; i<std::uint32_t(order.size()); ++i) order[i] = i;
+		nodes_.reserve(2*order.size());
+		if (!order.empty()) build(order, 0, std::uint32_t(order.size()));
+		clusters_.shrink_to_fit(); nodes_.shrink_to_fit(); positions_.shrink_to_fit(); normals_.shrink_to_fit(); tangents_.shrink_to_fit(); indices_.shrink_to_fit(); original_.shrink_to_fit();
+	}
+
+	const std::vector<Cluster>& clusters() const noexcept { return clusters_; }
+	const std::vector<Node>& nodes() const noexcept { return nodes_; }
+	std::size_t size() const noexcept { return indices_.size(); }
+	std::size_t vertex_count() const noexcept { return positions_.size(); }
+	//Index in the collection the mesh was built from of the triangle t (as stored, see triangle())
+	std::uint32_t original(std::uint32_t t) const noexcept { return original_[t]; }
+
+	//Memory held by the mesh
+	std::size_t bytes() const noexcept {
+		return sizeof(*this) + clusters_.capacity()*sizeof(Cluster) + nodes_.capacity()*sizeof(Node) + positions_.capacity()*sizeof(positions_[0]) +
+			normals_.capacity()*sizeof(normals_[0]) + tangents_.capacity()*sizeof(tangents_[0]) +
+			indices_.capacity()*sizeof(indices_[0]) + original_.capacity()*sizeof(original_[0]);
+	}
+
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::geometry, sizeof(CompressedMesh));
+		usage.data(clusters_, MemoryUsage::nodes);
+		usage.data(nodes_, MemoryUsage::nodes);
+		usage.data(positions_, MemoryUsage::geometry);
+		usage.data(normals_, MemoryUsage::geometry);
+		usage.data(tangents_, MemoryUsage::geometry);
+		usage.data(indices_, MemoryUsage::geometry);
+		usage.data(original_, MemoryUsage::geometry);
+	}
+
+	//The decoded triangle t, in the order they are stored (see original())
+	Triangle triangle(std::uint32_t t) const {
+		const Cluster& c = *(std::upper_bound(clusters_.begin(), clusters_.end(), t, [] (std::uint32_t t, const Cluster& c) { return t < c.first_triangle; }) - 1);
+		std::array<std::uint32_t,3> v = vertices(c, t);
+		return Triangle(decode(c, positions_[v[0]]), octahedral_decode(normals_[v[0]]), octahedral_decode(tangents_[v[0]]),
+		                decode(c, positions_[v[1]]), octahedral_decode(normals_[v[1]]), octahedral_decode(tangents_[v[1]]),
+		                decode(c, positions_[v[2]]), octahedral_decode(normals_[v[2]]), octahedral_decode(tangents_[v[2]]));
+	}
+
+	std::optional<std::tuple<float,float,float,int>> trace_general(const PreparedRay& ray) const noexcept {
+		std::optional<std::tuple<float,float,float,int>> sol;
+		if (nodes_.empty()) return sol;
+		PreparedRay r = ray;
+		//Nearest child first, as Bvh. Nodes keep their entry distance and are skipped once something closer is hit
+		std::array<std::pair<std::uint32_t,float>,max_depth> stack;
+		int top = 0;
+		TRACER_COUNT(boxes,1);
+		float t0 = entry(nodes_[0].bounds, r);
+		if (t0 == std::numeric_limits<float>::infinity()) return sol;
+		stack[top++] = {0, t0};
+		while (top > 0) {
+			auto [index, t] = stack[--top];
+			if (t > r.range_max()) continue; //Something closer was found after it was pushed
+			const Node& node = nodes_[index];
+			TRACER_COUNT(nodes,1);
+			if (node.leaf) trace_cluster(r, node.first, sol);
+			else {
+				std::uint32_t first = index + 1, second = node.first;
+				TRACER_COUNT(boxes,2);
+				float t1 = entry(nodes_[first].bounds, r), t2 = entry(nodes_[second].bounds, r);
+				if (t1 > t2) { std::swap(first, second); std::swap(t1, t2); }
+				if (t2 != std::numeric_limits<float>::infinity()) stack[top++] = {second, t2};
+				if (t1 != std::numeric_limits<float>::infinity()) stack[top++] = {first, t1};
+			}
+		}
+		return sol;
+	}
+
+	Hit hit(const Ray& ray, const std::tuple<float,float,float,int>& h) const noexcept {
+		auto [t, u, v, id] = h;
+		const Cluster& c = clusters_[id/max_cluster_triangles];
+		const std::uint32_t triangle = c.first_triangle + std::uint32_t(id%max_cluster_triangles);
+		std::array<std::uint32_t,3> i = vertices(c, triangle);
+		float w = 1.0f - u - v;
+		Eigen::Vector3f normal = (w*octahedral_decode(normals_[i[0]]) + u*octahedral_decode(normals_[i[1]]) + v*octahedral_decode(normals_[i[2]])).normalized();
+		Eigen::Vector3f tangent = w*octahedral_decode(tangents_[i[0]]) + u*octahedral_decode(tangents_[i[1]]) + v*octahedral_decode(tangents_[i[2]]);
+		//Quantization breaks the orthogonality between normals and tangents slightly
+		tangent -= normal*normal.dot(tangent);
+		if (tangent.squaredNorm() < 1.e-12f) return Hit(t, ray.at(t), normal).set_primitive(std::int32_t(original(triangle)));
+		return Hit(t, ray.at(t), normal, tangent.normalized()).set_primitive(std::int32_t(original(triangle)));
+	}
+
+	Bounds bounds() const noexcept override {
+		return nodes_.empty() ? Bounds() : nodes_[0].bounds;
+	}
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash(hash(hash_combine(12, size()), origin_), step_);
+		sol = hash_bytes(sol, positions_.data(), positions_.size()*sizeof(positions_[0]));
+		sol = hash_bytes(sol, normals_.data(), normals_.size()*sizeof(normals_[0]));
+		sol = hash_bytes(sol, tangents_.data(), tangents_.size()*sizeof(tangents_[0]));
+		sol = hash_bytes(sol, indices_.data(), indices_.size()*sizeof(indices_[0]));
+		for (const Cluster& c : clusters_) sol = hash_bytes(sol, c.offset.data(), sizeof(c.offset));
+		return sol;
+	}
+};
+
+/**
+ * A subset of the clusters of a CompressedMesh (the ones that survive culling) traced as if it were
+ * the mesh itself, as Candidates does for the objects of a List. Each cluster is tested against its
+ * bounds before its triangles are decoded. It only points to the mesh, which should outlive it.
+ **/
+class ClusterCandidates : public ObjectImpl<ClusterCandidates> {
+	const CompressedMesh* mesh_;
+	std::vector<std::uint32_t> clusters_;
+public:
+	ClusterCandidates(const CompressedMesh& mesh, std::vector<std::uint32_t>&& clusters) noexcept : mesh_(&mesh), clusters_(std::move(clusters)) { }
+
+	const CompressedMesh& mesh() const noexcept { return *mesh_; }
+	const std::vector<std::uint32_t>& clusters() const noexcept { return clusters_; }
+	std::size_t size() const noexcept { return clusters_.size(); }
+
+	//The hit is the one of the mesh, (t,u,v,id)
+	std::optional<std::tuple<float,float,float,int>> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(boxes,clusters_.size());
+		std::optional<std::tuple<float,float,float,int>> sol;
+		PreparedRay r = ray;
+		for (std::uint32_t cluster : clusters_) {
+			const CompressedMesh::Cluster& c = mesh().clusters()[cluster];
+			if (CompressedMesh::entry(Bounds(c.lower, c.upper), r) != std::numeric_limits<float>::infinity()) mesh().trace_cluster(r, cluster, sol);
+		}
+		return sol;
+	}
+
+	Hit hit(const Ray& ray, const std::tuple<float,float,float,int>& h) const noexcept { return mesh().hit(ray, h); }
+
+	Bounds bounds() const noexcept override {
+		Bounds sol;
+		for (std::uint32_t cluster : clusters_) sol.extend(Bounds(mesh().clusters()[cluster].lower, mesh().clusters()[cluster].upper));
+		return sol;
+	}
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash_combine(14, mesh().geometry_hash());
+		for (std::uint32_t cluster : clusters_) sol = hash_combine(sol, cluster);
+		return sol;
+	}
+
+	//Only the indices: the clusters belong to the mesh
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(*this));
+		usage.data(clusters_, MemoryUsage::nodes);
+	}
+};
+
+/**
+ * The clusters of the mesh that may be hit by a ray inside the frustum, found through the
+ * hierarchy of clusters: subtrees whose bounds are outside the frustum are skipped whole.
+ **/
+inline ClusterCandidates cull(const CompressedMesh& mesh, const Frustum& frustum) {
+	std::vector<std::uint32_t> sol, stack;
+	if (!mesh.nodes().empty()) stack.push_back(0);
+	while (!stack.empty()) {
+		std::uint32_t index = stack.back(); stack.pop_back();
+		const CompressedMesh::Node& node = mesh.nodes()[index];
+		if (frustum.culls(node.bounds)) continue;
+		if (node.leaf) sol.push_back(node.first);
+		else {
+			stack.push_back(node.first);
+			stack.push_back(index + 1);
+		}
+	}
+	return ClusterCandidates(mesh, std::move(sol));
+}
+
+};
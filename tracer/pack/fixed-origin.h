@@ -0,0 +1,155 @@
+#pragma once
+
+#include "list.h"
+#include "pack-plane.h"
+#include "pack-sphere.h"
+#include "pack-triangle.h"
+#include <array>
+#include <cassert>
+#include <vector>
+
+namespace tracer {
+
+/**
+ * A pack seen from a fixed origin: every term of its kernel that only depends on the origin of
+ * the ray (and not on its direction) is computed once, when it is built, instead of once per ray.
+ * It is meant for rays that share their origin: the primary rays of a Pinhole (built once per
+ * frame) and shadow rays towards a point light, traced backwards from the light (see ray_to).
+ *
+ * Only rays starting at that origin may be traced through it. Like Candidates, it points to the
+ * pack it was built from (for the terms that do not depend on the origin and for shading), so the
+ * pack should outlive it.
+ **/
+template<typename O>
+class FixedOrigin;
+
+template<int N>
+class FixedOrigin<Pack<Sphere,N>> : public ObjectImpl<FixedOrigin<Pack<Sphere,N>>> {
+	const Pack<Sphere,N>* pack_;
+	Eigen::Vector3f origin_;
+	Eigen::Matrix<float,N,3> oc_;
+	Eigen::Matrix<float,N,1> c_;
+public:
+	FixedOrigin(const Pack<Sphere,N>& pack, const Eigen::Vector3f& origin) noexcept :
+		pack_(&pack), origin_(origin), oc_(pack.centers().rowwise() - origin.transpose()),
+		c_(oc_.rowwise().squaredNorm() - pack.radiuses2()) {}
+
+	const Pack<Sphere,N>& pack() const noexcept { return *pack_; }
+	const Eigen::Vector3f& origin() const noexcept { return origin_; }
+
+	//Same as Pack<Sphere,N>::trace_general, with oc and c already known
+	std::optional<std::tuple<float,int>> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(spheres,N); TRACER_COUNT(wasted_lanes,N-pack().size());
+		assert((ray.origin() - origin()).squaredNorm() <= 1.e-10f*(1.0f + origin().squaredNorm()));
+		float a = ray.direction().squaredNorm();
+		Eigen::Matrix<float,N,1> b = -2.0f*(oc_*ray.direction());
+		Eigen::Matrix<float,N,1> disc = b.cwiseProduct(b) - 4.0f*a*c_;
+
+		Eigen::Matrix<float,N,1> sqrtdisc = disc.cwiseSqrt();
+		float inv2a = 0.5f/a;
+		Eigen::Matrix<float,N,1> d1 = (-b - sqrtdisc)*inv2a;
+		Eigen::Matrix<float,N,1> d2 = (-b + sqrtdisc)*inv2a;
+
+		Ray r = ray; int n = -1;
+		for (int i = 0; i<pack().size(); ++i) {
+			if (disc[i]>0) {
+				if (r.in_range(d1[i]))      { n = i; r.set_range_max(d1[i]); }
+				else if (r.in_range(d2[i])) { n = i; r.set_range_max(d2[i]); }
+			}
+		}
+		if (n<0) return std::optional<std::tuple<float,int>>();
+		else return std::tuple<float,int>(r.range_max(),n);
+	}
+
+	Hit hit(const Ray& ray, const std::tuple<float,int>& h) const { return pack().hit(ray, h); }
+	Bounds bounds() const noexcept override { return pack().bounds(); }
+	std::size_t geometry_hash() const noexcept override { return pack().geometry_hash(); }
+	//The pack is counted where it is stored, not here
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
+};
+
+template<int N>
+class FixedOrigin<Pack<Plane,N>> : public ObjectImpl<FixedOrigin<Pack<Plane,N>>> {
+	const Pack<Plane,N>* pack_;
+	Eigen::Vector3f origin_;
+	Eigen::Matrix<float,N,1> numerators_; //-(normal·origin + distance)
+public:
+	FixedOrigin(const Pack<Plane,N>& pack, const Eigen::Vector3f& origin) noexcept :
+		pack_(&pack), origin_(origin), numerators_(-(pack.normals()*origin + pack.distances())) {}
+
+	const Pack<Plane,N>& pack() const noexcept { return *pack_; }
+	const Eigen::Vector3f& origin() const noexcept { return origin_; }
+
+	std::optional<std::tuple<float,int>> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(planes,N); TRACER_COUNT(wasted_lanes,N-pack().size());
+		assert((ray.origin() - origin()).squaredNorm() <= 1.e-10f*(1.0f + origin().squaredNorm()));
+		Eigen::Matrix<float,N,1> d = (pack().normals()*ray.direction()).cwiseInverse().cwiseProduct(numerators_);
+		Ray r = ray; int n = -1;
+		for (int i = 0; i<pack().size(); ++i) {
+			if (r.in_range(d[i])) { n = i; r.set_range_max(d[i]); }
+		}
+		if (n < 0) return std::optional<std::tuple<float,int>>();
+		else       return std::tuple<float,int>(d[n],n);
+	}
+
+	Hit hit(const Ray& ray, const std::tuple<float,int>& h) const { return pack().hit(ray, h); }
+	Bounds bounds() const noexcept override { return pack().bounds(); }
+	std::size_t geometry_hash() const noexcept override { return pack().geometry_hash(); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
+};
+
+/**
+ * For triangles, the watertight test (see Pack<Triangle,N>::watertight) starts by moving the
+ * vertices to the origin of the ray: with the origin fixed they are moved once, and each ray only
+ * applies its permutation and shear.
+ **/
+template<int N>
+class FixedOrigin<Pack<Triangle,N>> : public ObjectImpl<FixedOrigin<Pack<Triangle,N>>> {
+	const Pack<Triangle,N>* pack_;
+	Eigen::Vector3f origin_;
+	std::array<Eigen::Array<float,N,3>,3> vertices_; //Relative to the origin
+public:
+	FixedOrigin(const Pack<Triangle,N>& pack, const Eigen::Vector3f& origin) noexcept : pack_(&pack), origin_(origin) {
+		for (int k = 0; k<3; ++k) vertices_[k] = pack.vertices(k).rowwise() - origin.transpose().array();
+	}
+
+	const Pack<Triangle,N>& pack() const noexcept { return *pack_; }
+	const Eigen::Vector3f& origin() const noexcept { return origin_; }
+
+	//The hit is (distance, u, v, lane), as in Pack<Triangle,N>
+	std::optional<std::tuple<float,float,float,int>> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(triangles,N); TRACER_COUNT(wasted_lanes,N-pack().size());
+		assert((ray.origin() - origin()).squaredNorm() <= 1.e-10f*(1.0f + origin().squaredNorm()));
+		return Pack<Triangle,N>::watertight(ray, vertices_[0], vertices_[1], vertices_[2], pack().size());
+	}
+
+	Hit hit(const Ray& ray, const std::tuple<float,float,float,int>& h) const noexcept { return pack().hit(ray, h); }
+	Bounds bounds() const noexcept override { return pack().bounds(); }
+	std::size_t geometry_hash() const noexcept override { return pack().geometry_hash(); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
+};
+
+/**
+ * Every pack of a list seen from the same origin (e.g. once per frame for the camera, once per
+ * point light for its shadow rays). The list should outlive the result.
+ **/
+template<typename O>
+List<FixedOrigin<O>> fixed_origin(const List<O>& list, const Eigen::Vector3f& origin) {
+	std::vector<FixedOrigin<O>> sol;
+	sol.reserve(list.objects().size());
+	for (const O& object : list.objects()) sol.emplace_back(object, origin);
+	return List<FixedOrigin<O>>(std::move(sol));
+}
+
+/**
+ * A ray from a shared origin to a point, that stops epsilon before reaching it (and starts epsilon
+ * after leaving the origin). Shadow rays towards a point light are traced backwards this way, from
+ * the light to the point they leave from, so they all share the light as their origin.
+ **/
+inline Ray ray_to(const Eigen::Vector3f& origin, const Eigen::Vector3f& point, float epsilon = 1.e-4f) noexcept {
+	Eigen::Vector3f d = point - origin;
+	float distance = d.norm();
+	return Ray(origin, d/distance, epsilon, distance - epsilon);
+}
+
+}
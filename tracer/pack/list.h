@@ -7,11 +7,6 @@
 
 namespace tracer {
 	
-template<typename HitType, typename O>
-float hit_distance(const std::tuple<HitType,const O*>& h) {
-	return hit_distance(std::get<0>(h));
-}
-
 //TODO: Deduce HitType and RayType and do this as an "ObjectGeneral<RayType, std::tuple<HitType, int>>" for efficiency purposes.
 template<typename O>
 class List : public ObjectImpl<List<O>> {
@@ -34,6 +29,26 @@ public:
 
 	void add(const O& o) { objects_.push_back(o); }
 	void add(O&& o)      { objects_.push_back(std::forward<O>(o)); }
+	void reserve(std::size_t n) { objects_.reserve(n); }
+
+	Bounds bounds() const noexcept override {
+		Bounds sol;
+		for (const O& object : objects()) sol.extend(object.bounds());
+		return sol;
+	}
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash_combine(5, objects().size());
+		for (const O& object : objects()) sol = hash_combine(sol, object.geometry_hash());
+		return sol;
+	}
+
+	//The objects count themselves, the list only adds their storage
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(List<O>));
+		for (const O& object : objects()) object.memory_usage(usage);
+		usage.storage(objects_);
+	}
 	//TODO: Add hit_distance
 	//TODO: Add hit(RayType,HitType)
 	
@@ -41,11 +56,12 @@ public:
 		if constexpr (object_traits<O>::has_ray_type)
 			return O::extend_ray(r);
 		else
-			return r;
+			return PreparedRay(r);
 	}
 
 	std::optional<std::tuple<HitType,const O*>> 
 		trace_general(const typename object_traits<O>::RayType& ray) const noexcept {
+			TRACER_COUNT(nodes,1);
 			typename object_traits<O>::RayType r = ray;
 			std::optional<typename object_traits<O>::HitType> hit, hitsingle;
 			const O* closest_object = nullptr;
@@ -60,18 +76,26 @@ public:
 			else return std::optional<std::tuple<HitType,const O*>>();
 	}
 	
+	//Objects that are a single primitive are numbered by their index in the list
 	Hit hit(const RayType& ray, const std::tuple<HitType,const O*>& h) const {
-		if constexpr (object_traits<O>::has_hit_type)
-			return std::get<1>(h)->hit(ray,std::get<0>(h));
-		else
-			return std::get<0>(h);	
+		Hit sol = [&] () {
+			if constexpr (object_traits<O>::has_hit_type)
+				return std::get<1>(h)->hit(ray,std::get<0>(h));
+			else
+				return std::get<0>(h);
+		}();
+		if (sol.primitive() < 0) sol.set_primitive(std::int32_t(std::get<1>(h) - objects().data()));
+		return sol;
 	}
 	
 	//TODO: Make more efficient (using RayType)	
-	bool trace_shadow(const Ray& ray) const noexcept override {
+	using ObjectImpl<List<O>>::trace_shadow;
+	bool trace_shadow(const PreparedRay& ray) const noexcept override {
 		for (const O& object : objects()) {
-			if (object.trace_shadow(ray))
+			if (object.trace_shadow(ray)) {
+				TRACER_COUNT(shadow_early_outs,(&object != &objects().back())?1:0);
 				return true;
+			}
 		}
 		return false;
 	}	
@@ -2,7 +2,7 @@
 
 #include "pack.h"
 #include "../primitives/axis-aligned-box.h"
-#include <array>
+#include <cstdint>
 #include <tuple>
 
 namespace tracer {
@@ -11,43 +11,51 @@ template<int N>
 class Pack<AxisAlignedBox,N> : public ObjectImpl<Pack<AxisAlignedBox,N>> {
 	Eigen::Array<float,N,3> mins_;
 	Eigen::Array<float,N,3> maxs_;
-	std::array<AxisAlignedBox,N> boxes_;
+	int size_;
+	std::uint32_t first_;
 
 	//We focus the efficency on the trace method, not in the construction of the structure which obviously is rather slow.
 	template<typename Collection>
 	void setup(const Collection& c) {
 		assert(c.size() <= N);
+		//Lanes past size() are masked out when tracing, zeros just keep them harmless
+		mins_.setZero(); maxs_.setZero();
 		int n = 0;
 		for (const AxisAlignedBox& b : c) {
 			mins_.row(n) = b.min();
 			maxs_.row(n) = b.max();
-			boxes_[n] = b;
 			++n;	
 		}
-		--n;
-		//We copy the last plane to fill the whole pack (should not happen very often...)
-		for (int i = (n+1); i<N; ++i) {
-			mins_.row(i) = mins_.row(n);
-			maxs_.row(i) = maxs_.row(n);
-			boxes_[i] = boxes_[n];
-		}
+		size_ = n;
 	}	
 public:
-	Pack(const std::list<AxisAlignedBox>& c)      { setup(c); }
-	Pack(const std::vector<AxisAlignedBox>& c)    { setup(c); }
+	Pack(const std::list<AxisAlignedBox>& c, std::uint32_t first = 0)      : first_(first) { setup(c); }
+	Pack(const std::vector<AxisAlignedBox>& c, std::uint32_t first = 0)    : first_(first) { setup(c); }
 	
+	int size() const noexcept { return size_; }
+	//Index of the box of a lane in the collection the pack was built from
+	std::uint32_t index(int lane) const noexcept { return first_ + std::uint32_t(lane); }
 	const Eigen::Array<float,N,3>& mins() const noexcept { return mins_; }
 	const Eigen::Array<float,N,3>& maxs() const noexcept { return maxs_; }
-	const std::array<Plane,N>& boxes() const noexcept { return boxes_; }
+	AxisAlignedBox box(int lane) const noexcept { return AxisAlignedBox(mins().row(lane).transpose().matrix(), maxs().row(lane).transpose().matrix()); }
+	std::size_t geometry_hash() const noexcept override { return hash(hash(hash_combine(8, size()), mins()), maxs()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
 
-    static AABoxRay ray_type(const Ray& r) noexcept 
-	{ return AABoxRay(r); }
+	Bounds bounds() const noexcept override {
+		return Bounds(mins().topRows(size()).colwise().minCoeff().transpose().matrix(), 
+		              maxs().topRows(size()).colwise().maxCoeff().transpose().matrix());
+	}
 
-	std::optional<std::tuple<float,int>> trace_general(const AABoxRay& ray) const noexcept {
-		Eigen::Array<float,N,3> t1 = (mins().rowwise() - ray.origin().transpose().array()).rowwise()*ray.inv_direction().transpose().array();
-		Eigen::Array<float,N,3> t2 = (maxs().rowwise() - ray.origin().transpose().array()).rowwise()*ray.inv_direction().transpose().array();
-		Eigen::Array<float,N,1> tmin = t1.cwiseMin(t2).rowwise().maxCoeff();
-		Eigen::Array<float,N,1> tmax = t1.cwiseMax(t2).rowwise().minCoeff();
+	std::optional<std::tuple<float,int>> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(boxes,N); TRACER_COUNT(wasted_lanes,N-size());
+		//The signs of the direction tell which side of each slab is the near one
+		Eigen::Array<float,N,3> t1, t2;
+		for (int k = 0; k<3; ++k) {
+			t1.col(k) = ((ray.sign()[k] ? maxs() : mins()).col(k) - ray.origin()[k])*ray.inv_direction()[k];
+			t2.col(k) = ((ray.sign()[k] ? mins() : maxs()).col(k) - ray.origin()[k])*ray.inv_direction()[k];
+		}
+		Eigen::Array<float,N,1> tmin = t1.rowwise().maxCoeff();
+		Eigen::Array<float,N,1> tmax = t2.rowwise().minCoeff();
 
 /**		if ((!Eigen::isfinite(t1).all()) || (!Eigen::isfinite(t2).all())) {
 			std::cout<<t1<<std::endl<<std::endl<<t2<<std::endl<<std::endl<<t1.cwiseMin(t2)<<std::endl<<std::endl<<t1.cwiseMax(t2)<<std::endl<<std::endl<<tmin<<std::endl<<std::endl<<tmax<<std::endl<<"--------------"<<std::endl;
@@ -55,7 +63,7 @@ public:
 **/
 
 		std::optional<std::tuple<float,int>> hit; Ray r = ray;
-		for (int i = 0; i<N; ++i) {
+		for (int i = 0; i<size(); ++i) {
 			if (tmin[i] <= tmax[i]) {
 				if (r.in_range(tmin[i])) { hit = std::make_tuple(tmin[i],i); r.set_range_max(tmin[i]); }
 				else if (r.in_range(tmax[i])) { hit = std::make_tuple(tmax[i],i); r.set_range_max(tmax[i]); }
@@ -65,16 +73,17 @@ public:
 	}	
 
 	//This is not supposed to be efficient. Very often (BVH) we're needing just the floating point number
-	Hit hit(const AABoxRay& ray, const std::tuple<float, int>& t) const noexcept {
+	Hit hit(const PreparedRay& ray, const std::tuple<float, int>& t) const noexcept {
 		Eigen::Vector3f p = ray.at(std::get<0>(t));
+		const std::int32_t primitive = std::int32_t(index(std::get<1>(t)));
 		Eigen::Vector3f n(0.0f,0.0f,0.0f);
 
 		for (int i = 0; i<3; ++i) {
-			if (fabs(p[i]-mins()(std::get<1>(t),i))<1.e-6f)      { n[i] = -1.0f;  return Hit(std::get<0>(t),p,n); }
-			else if (fabs(p[i]-maxs()(std::get<1>(t),i))<1.e-6f) { n[i] =  1.0f;  return Hit(std::get<0>(t),p,n); }
+			if (fabs(p[i]-mins()(std::get<1>(t),i))<1.e-6f)      { n[i] = -1.0f;  return Hit(std::get<0>(t),p,n).set_primitive(primitive); }
+			else if (fabs(p[i]-maxs()(std::get<1>(t),i))<1.e-6f) { n[i] =  1.0f;  return Hit(std::get<0>(t),p,n).set_primitive(primitive); }
 		}
 		
-		return Hit(std::get<0>(t), p, n);
+		return Hit(std::get<0>(t), p, n).set_primitive(primitive);
 	}
 
 };
@@ -2,7 +2,7 @@
 
 #include "pack.h"
 #include "../primitives/plane.h"
-#include <array>
+#include <cstdint>
 
 namespace tracer {
 
@@ -10,53 +10,56 @@ template<int N> //Make it ObjectGeneral<std::tuple<float, int>>
 class Pack<Plane,N> : public ObjectImpl<Pack<Plane,N>> {
 	Eigen::Matrix<float,N,3> normals_;
 	Eigen::Matrix<float,N,1> distances_;
-	std::array<Plane,N> planes_;
+	int size_;
+	std::uint32_t first_;
 
 	//We focus the efficency on the trace method, not in the construction of the structure which obviously is rather slow.
 	template<typename Collection>
 	void setup(const Collection& c) {
 		assert(c.size() <= N);
+		//Lanes past size() are masked out when tracing, zeros just keep them harmless
+		normals_.setZero(); distances_.setZero();
 		int n = 0;
 		for (const Plane& p : c) {
 			normals_.row(n) = p.normal();
 			distances_[n] = p.distance();
-			planes_[n] = p;
 			++n;	
 		}
-		--n;
-		//We copy the last plane to fill the whole pack (should not happen very often...)
-		for (int i = (n+1); i<N; ++i) {
-			normals_.row(i) = normals_.row(n);
-			distances_(i) = distances_(n);
-			planes_[i] = planes_[n];
-		}
+		size_ = n;
 	}	
 public:
-	Pack(const std::list<Plane>& c)      { setup(c); }
-	Pack(const std::vector<Plane>& c)    { setup(c); }
+	Pack(const std::list<Plane>& c, std::uint32_t first = 0)      : first_(first) { setup(c); }
+	Pack(const std::vector<Plane>& c, std::uint32_t first = 0)    : first_(first) { setup(c); }
 	
+	int size() const noexcept { return size_; }
+	//Index of the plane of a lane in the collection the pack was built from
+	std::uint32_t index(int lane) const noexcept { return first_ + std::uint32_t(lane); }
 	const Eigen::Matrix<float,N,3>& normals() const noexcept { return normals_; }
 	const Eigen::Matrix<float,N,1>& distances() const noexcept { return distances_; }
-	const std::array<Plane,N>& planes() const noexcept { return planes_; }
+	Plane plane(int lane) const noexcept { return Plane(normals().row(lane).transpose(), distances()[lane]); }
+	std::size_t geometry_hash() const noexcept override { return hash(hash(hash_combine(6, size()), normals()), distances()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
 
-	std::optional<std::tuple<float,const Plane*>> trace_general(const Ray& ray) const noexcept {
+	//The hit is (distance, lane)
+	std::optional<std::tuple<float,int>> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(planes,N); TRACER_COUNT(wasted_lanes,N-size());
 		Eigen::Matrix<float,N,1> d = -(normals() * ray.direction()).cwiseInverse().cwiseProduct(normals() * ray.origin() + distances());
 		int n = -1;
 
 		std::optional<Hit> hit; Ray r = ray;
-		for (int i = 0; i<N; ++i) {
+		for (int i = 0; i<size(); ++i) {
 			if (r.in_range(d[i])) {
 				n = i;
 				r.set_range_max(d[i]);
 			}
 		}
 
-		if (n < 0) return std::optional<std::tuple<float,const Plane*>>();
-		else       return std::tuple<float,const Plane*>(d[n],&planes_[n]);
+		if (n < 0) return std::optional<std::tuple<float,int>>();
+		else       return std::tuple<float,int>(d[n],n);
 	}
 
-	Hit hit(const Ray& ray, const std::tuple<float,const Plane*>& h) const {
-		return std::get<1>(h)->hit(ray,std::get<0>(h));
+	Hit hit(const Ray& ray, const std::tuple<float,int>& h) const {
+		return Hit(std::get<0>(h), ray.at(std::get<0>(h)), normals().row(std::get<1>(h)).transpose()).set_primitive(std::int32_t(index(std::get<1>(h))));
 	}		
 };
 
@@ -2,7 +2,7 @@
 
 #include "pack.h"
 #include "../primitives/sphere.h"
-#include <array>
+#include <cstdint>
 
 namespace tracer {
 
@@ -10,36 +10,45 @@ template<int N> //Make it ObjectGeneral<std::tuple<float, int>>
 class Pack<Sphere,N> : public ObjectImpl<Pack<Sphere,N>> {
 	Eigen::Matrix<float,N,3> centers_;
 	Eigen::Matrix<float,N,1> radiuses2_;
-	std::array<Sphere,N> spheres_;
+	int size_;
+	std::uint32_t first_;
 
 	//We focus the efficency on the trace method, not in the construction of the structure which obviously is rather slow.
 	template<typename Collection>
 	void setup(const Collection& c) {
 		assert(c.size() <= N);
+		//Lanes past size() are masked out when tracing, zeros just keep them harmless
+		centers_.setZero(); radiuses2_.setZero();
 		int n = 0;
 		for (const Sphere& s : c) {
 			centers_.row(n) = s.center();
 			radiuses2_[n] = s.radius2();
-			spheres_[n] = s;
 			++n;	
 		}
-		--n;
-		//We copy the last plane to fill the whole pack (should not happen very often...)
-		for (int i = (n+1); i<N; ++i) {
-			centers_.row(i) = centers_.row(n);
-			radiuses2_(i) = radiuses2_(n);
-			spheres_[i] = spheres_[n];
-		}
+		size_ = n;
 	}	
 public:
-	Pack(const std::list<Sphere>& c)      { setup(c); }
-	Pack(const std::vector<Sphere>& c)    { setup(c); }
+	Pack(const std::list<Sphere>& c, std::uint32_t first = 0)      : first_(first) { setup(c); }
+	Pack(const std::vector<Sphere>& c, std::uint32_t first = 0)    : first_(first) { setup(c); }
 	
+	int size() const noexcept { return size_; }
+	//Index of the sphere of a lane in the collection the pack was built from
+	std::uint32_t index(int lane) const noexcept { return first_ + std::uint32_t(lane); }
 	const Eigen::Matrix<float,N,3>& centers() const noexcept { return centers_; }
 	const Eigen::Matrix<float,N,1>& radiuses2() const noexcept { return radiuses2_; }
-	const std::array<Sphere,N>& spheres() const noexcept { return spheres_; }
+	Sphere sphere(int lane) const noexcept { return Sphere(centers().row(lane).transpose(), std::sqrt(radiuses2()[lane])); }
+	std::size_t geometry_hash() const noexcept override { return hash(hash(hash_combine(7, size()), centers()), radiuses2()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
+
+	Bounds bounds() const noexcept override {
+		Eigen::Matrix<float,N,1> radiuses = radiuses2().cwiseSqrt();
+		return Bounds((centers().topRows(size()) - radiuses.head(size()).replicate(1,3)).colwise().minCoeff().transpose(),
+		              (centers().topRows(size()) + radiuses.head(size()).replicate(1,3)).colwise().maxCoeff().transpose());
+	}
 
-	std::optional<std::tuple<float,const Sphere*>> trace_general(const Ray& ray) const noexcept {
+	//The hit is (distance, lane)
+	std::optional<std::tuple<float,int>> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(spheres,N); TRACER_COUNT(wasted_lanes,N-size());
 		Eigen::Matrix<float,N,3> oc = centers().rowwise() - ray.origin().transpose();
 		float a = ray.direction().squaredNorm();
 		Eigen::Matrix<float,N,1> b = -2.0f*(oc*ray.direction());
@@ -54,7 +63,7 @@ public:
 
 		std::optional<Hit> hit; Ray r = ray;
 	    int n = -1;	
-		for (int i = 0; i<N; ++i) {
+		for (int i = 0; i<size(); ++i) {
 			if (disc[i]>0) {
 				if (r.in_range(d1[i])) {
 					n = i;
@@ -67,14 +76,13 @@ public:
 			}
 		} 		
 		// r.range_max() holds the final distance
-		if (n<0) return std::optional<std::tuple<float,const Sphere*>>();
-		else return std::tuple<float,const Sphere*>(r.range_max(),&spheres_[n]); 
-		//Eigen::Vector3f p = ray.at(r.range_max());    
-		//return Hit(r.range_max(),p,(p - centers().row(n).transpose()).normalized());
+		if (n<0) return std::optional<std::tuple<float,int>>();
+		else return std::tuple<float,int>(r.range_max(),n); 
 	}
 
-	Hit hit(const Ray& ray, const std::tuple<float,const Sphere*>& h) const {
-		return std::get<1>(h)->hit(ray,std::get<0>(h));
+	Hit hit(const Ray& ray, const std::tuple<float,int>& h) const {
+		Eigen::Vector3f p = ray.at(std::get<0>(h));
+		return Hit(std::get<0>(h), p, (p - centers().row(std::get<1>(h)).transpose()).normalized()).set_primitive(std::int32_t(index(std::get<1>(h))));
 	}	
 };
 
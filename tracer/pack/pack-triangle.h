@@ -3,57 +3,57 @@
 #include "pack.h"
 #include "../primitives/triangle.h"
 #include <array>
+#include <cstdint>
 
 namespace tracer {
 
 template<int N> //Make it ObjectGeneral<std::tuple<float, int>>
 class Pack<Triangle,N> : public ObjectImpl<Pack<Triangle,N>> {
-	Eigen::Matrix<float,N,3> geometric_normals_;
-	Eigen::Matrix<float,N,3> geometric_normals1_;
-	Eigen::Matrix<float,N,3> geometric_normals2_;
-	Eigen::Matrix<float,N,1> distances_;
-	Eigen::Matrix<float,N,1> distances1_;
-	Eigen::Matrix<float,N,1> distances2_;
-	std::array<Triangle,N> triangles_;
+	std::array<Eigen::Array<float,N,3>,3> vertices_;
+	//Shading data, only read for the closest hit
+	std::array<Eigen::Matrix<float,N,3>,3> normals_;
+	std::array<Eigen::Matrix<float,N,3>,3> tangents_;
+	Bounds bounds_;
+	int size_;
+	std::uint32_t first_;
 
 	//We focus the efficency on the trace method, not in the construction of the structure which obviously is rather slow.
 	template<typename Collection>
 	void setup(const Collection& c) {
 		assert(c.size() <= N);
+		//Lanes past size() are masked out when tracing, zeros just keep them harmless
+		for (int k = 0; k<3; ++k) { vertices_[k].setZero(); normals_[k].setZero(); tangents_[k].setZero(); }
 		int n = 0;
 		for (const Triangle& t : c) {
-			geometric_normals_.row(n) = (t.point1() - t.point0()).cross(t.point2() - t.point0());
-			geometric_normals1_.row(n) = (t.point2() - t.point0()).cross(geometric_normals_.row(n))/geometric_normals_.row(n).squaredNorm();
-			geometric_normals2_.row(n) = geometric_normals_.row(n).cross(t.point1() - t.point0())/geometric_normals_.row(n).squaredNorm();
-			distances_(n) = -geometric_normals_.row(n).dot(t.point0());
-			distances1_(n) = -geometric_normals1_.row(n).dot(t.point0());
-			distances2_(n) = -geometric_normals2_.row(n).dot(t.point0());
-			triangles_[n] = t;
+			vertices_[0].row(n) = t.point0().transpose().array(); vertices_[1].row(n) = t.point1().transpose().array(); vertices_[2].row(n) = t.point2().transpose().array();
+			normals_[0].row(n) = t.normal0(); normals_[1].row(n) = t.normal1(); normals_[2].row(n) = t.normal2();
+			tangents_[0].row(n) = t.tangent0(); tangents_[1].row(n) = t.tangent1(); tangents_[2].row(n) = t.tangent2();
+			bounds_.extend(t.bounds());
 			++n;	
 		}
-		--n;
-		//We copy the last plane to fill the whole pack (should not happen very often...)
-		for (int i = (n+1); i<N; ++i) {
-			geometric_normals_.row(i) = geometric_normals_.row(n);
-			geometric_normals1_.row(i) = geometric_normals1_.row(n);
-			geometric_normals2_.row(i) = geometric_normals2_.row(n);
-			distances_(i) = distances_(n);
-			distances1_(i) = distances1_(n);
-			distances2_(i) = distances2_(n);
-			triangles_[i] = triangles_[n];
-		}
+		size_ = n;
 	}	
 public:
-	Pack(const std::list<Triangle>& c)      { setup(c); }
-	Pack(const std::vector<Triangle>& c)    { setup(c); }
-
-	const Eigen::Matrix<float,N,3>& geometric_normals() const noexcept { return geometric_normals_; }
-	const Eigen::Matrix<float,N,3>& geometric_normals1() const noexcept { return geometric_normals1_; }
-	const Eigen::Matrix<float,N,3>& geometric_normals2() const noexcept { return geometric_normals2_; }
-	const Eigen::Matrix<float,N,1>& distances() const noexcept { return distances_; }
-	const Eigen::Matrix<float,N,1>& distances1() const noexcept { return distances1_; }
-	const Eigen::Matrix<float,N,1>& distances2() const noexcept { return distances2_; }
-	const std::array<Triangle,N>& triangles() const noexcept { return triangles_; }
+	Pack(const std::list<Triangle>& c, std::uint32_t first = 0)      : first_(first) { setup(c); }
+	Pack(const std::vector<Triangle>& c, std::uint32_t first = 0)    : first_(first) { setup(c); }
+
+	int size() const noexcept { return size_; }
+	//Index of the triangle of a lane in the collection the pack was built from
+	std::uint32_t index(int lane) const noexcept { return first_ + std::uint32_t(lane); }
+	//Vertices of every lane, per vertex (0, 1, 2)
+	const Eigen::Array<float,N,3>& vertices(int vertex) const noexcept { return vertices_[vertex]; }
+	//Vertex normals and tangents, per vertex (0, 1, 2)
+	const Eigen::Matrix<float,N,3>& normals(int vertex) const noexcept { return normals_[vertex]; }
+	const Eigen::Matrix<float,N,3>& tangents(int vertex) const noexcept { return tangents_[vertex]; }
+
+	Bounds bounds() const noexcept override { return bounds_; }
+
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = hash_combine(9, size());
+		for (int k = 0; k<3; ++k) sol = hash(hash(hash(sol, vertices(k)), normals(k)), tangents(k));
+		return sol;
+	}
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::packs, sizeof(*this)); }
 
 	
 /** 
@@ -95,45 +95,59 @@ public:
 	}
 */
 
-/** 
-  * Using the Havel-Herout algorithm:
-  * http://ieeexplore.ieee.org/stamp/stamp.jsp?arnumber=5159346
+/**
+  * Using the watertight intersection algorithm, as Triangle (see watertight_triangle): the edge
+  * functions of every lane are computed at once with the permutation and shear of the PreparedRay,
+  * and the lanes are then resolved one by one, exactly as the scalar test does.
   **/
-	template <typename T> 
-	static int sgn(T val) {
-    		return (T(0) < val) - (val < T(0));
-	}
-
 
-	std::optional<std::tuple<float,float,float,const Triangle*>> trace_general(const Ray& ray) const noexcept {
-		const float eps = 1.e-6f;
-		Eigen::Matrix<float,N,1> det = geometric_normals()*ray.direction();
-//		if ((det > -eps) && (det < eps)) return {}; //Its parallel
-		Eigen::Matrix<float,N,1> taux = -distances() - geometric_normals()*ray.origin();
-		Eigen::Matrix<float,N,1> t    = det.cwiseInverse().cwiseProduct(taux);
-		Eigen::Matrix<float,N,3> paux = det*ray.origin().transpose() + taux*ray.direction().transpose();
-		Eigen::Matrix<float,N,1> uaux = paux.cwiseProduct(geometric_normals1()).rowwise().sum() + distances1().cwiseProduct(det);
-		Eigen::Matrix<float,N,1> vaux = paux.cwiseProduct(geometric_normals2()).rowwise().sum() + distances2().cwiseProduct(det);
-//		const float uaux = paux.dot(geometric_normal1()) + det*distance1();
-//		if (sgn(uaux) != sgn(det - uaux)) return {}; //Out of range u
-//		const float vaux = paux.dot(geometric_normal2()) + det*distance2();
-//		if (sgn(vaux) != sgn(det - uaux - vaux)) return {}; //Out of range v
-
-		Ray r = ray; int n = -1;
-		for (int i = 0; i<N; ++i) {
-			if ( (abs(det(i))>eps) && r.in_range(t(i)) && (sgn(uaux(i))==sgn(det(i) - uaux(i))) && (sgn(vaux(i))==sgn(det(i) - uaux(i) - vaux(i))) ) {
-				n = i;
-				r.set_range_max(t(i));
+	/**
+	 * Closest lane of the first size lanes hit by the ray, with their vertices a, b and c already
+	 * relative to the origin of the ray (FixedOrigin keeps them that way).
+	 **/
+	static std::optional<std::tuple<float,float,float,int>> watertight(const PreparedRay& ray,
+			const Eigen::Array<float,N,3>& a, const Eigen::Array<float,N,3>& b, const Eigen::Array<float,N,3>& c, int size) noexcept {
+		const int kx = ray.permutation()[0], ky = ray.permutation()[1], kz = ray.permutation()[2];
+		const Eigen::Vector3f& shear = ray.shear();
+		Eigen::Array<float,N,1> ax = a.col(kx) - shear[0]*a.col(kz), ay = a.col(ky) - shear[1]*a.col(kz);
+		Eigen::Array<float,N,1> bx = b.col(kx) - shear[0]*b.col(kz), by = b.col(ky) - shear[1]*b.col(kz);
+		Eigen::Array<float,N,1> cx = c.col(kx) - shear[0]*c.col(kz), cy = c.col(ky) - shear[1]*c.col(kz);
+		Eigen::Array<float,N,1> us = cx*by - cy*bx, vs = ax*cy - ay*cx, ws = bx*ay - by*ax; //Weights of the three vertices
+
+		Ray r = ray; int n = -1; float hu = 0.0f, hv = 0.0f;
+		for (int i = 0; i<size; ++i) {
+			float u = us(i), v = vs(i), w = ws(i);
+			if ((u == 0.0f) || (v == 0.0f) || (w == 0.0f)) {
+				u = float(double(cx(i))*double(by(i)) - double(cy(i))*double(bx(i)));
+				v = float(double(ax(i))*double(cy(i)) - double(ay(i))*double(cx(i)));
+				w = float(double(bx(i))*double(ay(i)) - double(by(i))*double(ax(i)));
 			}
+			if (((u < 0.0f) || (v < 0.0f) || (w < 0.0f)) && ((u > 0.0f) || (v > 0.0f) || (w > 0.0f))) continue;
+			const float det = u + v + w;
+			if (det == 0.0f) continue;
+			const float inv_det = 1.0f/det;
+			const float t = (u*a(i,kz) + v*b(i,kz) + w*c(i,kz))*shear[2]*inv_det;
+			if (r.in_range(t)) { n = i; r.set_range_max(t); hu = v*inv_det; hv = w*inv_det; }
 		}
 
 		if (n < 0) return {};
-		else return std::tuple<float,float,float,const Triangle*>(t(n), uaux(n)/det(n), vaux(n)/det(n), &triangles_[n]); 
+		else return std::tuple<float,float,float,int>(r.range_max(), hu, hv, n);
+	}
+
+	//The hit is (distance, u, v, lane)
+	std::optional<std::tuple<float,float,float,int>> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(nodes,1); TRACER_COUNT(triangles,N); TRACER_COUNT(wasted_lanes,N-size());
+		const Eigen::Array<float,1,3> origin = ray.origin().transpose().array();
+		return watertight(ray, vertices(0).rowwise() - origin, vertices(1).rowwise() - origin, vertices(2).rowwise() - origin, size());
 	}
 	
-	Hit hit(const Ray& ray, const std::tuple<float, float, float, const Triangle*>& h) const noexcept {
-		return std::get<3>(h)->hit(ray,
-			std::tuple<float,float,float>(std::get<0>(h),std::get<1>(h),std::get<2>(h)));
+	//Same shading as Triangle::hit
+	Hit hit(const Ray& ray, const std::tuple<float, float, float, int>& h) const noexcept {
+		float t, u, v; int i;
+		std::tie(t,u,v,i) = h;
+		Eigen::Vector3f normal = ((1.0f - u - v)*normals(0).row(i) + u*normals(1).row(i) + v*normals(2).row(i)).transpose().normalized();
+		Eigen::Vector3f tangent = ((1.0f - u - v)*tangents(0).row(i) + u*tangents(1).row(i) + v*tangents(2).row(i)).transpose();
+		return Hit(t, ray.at(t), normal, (tangent - normal.dot(tangent)*normal).normalized()).set_primitive(std::int32_t(index(i)));
 	}
 
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+/**
+ * Pack widths (and leaf sizes for acceleration structures) per primitive type. The defaults
+ * below are overridden by the header generated on the target machine by the tune tool
+ * (tracer/pack-widths.generated.h, see main/experiment/tune), if it is in the include path.
+ **/
+#if defined(__has_include)
+#if __has_include(<tracer/pack-widths.generated.h>)
+#include <tracer/pack-widths.generated.h>
+#endif
+#endif
+
+#ifndef TRACER_PACK_WIDTH_PLANE
+#define TRACER_PACK_WIDTH_PLANE 8
+#endif
+#ifndef TRACER_PACK_WIDTH_SPHERE
+#define TRACER_PACK_WIDTH_SPHERE 8
+#endif
+#ifndef TRACER_PACK_WIDTH_TRIANGLE
+#define TRACER_PACK_WIDTH_TRIANGLE 8
+#endif
+#ifndef TRACER_PACK_WIDTH_AXIS_ALIGNED_BOX
+#define TRACER_PACK_WIDTH_AXIS_ALIGNED_BOX 8
+#endif
+#ifndef TRACER_LEAF_SIZE_PLANE
+#define TRACER_LEAF_SIZE_PLANE 8
+#endif
+#ifndef TRACER_LEAF_SIZE_SPHERE
+#define TRACER_LEAF_SIZE_SPHERE 8
+#endif
+#ifndef TRACER_LEAF_SIZE_TRIANGLE
+#define TRACER_LEAF_SIZE_TRIANGLE 8
+#endif
+#ifndef TRACER_LEAF_SIZE_AXIS_ALIGNED_BOX
+#define TRACER_LEAF_SIZE_AXIS_ALIGNED_BOX 8
+#endif
+
+namespace tracer {
+
+class Plane; class Sphere; class Triangle; class AxisAlignedBox;
+
+//Objects without a tuned width are not packed
+template<typename O> struct pack_width { static constexpr int value = 1; static constexpr int leaf_size = 1; };
+template<> struct pack_width<Plane> { static constexpr int value = TRACER_PACK_WIDTH_PLANE; static constexpr int leaf_size = TRACER_LEAF_SIZE_PLANE; };
+template<> struct pack_width<Sphere> { static constexpr int value = TRACER_PACK_WIDTH_SPHERE; static constexpr int leaf_size = TRACER_LEAF_SIZE_SPHERE; };
+template<> struct pack_width<Triangle> { static constexpr int value = TRACER_PACK_WIDTH_TRIANGLE; static constexpr int leaf_size = TRACER_LEAF_SIZE_TRIANGLE; };
+template<> struct pack_width<AxisAlignedBox> { static constexpr int value = TRACER_PACK_WIDTH_AXIS_ALIGNED_BOX; static constexpr int leaf_size = TRACER_LEAF_SIZE_AXIS_ALIGNED_BOX; };
+
+template<typename O>
+constexpr int pack_width_v = pack_width<O>::value;
+
+};
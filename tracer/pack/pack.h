@@ -1,6 +1,11 @@
 #pragma once
 
 #include "list.h"
+#include "pack-widths.h"
+#include "../profiler.h"
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
 
 namespace tracer {
 
@@ -31,6 +36,30 @@ Pack<O,4> pack(const O& o1, const O& o2, const O& o3, const O& o4) {
 	return Pack<O,4>(std::vector<O>{o1,o2,o3,o4});
 }
 
-
+/**
+ * The objects, in order, in packs of the width tuned for their type on this machine (see 
+ * pack-widths.h).
+ **/
+template<typename C>
+std::vector<Pack<typename C::value_type,pack_width_v<typename C::value_type>>> packs(const C& objects) {
+	TRACER_PROFILE_SCOPE("build packs");
+	using O = typename C::value_type;
+	constexpr int N = pack_width_v<O>;
+	std::vector<Pack<O,N>> sol;
+	std::vector<O> chunk;
+	std::uint32_t first = 0;
+	//SoA packs remember where their objects came from (see Pack::index)
+	auto add = [&] () {
+		if constexpr (std::is_constructible_v<Pack<O,N>,const std::vector<O>&,std::uint32_t>) sol.push_back(Pack<O,N>(chunk, first));
+		else sol.push_back(Pack<O,N>(chunk));
+		first += std::uint32_t(chunk.size()); chunk.clear();
+	};
+	for (const O& o : objects) {
+		chunk.push_back(o);
+		if (int(chunk.size()) == N) add();
+	}
+	if (!chunk.empty()) add();
+	return sol;
+}
 
 }
@@ -3,13 +3,71 @@
 #include <list>
 #include <memory>
 #include "../object.h"
+#include "../arena.h"
 #include "list.h"
 
 namespace tracer {
-	
-class Scene : public List<Object> {
+
+//Base from member: the arena is built before the objects and destroyed after them
+class SceneArena {
+	std::shared_ptr<Arena> arena_;
 public:
-	using List<Object>::List;	
+	SceneArena(const std::shared_ptr<Arena>& arena = nullptr) : arena_(arena) {}
+	const std::shared_ptr<Arena>& arena() const noexcept { return arena_; }
 };
 
+/**
+ * A list of polymorphic objects. If it is given an Arena, every object (and material) added 
+ * to the scene is allocated in it instead of in its own heap allocation, and copies of the 
+ * scene share it.
+ *
+ * Materials only go to the arena through make_material: ObjectImpl::set_material(const MATERIAL&)
+ * does not know the scene and allocates on the heap, so materials shared by many objects should be
+ * made once with make_material and given to each of them as a shared pointer.
+ **/
+class Scene : public SceneArena, public List<Object> {
+public:
+	using List<Object>::List;
+	Scene() noexcept {}
+	explicit Scene(const std::shared_ptr<Arena>& arena) : SceneArena(arena) {}
+	Scene(const Scene&) = default;
+	Scene(Scene&&) = default;
+
+	//The old objects are released before the arena they may live in (the reverse of the bases)
+	Scene& operator=(const Scene& s) {
+		List<Object>::operator=(s);
+		SceneArena::operator=(s);
+		return (*this);
+	}
+	Scene& operator=(Scene&& s) {
+		List<Object>::operator=(std::move(s));
+		SceneArena::operator=(std::move(s));
+		return (*this);
+	}
+
+	template<typename O>
+	void add(O&& o) {
+		using D = std::decay_t<O>;
+		if constexpr (std::is_same_v<D,Object>) 
+			List<Object>::add(std::forward<O>(o));
+		else if (arena()) 
+			List<Object>::add(Object(std::shared_ptr<ObjectBase>(arena()->make_shared<D>(std::forward<O>(o)))));
+		else 
+			List<Object>::add(Object(std::forward<O>(o)));
+	}
+
+	//The arena goes first, so objects allocated in it are not charged a heap header
+	void add_memory_usage(MemoryUsage& usage) const override {
+		usage.add(MemoryUsage::nodes, sizeof(Scene) - sizeof(List<Object>));
+		if (arena() && usage.arena(*arena())) usage.shared(arena().get());
+		List<Object>::add_memory_usage(usage);
+	}
+
+#ifdef MATERIAL
+	std::shared_ptr<MATERIAL> make_material(const MATERIAL& m) {
+		return arena() ? arena()->make_shared<MATERIAL>(m) : std::make_shared<MATERIAL>(m);
+	}
+#endif
 };
+
+};
\ No newline at end of file
@@ -0,0 +1,6 @@
+//The only translation unit of the tracer-precompiled library: every template listed in precompiled.h
+#ifndef TRACER_PRECOMPILED //Also defined by the build for every target that links the library
+#define TRACER_PRECOMPILED
+#endif
+#define TRACER_PRECOMPILED_DEFINITIONS
+#include "tracer.h"
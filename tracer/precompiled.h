@@ -0,0 +1,62 @@
+#pragma once
+
+#include "object.h"
+#include "primitives/plane.h"
+#include "primitives/sphere.h"
+#include "primitives/triangle.h"
+#include "primitives/axis-aligned-box.h"
+#include "pack/list.h"
+#include "pack/scene.h"
+#include "pack/pack.h"
+#include "pack/pack-plane.h"
+#include "pack/pack-sphere.h"
+#include "pack/pack-triangle.h"
+#include "pack/pack-axis-aligned-box.h"
+
+/**
+ * Explicit instantiations of the common templates: primitives, their lists, their packs (of every
+ * power of two width up to 1024, which includes the tuned ones) and lists of packs of the tuned
+ * width. They are compiled once, with optimizations, into the tracer-precompiled library
+ * (precompiled.cc), and every target that links it (and so gets TRACER_PRECOMPILED) sees them as
+ * extern templates instead of compiling them again.
+ *
+ * MATERIAL and TRACER_STATS change the objects themselves, so targets that define them never use
+ * the precompiled ones (and should not link the library).
+ **/
+#if defined(TRACER_PRECOMPILED) && !defined(MATERIAL) && !defined(TRACER_STATS)
+
+#ifdef TRACER_PRECOMPILED_DEFINITIONS
+#define TRACER_TEMPLATE template
+#else
+#define TRACER_TEMPLATE extern template
+#endif
+
+#define TRACER_PRECOMPILED_OBJECT(...) \
+	TRACER_TEMPLATE class __VA_ARGS__; \
+	TRACER_TEMPLATE class ObjectImpl<__VA_ARGS__>;
+
+#define TRACER_PRECOMPILED_PRIMITIVE(P) \
+	TRACER_TEMPLATE class ObjectImpl<P>; \
+	TRACER_PRECOMPILED_OBJECT(List<P>) \
+	TRACER_PRECOMPILED_OBJECT(Pack<P,1>)   TRACER_PRECOMPILED_OBJECT(Pack<P,2>)   TRACER_PRECOMPILED_OBJECT(Pack<P,4>) \
+	TRACER_PRECOMPILED_OBJECT(Pack<P,8>)   TRACER_PRECOMPILED_OBJECT(Pack<P,16>)  TRACER_PRECOMPILED_OBJECT(Pack<P,32>) \
+	TRACER_PRECOMPILED_OBJECT(Pack<P,64>)  TRACER_PRECOMPILED_OBJECT(Pack<P,128>) TRACER_PRECOMPILED_OBJECT(Pack<P,256>) \
+	TRACER_PRECOMPILED_OBJECT(Pack<P,512>) TRACER_PRECOMPILED_OBJECT(Pack<P,1024>) \
+	TRACER_PRECOMPILED_OBJECT(List<Pack<P,pack_width_v<P>>>)
+
+namespace tracer {
+
+TRACER_PRECOMPILED_PRIMITIVE(Plane)
+TRACER_PRECOMPILED_PRIMITIVE(Sphere)
+TRACER_PRECOMPILED_PRIMITIVE(Triangle)
+TRACER_PRECOMPILED_PRIMITIVE(AxisAlignedBox)
+TRACER_TEMPLATE class ObjectImpl<Object>;
+TRACER_PRECOMPILED_OBJECT(List<Object>)
+
+}
+
+#undef TRACER_PRECOMPILED_PRIMITIVE
+#undef TRACER_PRECOMPILED_OBJECT
+#undef TRACER_TEMPLATE
+
+#endif
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "ray.h"
+#include <array>
+#include <utility>
+
+namespace tracer {
+
+/**
+ * A ray together with everything that intersection kernels precompute from its direction:
+ * the inverse direction and its signs (octant) for slab tests, and the axis permutation and 
+ * shear constants of the watertight ray/triangle test (Woop et al. 2013). 
+ *
+ * It is built once, when the ray enters the scene (ObjectBase::trace), and every object below 
+ * reads from it. The constructor is explicit so no object rebuilds it by accident.
+ **/
+class PreparedRay : public Ray {
+	Eigen::Vector3f inv_direction_;
+	std::array<int,3> sign_;        //1 when the inverse direction is negative
+	std::array<int,3> permutation_; //(kx,ky,kz): kz is the dominant axis of the direction
+	Eigen::Vector3f shear_;         //(Sx,Sy,Sz)
+
+public:
+	explicit PreparedRay(const Ray& r) noexcept : Ray(r), inv_direction_(r.direction().cwiseInverse()) {
+		for (int k = 0; k<3; ++k) sign_[k] = (inv_direction_[k] < 0.0f) ? 1 : 0;
+		int kz; r.direction().cwiseAbs().maxCoeff(&kz);
+		int kx = (kz + 1)%3, ky = (kx + 1)%3;
+		if (r.direction()[kz] < 0.0f) std::swap(kx,ky); //Keeps the winding of triangles
+		permutation_ = {kx, ky, kz};
+		shear_ = Eigen::Vector3f(r.direction()[kx]/r.direction()[kz], r.direction()[ky]/r.direction()[kz], 1.0f/r.direction()[kz]);
+	}
+
+	const Eigen::Vector3f& inv_direction() const noexcept { return inv_direction_; } 
+	const std::array<int,3>& sign() const noexcept { return sign_; }
+	int octant() const noexcept { return sign_[0] | (sign_[1] << 1) | (sign_[2] << 2); }
+	const std::array<int,3>& permutation() const noexcept { return permutation_; }
+	const Eigen::Vector3f& shear() const noexcept { return shear_; }
+};
+
+};
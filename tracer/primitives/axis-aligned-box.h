@@ -5,12 +5,8 @@
 
 namespace tracer {
 
-class AABoxRay : public Ray {
-	Eigen::Vector3f inv_direction_;
-public:
-	AABoxRay(const Ray& r) noexcept : Ray(r), inv_direction_(r.direction().cwiseInverse()) { }
-	const Eigen::Vector3f& inv_direction() const noexcept { return inv_direction_; } 
-};
+//Boxes read the inverse direction and its signs from the ray prepared at scene entry
+using AABoxRay = PreparedRay;
 
 
 class AxisAlignedBox : public ObjectImpl<AxisAlignedBox> { //GeneralObject<float,AABoxRay> {
@@ -27,19 +23,24 @@ public:
 
 	const Eigen::Vector3f& min() const noexcept { return min_; }
 	const Eigen::Vector3f& max() const noexcept { return max_; }
+	Bounds bounds() const noexcept override { return Bounds(min(), max()); }
+	std::size_t geometry_hash() const noexcept override { return hash(hash(3, min()), max()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::geometry, sizeof(AxisAlignedBox)); }
 	
-    static AABoxRay extend_ray(const Ray& r) noexcept { return AABoxRay(r); }
-
-	std::optional<float> trace_general(const AABoxRay& ray) const noexcept {
+	std::optional<float> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(boxes,1);
 		std::optional<float> sol;
-		Eigen::Vector3f t1 = (min() - ray.origin()).cwiseProduct(ray.inv_direction());
-		Eigen::Vector3f t2 = (max() - ray.origin()).cwiseProduct(ray.inv_direction());
-//		std::cerr<<min().transpose()<<"\t|\t"<<max().transpose()<<std::endl;
-//		std::cerr<<ray.inv_direction().transpose()<<std::endl;
-//		std::cerr<<t1.transpose()<<"\t|\t"<<t2.transpose()<<std::endl;
+		//The signs of the direction tell which side of each slab is the near one
+		Eigen::Vector3f nearest, farthest;
+		for (int i = 0; i<3; ++i) {
+			nearest[i]  = ray.sign()[i] ? max()[i] : min()[i];
+			farthest[i] = ray.sign()[i] ? min()[i] : max()[i];
+		}
+		Eigen::Vector3f t1 = (nearest - ray.origin()).cwiseProduct(ray.inv_direction());
+		Eigen::Vector3f t2 = (farthest - ray.origin()).cwiseProduct(ray.inv_direction());
 
-		float tmin = t1.cwiseMin(t2).maxCoeff();
-		float tmax = t1.cwiseMax(t2).minCoeff();
+		float tmin = t1.maxCoeff();
+		float tmax = t2.minCoeff();
 //		std::cerr<<tmin<<" - "<<tmax<<std::endl<<std::endl;
 
 		if (tmax >= tmin) {
@@ -50,7 +51,7 @@ public:
 	}
 
 	//This is not supposed to be efficient. Very often (BVH) we're needing just the floating point number
-	Hit hit(const AABoxRay& ray, float d) const noexcept {
+	Hit hit(const PreparedRay& ray, float d) const noexcept {
 		Eigen::Vector3f p = ray.at(d);
 		Eigen::Vector3f n(0.0f,0.0f,0.0f);
 
@@ -28,6 +28,7 @@ public:
 	}
 	
 	std::optional<float> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(planes,1);
 		std::optional<float> sol;
 		float den = ray.direction().dot(normal());
 		if (std::abs(den) < 1.e-10) return sol;
@@ -39,6 +40,9 @@ public:
 	Hit hit(const Ray& ray, float d) const noexcept {
 		return Hit(d, ray.at(d), normal());
 	}
+
+	std::size_t geometry_hash() const noexcept override { return hash(hash(1, normal()), distance()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::geometry, sizeof(Plane)); }
 };
 
 };
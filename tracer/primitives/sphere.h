@@ -25,6 +25,7 @@ public:
 	
 	
 	std::optional<float> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(spheres,1);
 		std::optional<float> sol;
 		Eigen::Vector3f oc = ray.origin() - center();
 		float a = ray.direction().squaredNorm();
@@ -47,6 +48,13 @@ public:
 		Eigen::Vector3f p = ray.at(d);
 		return Hit(d, p, (p - center()).normalized());
 	}
+
+	Bounds bounds() const noexcept override {
+		return Bounds(center() - Eigen::Vector3f::Constant(radius()), center() + Eigen::Vector3f::Constant(radius()));
+	}
+
+	std::size_t geometry_hash() const noexcept override { return hash(hash(2, center()), radius()); }
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::geometry, sizeof(Sphere)); }
 };
 
 };
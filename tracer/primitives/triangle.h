@@ -5,13 +5,40 @@
 
 namespace tracer {
 
-template<typename... Rest>
-constexpr float hit_distance(const std::tuple<float,Rest...>& h) noexcept {
-	return std::get<0>(h);
+/**
+ * Watertight ray/triangle test (Woop et al. 2013), with the permutation and shear constants that
+ * the PreparedRay computes once per ray: the triangle is transformed to a space where the ray
+ * goes along +z from the origin and is tested with 2D edge functions, so a ray never slips between
+ * two triangles that share an edge. Returns (t,u,v), where u and v are the weights of p1 and p2.
+ * Edge functions that are exactly zero are recomputed in double precision, as in the paper.
+ **/
+inline std::optional<std::tuple<float,float,float>> watertight_triangle(const PreparedRay& ray,
+		const Eigen::Vector3f& p0, const Eigen::Vector3f& p1, const Eigen::Vector3f& p2) noexcept {
+	const int kx = ray.permutation()[0], ky = ray.permutation()[1], kz = ray.permutation()[2];
+	const Eigen::Vector3f& shear = ray.shear();
+	const Eigen::Vector3f a = p0 - ray.origin(), b = p1 - ray.origin(), c = p2 - ray.origin();
+	const float ax = a[kx] - shear[0]*a[kz], ay = a[ky] - shear[1]*a[kz];
+	const float bx = b[kx] - shear[0]*b[kz], by = b[ky] - shear[1]*b[kz];
+	const float cx = c[kx] - shear[0]*c[kz], cy = c[ky] - shear[1]*c[kz];
+	float u = cx*by - cy*bx, v = ax*cy - ay*cx, w = bx*ay - by*ax; //Weights of p0, p1 and p2
+	if ((u == 0.0f) || (v == 0.0f) || (w == 0.0f)) {
+		u = float(double(cx)*double(by) - double(cy)*double(bx));
+		v = float(double(ax)*double(cy) - double(ay)*double(cx));
+		w = float(double(bx)*double(ay) - double(by)*double(ax));
+	}
+	if (((u < 0.0f) || (v < 0.0f) || (w < 0.0f)) && ((u > 0.0f) || (v > 0.0f) || (w > 0.0f))) return {};
+	const float det = u + v + w;
+	if (det == 0.0f) return {};
+	const float inv_det = 1.0f/det;
+	const float t = (u*a[kz] + v*b[kz] + w*c[kz])*shear[2]*inv_det;
+	if (ray.in_range(t)) return std::make_tuple(t, v*inv_det, w*inv_det);
+	else return {};
 }
 
 /**
- * Using the Möller-Trumbore intersection algorithm, which proved slightly faster than the Havel-Herout algorithm
+ * Using the watertight intersection algorithm (see above). The Möller-Trumbore algorithm, which proved
+ * slightly faster than the Havel-Herout algorithm, and the Havel-Herout one are kept below, but they
+ * can miss rays that go exactly through shared edges.
  *
  * The "HitType" is (t,u,v) where t is the ray parameter, and u and v are coordinates on the surface
  * of the triangle.
@@ -78,6 +105,13 @@ public:
 	const Eigen::Vector3f& tangent0() const noexcept { return tangent0_; }
 	const Eigen::Vector3f& tangent1() const noexcept { return tangent1_; }
 	const Eigen::Vector3f& tangent2() const noexcept { return tangent2_; }
+	Bounds bounds() const noexcept override { return Bounds().extend(point0()).extend(point1()).extend(point2()); }
+	std::size_t geometry_hash() const noexcept override {
+		std::size_t sol = 4;
+		for (const Eigen::Vector3f* v : { &point0_, &point1_, &point2_, &normal0_, &normal1_, &normal2_, &tangent0_, &tangent1_, &tangent2_ }) sol = hash(sol, *v);
+		return sol;
+	}
+	void add_memory_usage(MemoryUsage& usage) const override { usage.add(MemoryUsage::geometry, sizeof(Triangle)); }
 	const Eigen::Vector3f& edge1() const noexcept { return edge1_; }
 	const Eigen::Vector3f& edge2() const noexcept { return edge2_; }
 
@@ -94,11 +128,21 @@ public:
 	}
 */
 
+ /** 
+  * Using the watertight intersection algorithm:
+  * http://jcgt.org/published/0002/01/05/
+  **/
+	std::optional<std::tuple<float,float,float>> trace_general(const PreparedRay& ray) const noexcept {
+		TRACER_COUNT(triangles,1);
+		return watertight_triangle(ray, point0(), point1(), point2());
+	}
+
  /** 
   * Using the Möller-Trumbore intersection algorithm:
   * https://en.wikipedia.org/wiki/M%C3%B6ller%E2%80%93Trumbore_intersection_algorithm
-  **/
+  *
 	std::optional<std::tuple<float,float,float>> trace_general(const Ray& ray) const noexcept {
+		TRACER_COUNT(triangles,1);
 		const float eps = 1.e-6f;
 		Eigen::Vector3f h = ray.direction().cross(edge2());
 		float a = edge1().dot(h);
@@ -119,7 +163,7 @@ public:
 		if (ray.in_range(t)) return std::make_tuple(t,u,v);
 		else return {};
 	}
- 
+*/
 
  /** 
   * Using the Havel-Herout algorithm:
@@ -154,9 +198,10 @@ public:
 	Hit hit(const Ray& ray, const std::tuple<float, float, float>& h) const noexcept  {
 		float t, u, v;
 		std::tie(t,u,v) = h;
-		return Hit(t, ray.at(t), 
-			((1.0f - u - v)*normal0() + u*normal1() + v*normal2()).normalized(),
-			((1.0f - u - v)*tangent0() + u*tangent1() + v*tangent2()).normalized());
+		Eigen::Vector3f normal = ((1.0f - u - v)*normal0() + u*normal1() + v*normal2()).normalized();
+		Eigen::Vector3f tangent = (1.0f - u - v)*tangent0() + u*tangent1() + v*tangent2();
+		//Interpolated tangents drift away from the interpolated normal when vertex normals differ
+		return Hit(t, ray.at(t), normal, (tangent - normal.dot(tangent)*normal).normalized());
 	}
 };
 
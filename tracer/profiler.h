@@ -0,0 +1,216 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <stdexcept>
+
+namespace tracer {
+
+/**
+ * Scoped phase timers (import, scene build, tracing of a tile, shading, image write...), saved as a
+ * Chrome trace_event JSON file that can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Like the counters in stats.h, scopes are only recorded when TRACER_PROFILE is defined before
+ * including the tracer, so they cost nothing otherwise. When enabled, a scope reads the clock twice
+ * and appends an event to a buffer of the calling thread (no locks, no sharing between threads),
+ * so scopes should time meaningful amounts of work: a phase, a tile, not a ray.
+ *
+ * Memory is bounded: each thread keeps its latest events in a ring buffer (see set_capacity) and
+ * the buffers of finished threads are reused by the threads that start later.
+ **/
+namespace profiler {
+
+struct Event {
+	const char* name;      //A string literal: only the pointer is kept
+	std::int64_t begin;    //Nanoseconds since the start of the program (or the last reset)
+	std::int64_t duration;
+	std::int64_t arg;      //E.g. the index of the tile, -1 if none
+};
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * The latest events, up to a capacity: once full, each new event replaces the oldest one.
+ * Events are indexed from the oldest one.
+ **/
+class EventBuffer {
+	std::vector<Event> events;
+	std::size_t capacity_;
+	std::size_t next = 0; //Oldest event once full
+	std::uint64_t dropped_ = 0;
+public:
+	explicit EventBuffer(std::size_t capacity) : capacity_(std::max<std::size_t>(capacity, 1)) {
+		events.reserve(std::min<std::size_t>(capacity_, 1024));
+	}
+	void push_back(const Event& e) {
+		if (events.size() < capacity_) events.push_back(e);
+		else { events[next] = e; next = (next + 1)%capacity_; ++dropped_; }
+	}
+	std::size_t size() const noexcept { return events.size(); }
+	std::size_t capacity() const noexcept { return capacity_; }
+	const Event& operator[](std::size_t i) const noexcept { return events[(next + i)%events.size()]; }
+	//Events that were replaced by newer ones
+	std::uint64_t dropped() const noexcept { return dropped_; }
+	void clear() noexcept { events.clear(); next = 0; dropped_ = 0; }
+	void set_capacity(std::size_t capacity) { clear(); capacity_ = std::max<std::size_t>(capacity, 1); events.shrink_to_fit(); }
+};
+
+/**
+ * Events of one thread. They are registered (and kept alive after the thread finishes) so they
+ * can be written afterwards. When the thread finishes its buffer is released for the next thread
+ * that starts, which records on the same track after the events of the finished one.
+ **/
+struct ThreadEvents {
+	int thread;
+	EventBuffer events;
+	ThreadEvents(int thread, std::size_t capacity) : thread(thread), events(capacity) {}
+};
+
+class Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<ThreadEvents>> threads;
+	std::vector<std::shared_ptr<ThreadEvents>> released; //Of finished threads, ready to be reused
+	std::size_t capacity_ = std::size_t(1) << 16; //Events per thread (2MB)
+	Clock::time_point origin_ = Clock::now();
+public:
+	std::shared_ptr<ThreadEvents> add() {
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!released.empty()) {
+			std::shared_ptr<ThreadEvents> sol = released.back();
+			released.pop_back();
+			return sol;
+		}
+		threads.push_back(std::make_shared<ThreadEvents>(int(threads.size()), capacity_));
+		return threads.back();
+	}
+	void remove(const std::shared_ptr<ThreadEvents>& t) {
+		std::lock_guard<std::mutex> lock(mutex);
+		released.push_back(t);
+	}
+	Clock::time_point origin() const noexcept { return origin_; }
+	std::size_t capacity() const noexcept { return capacity_; }
+
+	//Not synchronized with the threads that are recording: call them once they are done.
+	std::vector<std::shared_ptr<ThreadEvents>> all() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return threads;
+	}
+	void reset() {
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& t : threads) t->events.clear();
+		origin_ = Clock::now();
+	}
+	//Events kept per thread. Discards every recorded event: call it before recording.
+	void set_capacity(std::size_t events) {
+		std::lock_guard<std::mutex> lock(mutex);
+		capacity_ = std::max<std::size_t>(events, 1);
+		for (const auto& t : threads) t->events.set_capacity(capacity_);
+	}
+};
+
+inline Registry& registry() {
+	static Registry r;
+	return r;
+}
+
+//Registers the events of a thread for as long as the thread lives
+class ThreadEntry {
+	std::shared_ptr<ThreadEvents> t;
+public:
+	ThreadEntry() : t(registry().add()) {}
+	ThreadEntry(const ThreadEntry&) = delete;
+	ThreadEntry& operator=(const ThreadEntry&) = delete;
+	~ThreadEntry() { registry().remove(t); }
+	ThreadEvents& events() noexcept { return *t; }
+};
+
+inline ThreadEvents& local() {
+	thread_local ThreadEntry entry;
+	return entry.events();
+}
+
+inline std::int64_t now() noexcept {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - registry().origin()).count();
+}
+
+//Records an event from its construction to its destruction
+class Scope {
+	const char* name;
+	std::int64_t arg;
+	std::int64_t begin;
+public:
+	explicit Scope(const char* name, std::int64_t arg = -1) noexcept : name(name), arg(arg), begin(now()) {}
+	Scope(const Scope&) = delete;
+	Scope& operator=(const Scope&) = delete;
+	~Scope() { std::int64_t end = now(); local().events.push_back(Event{name, begin, end - begin, arg}); }
+};
+
+inline std::size_t events() {
+	std::size_t sol = 0;
+	for (const auto& t : registry().all()) sol += t->events.size();
+	return sol;
+}
+
+inline std::uint64_t dropped() {
+	std::uint64_t sol = 0;
+	for (const auto& t : registry().all()) sol += t->events.dropped();
+	return sol;
+}
+
+inline void reset() { registry().reset(); }
+inline void set_capacity(std::size_t events) { registry().set_capacity(events); }
+
+/**
+ * Writes every recorded event as complete ("X") events in microseconds, one track per thread.
+ * Arguments are shown as "arg" in the details of each event, and the number of events that were
+ * dropped (the oldest ones, when a buffer was full) in the name of the track.
+ **/
+inline void write(std::ostream& os) {
+	//Nanosecond resolution, without going through floating point
+	auto microseconds = [] (std::int64_t ns) {
+		std::string f = std::to_string(1000 + ns%1000);
+		return std::to_string(ns/1000) + "." + f.substr(1);
+	};
+	auto threads = registry().all();
+	os<<"{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	auto separator = [&] () -> std::ostream& { if (!first) os<<",\n"; first = false; return os; };
+	for (const auto& t : threads) {
+		separator()<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<t->thread
+		           <<",\"args\":{\"name\":\"thread "<<t->thread;
+		if (t->events.dropped() > 0) os<<" ("<<t->events.dropped()<<" events dropped)";
+		os<<"\"}}";
+		for (std::size_t i = 0; i<t->events.size(); ++i) {
+			const Event& e = t->events[i];
+			separator()<<"{\"name\":\""<<e.name<<"\",\"cat\":\"tracer\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<t->thread
+			           <<",\"ts\":"<<microseconds(e.begin)<<",\"dur\":"<<microseconds(e.duration);
+			if (e.arg >= 0) os<<",\"args\":{\"arg\":"<<e.arg<<"}";
+			os<<"}";
+		}
+	}
+	os<<"\n]}\n";
+}
+
+inline void write(const std::string& filename) {
+	std::ofstream file(filename);
+	if (!file) throw std::runtime_error("Cannot write " + filename);
+	write(file);
+}
+
+}
+
+}
+
+#define TRACER_PROFILE_CONCAT_(a, b) a##b
+#define TRACER_PROFILE_CONCAT(a, b) TRACER_PROFILE_CONCAT_(a, b)
+#ifdef TRACER_PROFILE
+#define TRACER_PROFILE_SCOPE(...) ::tracer::profiler::Scope TRACER_PROFILE_CONCAT(tracer_profile_scope_, __LINE__)(__VA_ARGS__)
+#else
+#define TRACER_PROFILE_SCOPE(...) ((void)0)
+#endif
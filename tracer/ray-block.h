@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ray.h"
+
+namespace tracer {
+
+/**
+ * Structure of arrays for up to N rays (the first size() lanes are valid), so that a whole
+ * block can be generated (or tested) with vectorized operations. Consecutive lanes are expected
+ * to be neighbours in space (see sensors/tiles.h).
+ **/
+template<int N>
+class RayBlock {
+	Eigen::Array<float,N,3> origins_;
+	Eigen::Array<float,N,3> directions_;
+	Eigen::Array<float,N,1> ranges_min_;
+	Eigen::Array<float,N,1> ranges_max_;
+	int size_;
+	
+public:
+	RayBlock(int size = N) noexcept : 
+		ranges_min_(Eigen::Array<float,N,1>::Zero()), 
+		ranges_max_(Eigen::Array<float,N,1>::Constant(std::numeric_limits<float>::infinity())),
+		size_(size) { assert((size>=0) && (size<=N)); }
+
+	int size() const noexcept { return size_; }
+	const Eigen::Array<float,N,3>& origins() const noexcept { return origins_; }
+	const Eigen::Array<float,N,3>& directions() const noexcept { return directions_; }
+	const Eigen::Array<float,N,1>& ranges_min() const noexcept { return ranges_min_; }
+	const Eigen::Array<float,N,1>& ranges_max() const noexcept { return ranges_max_; }
+	Eigen::Array<float,N,3>& origins() noexcept { return origins_; }
+	Eigen::Array<float,N,3>& directions() noexcept { return directions_; }
+	Eigen::Array<float,N,1>& ranges_min() noexcept { return ranges_min_; }
+	Eigen::Array<float,N,1>& ranges_max() noexcept { return ranges_max_; }
+
+	Ray ray(int i) const noexcept {
+		assert((i>=0) && (i<size()));
+		return Ray(origins_.row(i).transpose().matrix(), directions_.row(i).transpose().matrix(), ranges_min_[i], ranges_max_[i]);
+	}
+};
+
+};
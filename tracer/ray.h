@@ -9,6 +9,7 @@ class Ray {
 	Eigen::Vector3f origin_;
 	Eigen::Vector3f direction_;
 	std::tuple<float, float> range_;
+	float cone_width_ = 0.0f, cone_spread_ = 0.0f;
 
 public:
 	Ray(const Eigen::Vector3f& origin, const Eigen::Vector3f& direction, float range_min = 0.0f, float range_max = std::numeric_limits<float>::infinity()) noexcept:
@@ -29,6 +30,16 @@ public:
 	}
 	
 	Eigen::Vector3f at(float distance) const noexcept { return origin()+distance*direction(); }
+
+	/**
+	 * Ray cone: the width of the footprint of the ray (e.g. of its pixel) at its origin and how much
+	 * it grows per unit of distance. Rays without a cone have no footprint, so level of detail 
+	 * always picks the exact geometry for them.
+	 **/
+	Ray& set_cone(float width, float spread) noexcept { cone_width_ = width; cone_spread_ = spread; return (*this); }
+	float cone_width() const noexcept { return cone_width_; }
+	float cone_spread() const noexcept { return cone_spread_; }
+	float footprint(float distance) const noexcept { return cone_width_ + cone_spread_*distance; }
 };
 
 };
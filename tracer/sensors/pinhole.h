@@ -1,6 +1,10 @@
 #pragma once
 
 #include "../ray.h"
+#include "../ray-block.h"
+#include "../frustum.h"
+#include "tiles.h"
+#include <array>
 
 namespace tracer {
 
@@ -31,6 +35,67 @@ public:
 			(-v)*transform().block<3,1>(0,1) +
 			  transform().block<3,1>(0,2)).normalized());
 	}
+
+	/**
+	 * The same ray, carrying the cone of a pixel of size pixel (in the same units as u and v, 2/w 
+	 * for an image w pixels wide) for level of detail selection.
+	 **/
+	Ray ray(float u, float v, float pixel) const {
+		Eigen::Vector3f d = (-u)*transform().block<3,1>(0,0) - v*transform().block<3,1>(0,1) + transform().block<3,1>(0,2);
+		return Ray(transform().block<3,1>(0,3), d.normalized()).set_cone(0.0f, pixel*transform().block<3,1>(0,0).norm()/d.norm());
+	}
+
+	/**
+	 * The same as ray(u,v) for the first n lanes of u and v, in a single vectorized pass
+	 * (including a vectorized reciprocal square root for normalization).
+	 **/
+	template<int N>
+	RayBlock<N> rays(const Eigen::Array<float,N,1>& u, const Eigen::Array<float,N,1>& v, int n = N) const {
+		RayBlock<N> sol(n);
+		sol.origins().rowwise() = transform().block<3,1>(0,3).transpose().array();
+		Eigen::Matrix<float,N,3> d = (-u).matrix()*transform().block<3,1>(0,0).transpose() - v.matrix()*transform().block<3,1>(0,1).transpose();
+		d.rowwise() += transform().block<3,1>(0,2).transpose();
+		sol.directions() = d.array().colwise()*d.rowwise().squaredNorm().array().rsqrt();
+		return sol;
+	}
+
+	/**
+	 * Rays through the centers of n pixels (i,j) of a w x h image (typically, consecutive pixels
+	 * of a tile in Morton order, see tiles.h).
+	 **/
+	template<int N>
+	RayBlock<N> rays(const std::array<int,2>* pixels, int n, int w, int h) const {
+		assert(n <= N);
+		float du = 2.0f/float(w), dv = 2.0f/float(h);
+		Eigen::Array<float,N,1> u = Eigen::Array<float,N,1>::Zero(), v = Eigen::Array<float,N,1>::Zero();
+		for (int k = 0; k<n; ++k) { 
+			u[k] = (float(pixels[k][0]) + 0.5f)*du - 1.0f; 
+			v[k] = (float(pixels[k][1]) + 0.5f)*dv - 1.0f; 
+		}
+		return rays<N>(u,v,n);
+	}
+
+	/**
+	 * The frustum that contains every ray of the pixels of a tile of a w x h image: its side 
+	 * planes go through the origin of the camera and the borders of the tile.
+	 **/
+	Frustum frustum(const Tile& tile, int w, int h) const {
+		float du = 2.0f/float(w), dv = 2.0f/float(h);
+		float u0 = float(tile.x0)*du - 1.0f, u1 = float(tile.x1)*du - 1.0f;
+		float v0 = float(tile.y0)*dv - 1.0f, v1 = float(tile.y1)*dv - 1.0f;
+		auto direction = [this] (float u, float v) {
+			return Eigen::Vector3f((-u)*transform().block<3,1>(0,0) - v*transform().block<3,1>(0,1) + transform().block<3,1>(0,2));
+		};
+		std::array<Eigen::Vector3f,4> corners{direction(u0,v0), direction(u1,v0), direction(u1,v1), direction(u0,v1)};
+		Eigen::Vector3f center = direction(0.5f*(u0+u1), 0.5f*(v0+v1));
+		std::array<Plane,4> planes;
+		for (int i = 0; i<4; ++i) {
+			Eigen::Vector3f normal = corners[i].cross(corners[(i+1)%4]);
+			if (normal.dot(center) < 0.0f) normal = -normal;
+			planes[i] = Plane(normal, Eigen::Vector3f(transform().block<3,1>(0,3)));
+		}
+		return Frustum(planes);
+	}
 };
 
 }
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <Eigen/Dense>
+#include <array>
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+
+namespace tracer {
+
+/**
+ * Sample values in [0,1) for Monte Carlo rendering that are a pure function of (pixel, sample
+ * index, dimension): tiles can be rendered in any order and on any thread, with no shared state,
+ * and always give the same image.
+ *   - Random:    white noise (hashed), the baseline
+ *   - Sobol:     Owen-scrambled Sobol (hash-based nested uniform scrambling, Burley 2020): every
+ *                prefix of 2^k samples of a pixel is stratified, and scrambling decorrelates
+ *                pixels (and groups of dimensions) without losing that
+ *   - BlueNoise: a Sobol sequence shared by every pixel, shifted in each pixel by a blue noise
+ *                mask (Cranley-Patterson rotation): per pixel it keeps the low discrepancy of the
+ *                sequence, and what error remains is spread as high frequency noise across the
+ *                image, which reads as less noisy at low sample counts (and filters away easily)
+ **/
+enum class Sampling { Random, Sobol, BlueNoise };
+
+namespace sampling {
+
+//Dimensions of the Sobol sequence. Further ones repeat them, decorrelated by scrambling
+constexpr int sobol_dimensions = 8;
+
+/**
+ * Generator matrices of the first Sobol dimensions (one 32 bit column per bit of the index, most
+ * significant bit first): van der Corput, then the primitive polynomials and direction numbers
+ * of Joe and Kuo (new-joe-kuo-6.21201) for dimensions 2 to 8.
+ **/
+constexpr std::array<std::array<std::uint32_t,32>,sobol_dimensions> sobol_matrices() noexcept {
+	struct Polynomial { std::uint32_t s, a; std::uint32_t m[5]; };
+	constexpr Polynomial polynomials[sobol_dimensions - 1] = {
+		{1, 0, {1}}, {2, 1, {1, 3}}, {3, 1, {1, 3, 1}}, {3, 2, {1, 1, 1}},
+		{4, 1, {1, 1, 3, 3}}, {4, 4, {1, 3, 5, 13}}, {5, 2, {1, 1, 5, 5, 17}}
+	};
+	std::array<std::array<std::uint32_t,32>,sobol_dimensions> sol{};
+	for (std::uint32_t k = 0; k<32; ++k) sol[0][k] = 1u << (31 - k);
+	for (int d = 1; d<sobol_dimensions; ++d) {
+		const Polynomial& p = polynomials[d - 1];
+		std::array<std::uint32_t,32>& v = sol[d];
+		for (std::uint32_t k = 0; k<32; ++k) {
+			if (k < p.s) { v[k] = p.m[k] << (31 - k); continue; }
+			v[k] = v[k - p.s] ^ (v[k - p.s] >> p.s);
+			for (std::uint32_t j = 1; j<p.s; ++j) if ((p.a >> (p.s - 1 - j)) & 1u) v[k] ^= v[k - j];
+		}
+	}
+	return sol;
+}
+
+inline constexpr std::array<std::array<std::uint32_t,32>,sobol_dimensions> sobol_matrix = sobol_matrices();
+
+//Point index of the Sobol sequence in dimension d < sobol_dimensions, as a 32 bit fraction.
+//Shuffled indices use all 32 bits, so the product goes through all of them, without branches
+constexpr std::uint32_t sobol(std::uint32_t index, int d) noexcept {
+	std::uint32_t sol = 0;
+	for (int k = 0; k<32; ++k) sol ^= sobol_matrix[d][k] & (0u - ((index >> k) & 1u));
+	return sol;
+}
+
+//Integer hash with good avalanche (lowbias32, by Chris Wellons)
+constexpr std::uint32_t mix(std::uint32_t x) noexcept {
+	x ^= x >> 16; x *= 0x7feb352du;
+	x ^= x >> 15; x *= 0x846ca68bu;
+	x ^= x >> 16;
+	return x;
+}
+constexpr std::uint32_t mix(std::uint32_t seed, std::uint32_t value) noexcept { return mix(seed ^ (value*0x9e3779b9u)); }
+
+constexpr std::uint32_t reverse_bits(std::uint32_t x) noexcept {
+	x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+	x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+	x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+	x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+	return (x >> 16) | (x << 16);
+}
+
+//Permutes x so that each bit only depends on itself and the lower ones (Laine and Karras)
+constexpr std::uint32_t laine_karras_permutation(std::uint32_t x, std::uint32_t seed) noexcept {
+	x += seed;
+	x ^= x*0x6c50b47cu;
+	x ^= x*0xb82f1e52u;
+	x ^= x*0xc7afe638u;
+	x ^= x*0x8d22f6e6u;
+	return x;
+}
+
+//Owen scrambling of a 32 bit fraction: each bit is flipped depending only on the ones above it
+constexpr std::uint32_t nested_uniform_scramble(std::uint32_t x, std::uint32_t seed) noexcept {
+	return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+//The 24 upper bits, so that the result is exact and strictly below 1
+constexpr float to_float(std::uint32_t x) noexcept { return float(x >> 8)*(1.0f/16777216.0f); }
+
+/**
+ * Owen-scrambled Sobol value of a sequence seed. Dimensions are used in groups of
+ * sobol_dimensions: within a group they come from the same (shuffled) point, so they are
+ * stratified together; each group shuffles the index with its own seed (padding).
+ **/
+constexpr std::uint32_t owen_sobol(std::uint32_t index, int dimension, std::uint32_t seed) noexcept {
+	std::uint32_t group = std::uint32_t(dimension/sobol_dimensions);
+	std::uint32_t shuffled = nested_uniform_scramble(index, mix(seed, 2*group));
+	return nested_uniform_scramble(sobol(shuffled, dimension%sobol_dimensions), mix(seed, 2*std::uint32_t(dimension) + 1));
+}
+
+constexpr int blue_noise_size = 64;
+
+/**
+ * A tileable blue_noise_size^2 blue noise mask, made once with the void and cluster method
+ * (Ulichney 1993): pixels are ranked by adding ones, one at a time, where they are farthest from
+ * the others (according to a toroidal Gaussian energy), so that every threshold of the mask is an
+ * evenly spread set of points. Values are (rank + 0.5)/size^2, in scanline order.
+ **/
+inline const std::vector<float>& blue_noise_mask() {
+	static const std::vector<float> mask = [] () {
+		constexpr int size = blue_noise_size, n = size*size;
+		constexpr float sigma = 1.5f;
+		std::vector<float> kernel(n);
+		for (int y = 0; y<size; ++y) for (int x = 0; x<size; ++x) {
+			int dx = std::min(x, size - x), dy = std::min(y, size - y);
+			kernel[y*size + x] = std::exp(-float(dx*dx + dy*dy)/(2.0f*sigma*sigma));
+		}
+		std::vector<float> energy(n, 0.0f);
+		std::vector<char> ones(n, 0);
+		auto toggle = [&] (int p, bool on) {
+			ones[p] = on;
+			const int px = p%size, py = p/size;
+			const float sign = on ? 1.0f : -1.0f;
+			for (int y = 0; y<size; ++y) for (int x = 0; x<size; ++x)
+				energy[y*size + x] += sign*kernel[((y - py + size)%size)*size + (x - px + size)%size];
+		};
+		auto tightest_cluster = [&] () {
+			int sol = -1;
+			for (int p = 0; p<n; ++p) if (ones[p] && ((sol < 0) || (energy[p] > energy[sol]))) sol = p;
+			return sol;
+		};
+		auto largest_void = [&] () {
+			int sol = -1;
+			for (int p = 0; p<n; ++p) if (!ones[p] && ((sol < 0) || (energy[p] < energy[sol]))) sol = p;
+			return sol;
+		};
+
+		//Initial pattern: random, then ones move from clusters to voids until none does
+		std::mt19937 random(0);
+		std::vector<int> pixels(n);
+		for (int p = 0; p<n; ++p) pixels[p] = p;
+		std::shuffle(pixels.begin(), pixels.end(), random);
+		const int initial = n/10;
+		for (int k = 0; k<initial; ++k) toggle(pixels[k], true);
+		for (int moves = 0; moves<n; ++moves) {
+			int cluster = tightest_cluster();
+			toggle(cluster, false);
+			int v = largest_void();
+			toggle(v, true);
+			if (v == cluster) break;
+		}
+		std::vector<char> pattern = ones;
+		std::vector<float> pattern_energy = energy;
+
+		std::vector<float> sol(n);
+		//Ones of the initial pattern, ranked by removing them from the tightest cluster down
+		for (int rank = initial - 1; rank>=0; --rank) {
+			int p = tightest_cluster();
+			toggle(p, false);
+			sol[p] = float(rank);
+		}
+		//The rest, ranked by filling the largest void (which is also the tightest cluster of zeros)
+		ones = pattern; energy = pattern_energy;
+		for (int rank = initial; rank<n; ++rank) {
+			int p = largest_void();
+			toggle(p, true);
+			sol[p] = float(rank);
+		}
+		for (float& v : sol) v = (v + 0.5f)/float(n);
+		return sol;
+	}();
+	return mask;
+}
+
+}
+
+/**
+ * Samples of a Sampling method, see above. Pixels are (i,j) image coordinates, index is the
+ * sample of the pixel and dimension the random decision it is used for (e.g. 0 and 1 for the
+ * position in the pixel, 2 and 3 for a lens or a light...). Any index and dimension can be asked
+ * for, in any order.
+ **/
+class Sampler {
+	Sampling sampling_;
+	std::uint32_t seed_;
+
+	std::uint32_t pixel_seed(int i, int j) const noexcept { return sampling::mix(sampling::mix(seed_, std::uint32_t(i)), std::uint32_t(j)); }
+
+	//The value of the sequence shared by every pixel, rotated by the mask of the pixel (each dimension over a differently shifted mask)
+	float blue_noise(int i, int j, int dimension, float value, const std::vector<float>& mask) const noexcept {
+		using namespace sampling;
+		std::uint32_t shift = mix(seed_, std::uint32_t(dimension) + 0x51ed270bu);
+		int x = (i + int(shift & 0xffffu)) & (blue_noise_size - 1), y = (j + int(shift >> 16)) & (blue_noise_size - 1);
+		float sol = value + mask[std::size_t(y)*blue_noise_size + x];
+		return (sol < 1.0f) ? sol : (sol - 1.0f);
+	}
+
+public:
+	explicit Sampler(Sampling sampling = Sampling::Sobol, std::uint32_t seed = 0) noexcept : sampling_(sampling), seed_(seed) {
+		if (sampling_ == Sampling::BlueNoise) sampling::blue_noise_mask();
+	}
+
+	Sampling sampling() const noexcept { return sampling_; }
+	std::uint32_t seed() const noexcept { return seed_; }
+
+	float operator()(int i, int j, std::uint32_t index, int dimension) const noexcept {
+		using namespace sampling;
+		switch (sampling_) {
+			case Sampling::Random:    return to_float(mix(mix(pixel_seed(i,j), index), std::uint32_t(dimension)));
+			case Sampling::Sobol:     return to_float(owen_sobol(index, dimension, pixel_seed(i,j)));
+			case Sampling::BlueNoise: return blue_noise(i, j, dimension, to_float(owen_sobol(index, dimension, seed_)), blue_noise_mask());
+		}
+		return 0.0f;
+	}
+
+	/**
+	 * One dimension of one sample of n pixels at once (typically, consecutive pixels of a tile,
+	 * see tiles.h, to feed Pinhole::rays). The method is chosen once for the whole block and the
+	 * lanes are computed in fixed-length, branch-free loops, so that the compiler vectorizes them.
+	 * Lanes past n are 0.
+	 **/
+	template<int N>
+	Eigen::Array<float,N,1> block(const std::array<int,2>* pixels, int n, std::uint32_t index, int dimension) const noexcept {
+		using namespace sampling;
+		Eigen::Array<float,N,1> sol = Eigen::Array<float,N,1>::Zero();
+		std::array<std::uint32_t,N> x{};
+		if (sampling_ == Sampling::BlueNoise) {
+			const float value = to_float(owen_sobol(index, dimension, seed_));
+			const std::vector<float>& mask = blue_noise_mask();
+			for (int k = 0; k<n; ++k) sol[k] = blue_noise(pixels[k][0], pixels[k][1], dimension, value, mask);
+			return sol;
+		}
+		for (int k = 0; k<n; ++k) x[k] = pixel_seed(pixels[k][0], pixels[k][1]);
+		if (sampling_ == Sampling::Random) {
+			for (int k = 0; k<N; ++k) x[k] = mix(mix(x[k], index), std::uint32_t(dimension));
+		} else {
+			const std::uint32_t group = std::uint32_t(dimension/sobol_dimensions);
+			const std::array<std::uint32_t,32>& matrix = sobol_matrix[dimension%sobol_dimensions];
+			std::array<std::uint32_t,N> shuffled, sobol{};
+			for (int k = 0; k<N; ++k) shuffled[k] = nested_uniform_scramble(index, mix(x[k], 2*group));
+			for (int b = 0; b<32; ++b)
+				for (int k = 0; k<N; ++k) sobol[k] ^= matrix[b] & (0u - ((shuffled[k] >> b) & 1u));
+			for (int k = 0; k<N; ++k) x[k] = nested_uniform_scramble(sobol[k], mix(x[k], 2*std::uint32_t(dimension) + 1));
+		}
+		for (int k = 0; k<n; ++k) sol[k] = to_float(x[k]);
+		return sol;
+	}
+};
+
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <algorithm>
+#include <cassert>
+
+namespace tracer {
+
+/**
+ * Pixels [x0,x1) x [y0,y1) of an image. 
+ **/
+struct Tile {
+	int x0, y0, x1, y1;
+	int width() const noexcept { return x1 - x0; }
+	int height() const noexcept { return y1 - y0; }
+	int size() const noexcept { return width()*height(); }
+};
+
+enum class PixelOrder { Scanline, Morton };
+
+//Spreads the lower 16 bits of x to the even bits of the result
+constexpr std::uint32_t part1by1(std::uint32_t x) noexcept {
+	x &= 0x0000ffff;
+	x = (x | (x << 8)) & 0x00ff00ff;
+	x = (x | (x << 4)) & 0x0f0f0f0f;
+	x = (x | (x << 2)) & 0x33333333;
+	x = (x | (x << 1)) & 0x55555555;
+	return x;
+}
+
+//Inverse of part1by1: gathers the even bits of x
+constexpr std::uint32_t compact1by1(std::uint32_t x) noexcept {
+	x &= 0x55555555;
+	x = (x | (x >> 1)) & 0x33333333;
+	x = (x | (x >> 2)) & 0x0f0f0f0f;
+	x = (x | (x >> 4)) & 0x00ff00ff;
+	x = (x | (x >> 8)) & 0x0000ffff;
+	return x;
+}
+
+constexpr std::uint32_t morton_encode(std::uint32_t x, std::uint32_t y) noexcept { return part1by1(x) | (part1by1(y) << 1); }
+constexpr std::array<std::uint32_t,2> morton_decode(std::uint32_t code) noexcept { return {compact1by1(code), compact1by1(code >> 1)}; }
+
+/**
+ * Calls f(x,y) for every (x,y) in [0,w)x[0,h) following the given order. Morton (Z-order) keeps
+ * consecutive calls close in both dimensions, even for sizes that are not powers of two (codes 
+ * that fall outside are skipped). Morton codes have 16 bits per coordinate, so each dimension is
+ * at most 65536 (pixels of a tile or tiles of an image).
+ **/
+template<typename F>
+void for_each_pixel(int w, int h, PixelOrder order, F&& f) {
+	if (order == PixelOrder::Scanline) {
+		for (int y = 0; y<h; ++y) for (int x = 0; x<w; ++x) f(x,y);
+	} else {
+		assert((w <= 65536) && (h <= 65536));
+		if ((w <= 0) || (h <= 0)) return;
+		//Codes grow with both coordinates, so the last pixel has the last code. It may be 2^32 - 1,
+		//so the end of the range does not fit in a Morton code.
+		std::uint64_t end = std::uint64_t(morton_encode(std::uint32_t(w - 1), std::uint32_t(h - 1))) + 1;
+		for (std::uint64_t code = 0; code < end; ++code) {
+			auto [x, y] = morton_decode(std::uint32_t(code));
+			if ((x < std::uint32_t(w)) && (y < std::uint32_t(h))) f(int(x),int(y));
+		}
+	}
+}
+
+/**
+ * Splits a w x h image into tiles of (at most) size x size pixels. Tiles are ordered so that
+ * consecutive ones are close in the image.
+ **/
+inline std::vector<Tile> tiles(int w, int h, int size = 16, PixelOrder order = PixelOrder::Morton) {
+	std::vector<Tile> sol;
+	for_each_pixel((w + size - 1)/size, (h + size - 1)/size, order, [&] (int x, int y) {
+		sol.push_back(Tile{x*size, y*size, std::min((x+1)*size, w), std::min((y+1)*size, h)});
+	});
+	return sol;
+}
+
+/**
+ * Image coordinates of the pixels of a tile in the given order.
+ **/
+inline std::vector<std::array<int,2>> pixels(const Tile& tile, PixelOrder order = PixelOrder::Morton) {
+	std::vector<std::array<int,2>> sol; sol.reserve(tile.size());
+	for_each_pixel(tile.width(), tile.height(), order, [&] (int x, int y) {
+		sol.push_back(std::array<int,2>{tile.x0 + x, tile.y0 + y});
+	});
+	return sol;
+}
+
+}
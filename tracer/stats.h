@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace tracer {
+
+/**
+ * Traversal and intersection counters: nodes visited (lists, packs, instances), primitive tests
+ * by type (every lane of a pack counts as a test), pack lanes wasted on padding and shadow rays 
+ * that finished before testing every object.
+ *
+ * They are only updated when TRACER_STATS is defined before including the tracer (as with MATERIAL),
+ * so they cost nothing otherwise.
+ **/
+struct Counters {
+	std::uint64_t nodes = 0;
+	std::uint64_t planes = 0;
+	std::uint64_t spheres = 0;
+	std::uint64_t triangles = 0;
+	std::uint64_t boxes = 0;
+	std::uint64_t wasted_lanes = 0;
+	std::uint64_t shadow_early_outs = 0;
+
+	std::uint64_t primitives() const noexcept { return planes + spheres + triangles + boxes; }
+
+	Counters& operator+=(const Counters& c) noexcept {
+		nodes += c.nodes; planes += c.planes; spheres += c.spheres; triangles += c.triangles; boxes += c.boxes;
+		wasted_lanes += c.wasted_lanes; shadow_early_outs += c.shadow_early_outs;
+		return (*this);
+	}
+	Counters operator-(const Counters& c) const noexcept {
+		Counters sol = (*this);
+		sol.nodes -= c.nodes; sol.planes -= c.planes; sol.spheres -= c.spheres; sol.triangles -= c.triangles; sol.boxes -= c.boxes;
+		sol.wasted_lanes -= c.wasted_lanes; sol.shadow_early_outs -= c.shadow_early_outs;
+		return sol;
+	}
+};
+
+namespace stats {
+
+/**
+ * Each thread counts on its own cache line, so there is no sharing between threads while tracing.
+ * They are registered so they can be aggregated afterwards. When a thread finishes, its counters
+ * are added to those of the finished threads and its entry is released, so the registry does not
+ * grow with every thread that has ever traced.
+ **/
+struct alignas(64) ThreadCounters : public Counters { };
+
+class Registry {
+	std::mutex mutex;
+	std::vector<std::shared_ptr<ThreadCounters>> counters;
+	Counters finished;
+public:
+	std::shared_ptr<ThreadCounters> add() {
+		std::lock_guard<std::mutex> lock(mutex);
+		counters.push_back(std::make_shared<ThreadCounters>());
+		return counters.back();
+	}
+	void remove(const std::shared_ptr<ThreadCounters>& c) {
+		std::lock_guard<std::mutex> lock(mutex);
+		finished += *c;
+		counters.erase(std::remove(counters.begin(), counters.end(), c), counters.end());
+	}
+	//Threads that are currently registered
+	std::size_t threads() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return counters.size();
+	}
+	//Not synchronized with the threads that are counting: call it once they are done.
+	Counters total() {
+		std::lock_guard<std::mutex> lock(mutex);
+		Counters sol = finished;
+		for (const auto& c : counters) sol += *c;
+		return sol;
+	}
+	void reset() {
+		std::lock_guard<std::mutex> lock(mutex);
+		finished = Counters();
+		for (const auto& c : counters) static_cast<Counters&>(*c) = Counters();
+	}
+};
+
+inline Registry& registry() {
+	static Registry r;
+	return r;
+}
+
+//Registers the counters of a thread for as long as the thread lives
+class ThreadEntry {
+	std::shared_ptr<ThreadCounters> c;
+public:
+	ThreadEntry() : c(registry().add()) {}
+	ThreadEntry(const ThreadEntry&) = delete;
+	ThreadEntry& operator=(const ThreadEntry&) = delete;
+	~ThreadEntry() { registry().remove(c); }
+	Counters& counters() noexcept { return *c; }
+};
+
+//Counters of the calling thread. Subtracting two snapshots gives the counters of a single ray.
+inline Counters& local() {
+	thread_local ThreadEntry entry;
+	return entry.counters();
+}
+
+inline Counters total() { return registry().total(); }
+inline void reset() { registry().reset(); }
+
+}
+
+}
+
+#ifdef TRACER_STATS
+#define TRACER_COUNT(counter, n) (::tracer::stats::local().counter += (n))
+#else
+#define TRACER_COUNT(counter, n) ((void)0)
+#endif
@@ -3,16 +3,31 @@
 #include "hit.h"
 #include "object.h"
 #include "ray.h"
+#include "ray-block.h"
+#include "prepared-ray.h"
+#include "arena.h"
+#include "bounds.h"
+#include "frustum.h"
+#include "hash.h"
+#include "profiler.h"
 #include "primitives/plane.h"
 #include "primitives/triangle.h"
 #include "primitives/sphere.h"
 #include "primitives/axis-aligned-box.h"
 #include "pack/list.h"
 #include "pack/scene.h"
+#include "pack/candidates.h"
+#include "pack/compressed-mesh.h"
 #include "pack/pack.h"
 #include "pack/pack-plane.h"
 #include "pack/pack-sphere.h"
 #include "pack/pack-triangle.h"
 #include "pack/pack-axis-aligned-box.h"
+#include "pack/fixed-origin.h"
 #include "composites/instance.h"
+#include "composites/lod.h"
+#include "accelerators/bvh.h"
 #include "sensors/pinhole.h"
+#include "sensors/tiles.h"
+#include "sensors/sampler.h"
+#include "precompiled.h"